@@ -0,0 +1,49 @@
+// Board geometry. The default is the one 8x8 panel; build with -DBOARD_ROWS=n
+// and -DBOARD_COLS=n (multiples of 8 up to 64) for a bigger matrix of chained
+// panels. Every row of a board layer is one board_row_t, bit n = column n, so
+// moving a wall, a collision or a shot hit is the same few operations on a row
+// at any width, and walls are made of 8 blocks stretched to the width
+// (walls.h). The host port (host/sim/game.h) reads the same two macros.
+
+////////////////////////////////////////////////////////////////////////////////
+
+#ifndef BOARD_H
+#define BOARD_H
+
+#include <stdint.h>
+
+#ifndef BOARD_ROWS
+#define BOARD_ROWS 8
+#endif
+#ifndef BOARD_COLS
+#define BOARD_COLS 8
+#endif
+
+/* The board is made of whole 8x8 panels, see display.h */
+#if BOARD_ROWS % 8 != 0 || BOARD_ROWS < 8 || BOARD_ROWS > 64
+#error "BOARD_ROWS must be a multiple of 8 from 8 to 64"
+#endif
+#if BOARD_COLS % 8 != 0 || BOARD_COLS < 8 || BOARD_COLS > 64
+#error "BOARD_COLS must be a multiple of 8 from 8 to 64"
+#endif
+
+/* A row of a layer, bit n = column n */
+#if BOARD_COLS == 8
+typedef uint8_t board_row_t;
+#elif BOARD_COLS <= 16
+typedef uint16_t board_row_t;
+#elif BOARD_COLS <= 32
+typedef uint32_t board_row_t;
+#else
+typedef uint64_t board_row_t;
+#endif
+
+#define BOARD_TOP		(BOARD_ROWS - 1)	// row new walls appear in
+#define BOARD_LAST_COL	(BOARD_COLS - 1)
+#define BOARD_START_COL	(BOARD_COLS / 2 - 1)	// player column after a restart
+#define BOARD_BIT(c)	((board_row_t)1 << (c))
+
+/* One of the 8 blocks of BOARD_COLS / 8 columns that walls are made of */
+#define BOARD_BLOCK		(BOARD_BIT(BOARD_COLS / 8) - 1)
+
+#endif //BOARD_H
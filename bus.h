@@ -0,0 +1,88 @@
+// Events between tasks. A task publishes on a topic with bus_publish(), and
+// every subscriber of the topic finds the event in a ring of its own in
+// GameState and takes it with bus_take() when it ticks, so a second event
+// does not overwrite one that has not been seen. An event that finds a ring
+// full is dropped and counted in bus_lost. A subscriber can ask to be woken:
+// its elapsedTime is set to its period, so the scheduler loop ticks it in the
+// same pass if it comes after the publisher in game.tasks, or on the next one
+// if it comes before, instead of up to a period later.
+//
+// Topics and subscribers are fixed in bus_subscribers[]:
+//   BUS_MOVE		getMovement read the stick, 0x01 right or 0x02 left, for
+//					moveObject
+//   BUS_POWERUP	the player took a powerup, its column, for powerupShooting
+
+////////////////////////////////////////////////////////////////////////////////
+
+#ifndef BUS_H
+#define BUS_H
+
+#include <avr/pgmspace.h>
+#include "game_state.h"
+
+#define BUS_MOVE		0
+#define BUS_POWERUP		1
+#define BUS_EMPTY		0xFF	// bus_take() with nothing in the ring
+
+/* Subscribers, in bus_subscribers[] order */
+#define BUS_SUB_MOVE	0
+#define BUS_SUB_POWERUP	1
+
+typedef struct _bus_subscriber {
+	unsigned char topics;	// bit n: topic n
+	unsigned char task;		// index in game.tasks
+	unsigned char wake;		// tick it as soon as an event comes
+} bus_subscriber;
+
+static const bus_subscriber bus_subscribers[BUS_SUBSCRIBERS] PROGMEM = {
+	{ .topics = 1 << BUS_MOVE, .task = 1, .wake = 1 },		// moveObject
+	{ .topics = 1 << BUS_POWERUP, .task = 3, .wake = 1 },	// powerupShooting
+};
+
+////////////////////////////////////////////////////////////////////////////////
+//Functionality - hands an event to every subscriber of its topic
+//Parameter: topic, argument
+//Returns: nothing
+static void bus_publish(unsigned char topic, unsigned char arg) {
+	for(unsigned char s = 0; s < BUS_SUBSCRIBERS; ++s) {
+		if(!(pgm_read_byte(&bus_subscribers[s].topics) & (1 << topic))) {
+			continue;
+		}
+		
+		if(game.bus_count[s] == BUS_RING) {
+			if(game.bus_lost[s] != 0xFF) {
+				++game.bus_lost[s];
+			}
+		}
+		
+		else {
+			unsigned char k = (game.bus_head[s] + game.bus_count[s]) & (BUS_RING - 1);
+			game.bus_topic[s][k] = topic;
+			game.bus_arg[s][k] = arg;
+			++game.bus_count[s];
+		}
+		
+		if(pgm_read_byte(&bus_subscribers[s].wake)) {
+			task* t = &game.tasks[pgm_read_byte(&bus_subscribers[s].task)];
+			t->elapsedTime = t->period;
+		}
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//Functionality - takes the oldest event in a subscriber's ring
+//Parameter: subscriber, where to put the argument
+//Returns: the event's topic, or BUS_EMPTY
+static unsigned char bus_take(unsigned char s, unsigned char* arg) {
+	if(game.bus_count[s] == 0) {
+		return BUS_EMPTY;
+	}
+	
+	unsigned char k = game.bus_head[s];
+	game.bus_head[s] = (k + 1) & (BUS_RING - 1);
+	--game.bus_count[s];
+	*arg = game.bus_arg[s][k];
+	return game.bus_topic[s][k];
+}
+
+#endif //BUS_H
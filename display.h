@@ -0,0 +1,112 @@
+// Display driver for a board of chained 8x8 panels. Every panel has its own
+// four shift registers, ground (row select), red, green and blue, and the
+// panels are daisy-chained: each of the four serial lines runs from the
+// ATmega through panel 0, panel 1, ... to the last one, and all share the
+// clock and latch. Panel p covers columns 8 * (p % DISPLAY_PANELS_X) and up,
+// rows 8 * (p / DISPLAY_PANELS_X) and up.
+//
+// The scan is interleaved across panels: a scan step lights the same row of
+// every panel at once (row display_row of panel 0, row display_row + 8 of
+// the panel above it and so on), so a frame is 8 steps and each row is lit
+// 1/8 of the time however many panels there are. A step clocks 8 bits per
+// panel into each chain.
+//
+// display_prepare() turns the layers into the step's output stream, the PORTD
+// and PORTC value for each clock, a byte of each layer at a time and without
+// branches. display_scan() then only copies the stream to the ports, so the
+// time the chain is being clocked grows with the bits shifted and nothing
+// else.
+//
+// DISPLAY_CYCLES_BIT and DISPLAY_CYCLES_STEP are counted by hand from the two
+// loops at -Os: about 36 cycles to build a bit of the stream (the per panel
+// byte loads spread over its 8 bits) and 14 to clock it (2 loads, 4 port
+// writes and the loop). `escalade_simprof` measures shift() for a real
+// figure, and `escalade_display` turns either into refresh rates.
+
+////////////////////////////////////////////////////////////////////////////////
+
+#ifndef DISPLAY_H
+#define DISPLAY_H
+
+#include <avr/io.h>
+#include "game_state.h"
+
+#define DISPLAY_PANELS_X	(BOARD_COLS / 8)
+#define DISPLAY_PANELS		(DISPLAY_PANELS_X * (BOARD_ROWS / 8))
+#define DISPLAY_BITS		(8 * DISPLAY_PANELS)	// clocks per scan step
+
+#define DISPLAY_CYCLES_BIT	50	// build and clock one bit of every chain
+#define DISPLAY_CYCLES_STEP	60	// call, row bookkeeping and latch per step
+
+/* Frames per second with the display scanned back to back */
+#define DISPLAY_REFRESH_MAX_HZ \
+	(F_CPU / (8UL * (DISPLAY_BITS * DISPLAY_CYCLES_BIT + DISPLAY_CYCLES_STEP)))
+
+/* Byte n (columns 8n to 8n + 7) of a board row */
+#define DISPLAY_ROW_BYTE(row, n) (((const unsigned char*)&(row))[n])
+
+// Where the scan is. Only shift(), from the timer interrupt, changes them, so
+// they are kept out of GameState, which the main loop copies over whole
+unsigned char display_gnd = 0x01;	// ground line of the scan step, the same on every panel
+unsigned char display_row = 0;		// scan step, the row of each panel being shown
+
+unsigned char display_d[DISPLAY_BITS];	// PORTD: red on bit 0, blue on bit 4
+unsigned char display_c[DISPLAY_BITS];	// PORTC: ground on bit 0, green on bit 4
+
+////////////////////////////////////////////////////////////////////////////////
+//Functionality - builds the output stream of scan step display_row, composited
+//                from the layers (shots in white) and inverted for the common
+//                anode matrices
+//Parameter: none
+//Returns: nothing
+static void display_prepare(void) {
+	unsigned char* d = display_d;
+	unsigned char* c = display_c;
+	
+	/* The last panel's bits go first, they have the furthest to travel */
+	for(signed char p = DISPLAY_PANELS - 1; p >= 0; --p) {
+		unsigned char row = (p / DISPLAY_PANELS_X) * 8 + display_row;
+		unsigned char x = p % DISPLAY_PANELS_X;
+		unsigned char shots = DISPLAY_ROW_BYTE(game.shot_rows[row], x);
+		unsigned char r = ~(DISPLAY_ROW_BYTE(game.player_rows[row], x) | shots);
+		unsigned char g = ~(DISPLAY_ROW_BYTE(game.powerup_rows[row], x) | shots);
+		unsigned char b = ~(DISPLAY_ROW_BYTE(game.wall_rows[row], x) | shots);
+		unsigned char gnd = display_gnd;
+		
+		/* Column 7 first; SRCLR (0x88) high, SRCLK low */
+		for(unsigned char i = 0; i < 8; ++i) {
+			*d++ = 0x88 | (r >> 7) | ((b >> 7) << 4);
+			*c++ = 0x88 | (gnd >> 7) | ((g >> 7) << 4);
+			r <<= 1;
+			g <<= 1;
+			b <<= 1;
+			gnd <<= 1;
+		}
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//Functionality - clocks the stream into the chains and latches it
+//Parameter: none
+//Returns: nothing
+static void display_scan(void) {
+	for(unsigned short k = 0; k < DISPLAY_BITS; ++k) {
+		unsigned char d = display_d[k];
+		unsigned char c = display_c[k];
+		// set SER, then a rising SRCLK shifts it in
+		PORTD = d;
+		PORTC = c;
+		PORTD = d | 0x44;
+		PORTC = c | 0x44;
+	}
+	
+	// set RCLK = 1. Rising edge copies data from “Shift” register to “Storage” register
+	PORTD |= 0x22;
+	PORTC |= 0x22;
+	
+	// clears all lines in preparation of a new transmission
+	PORTD = 0x00;
+	PORTC = 0x00;
+}
+
+#endif //DISPLAY_H
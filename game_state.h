@@ -0,0 +1,84 @@
+// Every piece of mutable game state of main.c, kept in one struct so the
+// whole game can be reset, saved and restored with a single block copy.
+
+////////////////////////////////////////////////////////////////////////////////
+
+#ifndef GAME_STATE_H
+#define GAME_STATE_H
+
+#include "scheduler.h"
+#include "board.h"
+
+#define GAME_NUM_TASKS 5
+#define SHOT_CAPACITY 8 // shots in flight at once, see shots.h
+#define WALL_QUEUE 4 // walls made ahead, see walls.h
+#define BUS_SUBSCRIBERS 2 // tasks listening on the bus, see bus.h
+#define BUS_RING 4 // events each can hold, a power of 2
+
+typedef struct _GameState {
+	/* Display; the scan step is display.h's */
+	unsigned char screen_step;	// end screens: 0 the face, then the score's scroll steps
+	unsigned short screen_ms;	// end screens: ms the current step has been shown
+	
+	// The board, one bitboard per kind of thing and row, bit n = column n.
+	// A cell is in at most one of them; shots (shot_rows) are drawn on top.
+	// shift() composites a row straight into the shift register bytes.
+	board_row_t wall_rows[BOARD_ROWS];		// blue
+	board_row_t powerup_rows[BOARD_ROWS];	// green
+	board_row_t player_rows[BOARD_ROWS];	// red
+
+	/* Game */
+	int seeder;				// wall generator seed, bumped by every move
+	unsigned char score;
+	int height, width;		// player position
+	unsigned char game_over;
+	unsigned char powerup_activated;
+
+	/* getMovement */
+	int x_val;
+
+	/* moveWalls */
+	board_row_t wall;		// columns of the descending wall, see walls.h
+	int powerup_randomNum, powerup_spawn;
+	unsigned char counter;	// row of the descending wall
+	board_row_t pos;		// wall columns already broken, bit n = column n
+	unsigned char wall_next[WALL_QUEUE];	// walls made ahead, as 8-block patterns
+	unsigned char wall_spawn[WALL_QUEUE];	// and their powerup column
+	unsigned char wall_period[WALL_QUEUE];	// and moveWalls period, 0 to keep it
+	unsigned char wall_head, wall_count;	// oldest queued wall, walls queued
+	unsigned char wall_last;				// pattern of the newest wall made
+	unsigned char level;					// level played, 0 for none, see level.h
+	unsigned short level_pos;				// its next byte in level_data
+	unsigned char level_run;				// walls left of the pattern before it
+
+	/* powerupShooting, see shots.h */
+	unsigned char powerup_remainingTime;	// steps left of the powerup
+	unsigned char shot_cooldown;			// steps to the next volley
+	board_row_t shot_rows[BOARD_ROWS];		// bit n: a shot in column n
+	unsigned char shot_clock;				// shot steps since the pool was empty
+	unsigned char shot_fired[SHOT_CAPACITY];	// shot_clock at the shot
+	unsigned char shot_col[SHOT_CAPACITY];
+	unsigned char shot_next[SHOT_CAPACITY];	// free list links, slot + 1
+	unsigned char shot_free;				// free list head, 0 if empty
+	unsigned char shot_fresh;				// slots ever used
+
+	/* Event rings of bus.h, one per subscriber */
+	unsigned char bus_topic[BUS_SUBSCRIBERS][BUS_RING];
+	unsigned char bus_arg[BUS_SUBSCRIBERS][BUS_RING];
+	unsigned char bus_head[BUS_SUBSCRIBERS], bus_count[BUS_SUBSCRIBERS];
+	unsigned char bus_lost[BUS_SUBSCRIBERS];	// events that found the ring full
+
+	/* playMusic: note being played */
+	unsigned char i;
+
+	task tasks[GAME_NUM_TASKS];
+} GameState;
+
+extern GameState game;
+
+// Copies the power-on image out of flash, which is also what a restart does.
+void game_reset(void);
+void game_snapshot(GameState* out);
+void game_restore(const GameState* in);
+
+#endif //GAME_STATE_H
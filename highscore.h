@@ -0,0 +1,186 @@
+// High score and game statistics kept in EEPROM across power cycles.
+//
+// The 4 KB EEPROM is a circular log of HIGHSCORE_SLOTS 8-byte records, each
+// game end writing the next slot, so every cell sees one write per
+// HIGHSCORE_SLOTS games. Writes never block: highscore_game_end() updates
+// the stats in RAM and hands the record to the EE_READY interrupt, which
+// programs one byte per interrupt (about 3.4 ms each) and skips bytes that
+// already hold the right value. Games ending while a record is still being
+// written are folded into the next one.
+//
+// Record	= seq (2), games (2), wins (2), best (1), check (1), little endian
+// check is 0x5A plus the sum of the other bytes, so erased slots (0xFF) and
+// records torn by a power cut do not count. Consecutive slots hold
+// consecutive seqs up to the newest record, which highscore_init() finds by
+// binary search over the slots.
+
+////////////////////////////////////////////////////////////////////////////////
+
+#ifndef HIGHSCORE_H
+#define HIGHSCORE_H
+
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include <avr/eeprom.h>
+
+#define HIGHSCORE_RECORD	8
+#define HIGHSCORE_SLOTS		(4096 / HIGHSCORE_RECORD)
+
+unsigned short highscore_games = 0;
+unsigned short highscore_wins = 0;
+unsigned char highscore_best = 0;
+
+/* Log position: slot and seq of the next record */
+unsigned short highscore_slot = 0;
+unsigned short highscore_seq = 0;
+
+/* Next record, owned by the ISR while EERIE is set */
+unsigned char highscore_next[HIGHSCORE_RECORD];
+volatile unsigned char highscore_dirty = 0;
+
+/* ISR only: record being written and how far it got */
+unsigned char highscore_out[HIGHSCORE_RECORD];
+unsigned short highscore_out_addr;
+unsigned char highscore_out_pos = HIGHSCORE_RECORD;
+
+static unsigned char highscore_check(const unsigned char* r) {
+	unsigned char sum = 0x5A;
+	for(unsigned char k = 0; k < HIGHSCORE_RECORD - 1; ++k) {
+		sum += r[k];
+	}
+	return sum;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//Functionality - reads a slot of the log
+//Parameter: slot, and where to put its seq
+//Returns: 1 if the slot holds a whole record
+static unsigned char highscore_read(unsigned short slot, unsigned char* r) {
+	eeprom_read_block(r, (const void*)(uintptr_t)(slot * HIGHSCORE_RECORD), HIGHSCORE_RECORD);
+	return highscore_check(r) == r[HIGHSCORE_RECORD - 1];
+}
+
+static unsigned short highscore_seq_of(const unsigned char* r) {
+	return r[0] | (r[1] << 8);
+}
+
+/* Slot k is part of the run of seqs starting at slot 0 */
+static unsigned char highscore_in_run(unsigned short k, unsigned short seq0) {
+	unsigned char r[HIGHSCORE_RECORD];
+	return highscore_read(k, r) && highscore_seq_of(r) == (unsigned short)(seq0 + k);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//Functionality - finds the newest record and loads the stats from it
+//Parameter: none
+//Returns: nothing
+void highscore_init() {
+	unsigned char r[HIGHSCORE_RECORD];
+	short newest = -1;
+
+	if(highscore_read(0, r)) {
+		/* Slots 0..newest hold seq0..seq0+newest, later ones do not */
+		unsigned short seq0 = highscore_seq_of(r);
+		unsigned short lo = 0, hi = HIGHSCORE_SLOTS;
+		while(hi - lo > 1) {
+			unsigned short mid = (lo + hi) / 2;
+			if(highscore_in_run(mid, seq0)) {
+				lo = mid;
+			}
+			else {
+				hi = mid;
+			}
+		}
+		newest = lo;
+	}
+
+	else {
+		/* Slot 0 erased or torn: scan for the highest seq. The log spans
+		   fewer than 32768 seqs, so differences order them across wraps. */
+		unsigned short newest_seq = 0;
+		for(unsigned short k = 1; k < HIGHSCORE_SLOTS; ++k) {
+			if(highscore_read(k, r)) {
+				unsigned short seq = highscore_seq_of(r);
+				if(newest < 0 || (short)(seq - newest_seq) > 0) {
+					newest = k;
+					newest_seq = seq;
+				}
+			}
+		}
+	}
+
+	if(newest < 0) {
+		return;
+	}
+
+	highscore_read(newest, r);
+	highscore_seq = highscore_seq_of(r) + 1;
+	highscore_slot = (newest + 1) % HIGHSCORE_SLOTS;
+	highscore_games = r[2] | (r[3] << 8);
+	highscore_wins = r[4] | (r[5] << 8);
+	highscore_best = r[6];
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//Functionality - counts a finished game and queues its record, never blocks
+//Parameter: final score, and whether the game was won
+//Returns: nothing
+void highscore_game_end(unsigned char score, unsigned char won) {
+	++highscore_games;
+	if(won) {
+		++highscore_wins;
+	}
+	if(score > highscore_best) {
+		highscore_best = score;
+	}
+
+	/* Keep the ISR off highscore_next while it changes */
+	EECR &= ~(1 << EERIE);
+	highscore_next[0] = highscore_games & 0xFF;
+	highscore_next[1] = highscore_games >> 8;
+	highscore_next[2] = highscore_wins & 0xFF;
+	highscore_next[3] = highscore_wins >> 8;
+	highscore_next[4] = highscore_best;
+	highscore_dirty = 1;
+	EECR |= (1 << EERIE);
+}
+
+ISR(EE_READY_vect) {
+	if(highscore_out_pos == HIGHSCORE_RECORD) {
+		if(!highscore_dirty) {
+			EECR &= ~(1 << EERIE);
+			return;
+		}
+
+		/* Start the next record */
+		highscore_out[0] = highscore_seq & 0xFF;
+		highscore_out[1] = highscore_seq >> 8;
+		for(unsigned char k = 0; k < 5; ++k) {
+			highscore_out[2 + k] = highscore_next[k];
+		}
+		highscore_out[HIGHSCORE_RECORD - 1] = highscore_check(highscore_out);
+		highscore_out_addr = highscore_slot * HIGHSCORE_RECORD;
+		highscore_out_pos = 0;
+		highscore_dirty = 0;
+
+		++highscore_seq;
+		highscore_slot = (highscore_slot + 1) % HIGHSCORE_SLOTS;
+	}
+
+	/* Program the next byte that differs */
+	while(highscore_out_pos < HIGHSCORE_RECORD) {
+		unsigned short addr = highscore_out_addr + highscore_out_pos;
+		unsigned char value = highscore_out[highscore_out_pos++];
+
+		EEAR = addr;
+		EECR |= (1 << EERE);
+		if(EEDR != value) {
+			EEDR = value;
+			EECR |= (1 << EEMPE);
+			EECR |= (1 << EEPE);
+			return;
+		}
+	}
+}
+
+#endif //HIGHSCORE_H
@@ -0,0 +1,713 @@
+// Micro-benchmarks for the game hot paths of the host port.
+//
+//   escalade_bench [--filter text] [--json out.json]
+//                  [--compare baseline.json [--threshold percent]]
+//
+// Each benchmark reports ns/op, heap allocations/op and, when the kernel lets
+// us open a perf counter, instructions retired/op. --compare fails, exiting
+// with 1, on a result with more than 2% more instructions than the baseline
+// or with more allocations; both travel between machines. ns/op only compares
+// on the machine the baseline was recorded on, so a result slower by more
+// than the threshold (default 25%) is marked but does not fail.
+
+////////////////////////////////////////////////////////////////////////////////
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+#include <chrono>
+#include <new>
+#include <vector>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#include "../bot/bot.h"
+#include "../sim/game.h"
+#include "../../pt.h"
+
+using namespace escalade;
+
+////////////////////////////////////////////////////////////////////////////////
+//Heap allocation counter
+
+static uint64_t g_allocs = 0;
+
+void* operator new(size_t size) {
+	++g_allocs;
+	void* p = malloc(size ? size : 1);
+	if(!p) {
+		throw std::bad_alloc();
+	}
+	return p;
+}
+
+void operator delete(void* p) noexcept { free(p); }
+void operator delete(void* p, size_t) noexcept { free(p); }
+
+////////////////////////////////////////////////////////////////////////////////
+//Instructions retired, user space only. -1 when perf is unavailable.
+
+struct InstructionCounter {
+	int fd = -1;
+
+	InstructionCounter() {
+#ifdef __linux__
+		struct perf_event_attr attr;
+		memset(&attr, 0, sizeof(attr));
+		attr.size = sizeof(attr);
+		attr.type = PERF_TYPE_HARDWARE;
+		attr.config = PERF_COUNT_HW_INSTRUCTIONS;
+		attr.disabled = 1;
+		attr.exclude_kernel = 1;
+		attr.exclude_hv = 1;
+		fd = (int)syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+#endif
+	}
+
+	bool available() const { return fd >= 0; }
+
+	void start() {
+#ifdef __linux__
+		if(fd >= 0) {
+			ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+			ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+		}
+#endif
+	}
+
+	uint64_t stop() {
+		uint64_t count = 0;
+#ifdef __linux__
+		if(fd >= 0) {
+			ioctl(fd, PERF_EVENT_IOC_DISABLE, 0);
+			if(read(fd, &count, sizeof(count)) != sizeof(count)) {
+				count = 0;
+			}
+		}
+#endif
+		return count;
+	}
+};
+
+////////////////////////////////////////////////////////////////////////////////
+//Results and the runner
+
+struct Result {
+	char name[48];
+	double ns_per_op;
+	double allocs_per_op;
+	double instructions_per_op; /* < 0 when not measured */
+};
+
+static InstructionCounter g_counter;
+static const char* g_filter = NULL;
+static std::vector<Result> g_results;
+
+/* Runs batch (ops operations per call) for about 20 ms per sample and keeps
+   the fastest of 7 samples, which is the least disturbed by other load */
+template <typename Batch>
+static void bench(const char* name, uint64_t ops, Batch batch) {
+	if(g_filter && !strstr(name, g_filter)) {
+		return;
+	}
+
+	typedef std::chrono::steady_clock clock;
+
+	uint64_t batches = 1;
+	while(1) {
+		clock::time_point t0 = clock::now();
+		for(uint64_t b = 0; b < batches; ++b) {
+			batch();
+		}
+		double s = std::chrono::duration<double>(clock::now() - t0).count();
+		if(s > 0.02) {
+			break;
+		}
+		batches *= 2;
+	}
+
+	double ns[7];
+	uint64_t allocs = g_allocs;
+	g_counter.start();
+	for(int k = 0; k < 7; ++k) {
+		clock::time_point t0 = clock::now();
+		for(uint64_t b = 0; b < batches; ++b) {
+			batch();
+		}
+		ns[k] = std::chrono::duration<double, std::nano>(clock::now() - t0).count();
+	}
+	uint64_t instructions = g_counter.stop();
+	allocs = g_allocs - allocs;
+
+	double total_ops = (double)(batches * ops);
+	std::sort(ns, ns + 7);
+
+	Result r;
+	snprintf(r.name, sizeof(r.name), "%s", name);
+	r.ns_per_op = ns[0] / total_ops;
+	r.allocs_per_op = allocs / (7 * total_ops);
+	r.instructions_per_op = g_counter.available() ? instructions / (7 * total_ops) : -1.0;
+	g_results.push_back(r);
+
+	printf("%-32s %10.2f ns/op %8.2f allocs/op", r.name, r.ns_per_op, r.allocs_per_op);
+	if(r.instructions_per_op >= 0) {
+		printf(" %10.1f instr/op", r.instructions_per_op);
+	}
+	printf("\n");
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//Game states to start from
+
+/* Right after mW_generate drew fixed wall pattern n (1..10), player in a gap */
+template<typename G = Game>
+static G wall_state(int n) {
+	G g;
+	g.reset(0);
+	g.powerup_activated = 0x01; /* keep the wall alone on the board */
+	g.wall_next[0] = kWallPatterns[n - 1];
+	g.wall_count = 1;
+	g.tasks[kMoveWalls].state = (signed char)g.moveWalls(mW_wait);
+
+	typename G::Row mask = G::kWalls[n - 1];
+	int gap = 0;
+	while(mask & G::bit(gap)) {
+		++gap;
+	}
+	g.width = gap;
+	g.player_rows[g.height] = G::bit(g.width);
+	return g;
+}
+
+/* powerupShooting as it was before it became a protothread, a transition
+   switch and an action switch over these states, to compare the two */
+enum powerupShooting_States {pS_init, pS_wait, pS_generate, pS_shoot};
+
+static int powerupShooting_switch(Game& g, int state) {
+	switch(state) {
+		case pS_init:
+			state = pS_wait;
+			break;
+
+		case pS_wait: {
+			unsigned char col;
+			if(g.bus_take(kSubPowerup, col) != kBusEmpty) {
+				state = pS_generate;
+				g.powerup_remainingTime = kShotSteps;
+				g.shot_cooldown = 0;
+			}
+
+			break;
+		}
+
+		case pS_generate:
+			if(g.powerup_remainingTime > 0) {
+				state = (g.shot_cooldown == 0) ? pS_generate : pS_shoot;
+			}
+
+			if(g.powerup_remainingTime == 0) {
+				state = pS_wait;
+				g.powerup_activated = 0x00;
+				g.shots_clear();
+			}
+
+			break;
+
+		case pS_shoot:
+			if(g.shot_cooldown == 0 || g.powerup_remainingTime == 0) {
+				state = pS_generate;
+			}
+
+			break;
+
+		default:
+			break;
+	}
+
+	switch(state) {
+		case pS_generate:
+			g.shots_advance();
+			if(g.powerup_remainingTime > 0) {
+				for(int c = g.width - kShotSpread; c <= g.width + kShotSpread; ++c) {
+					if(c >= 0 && c < Game::kCols) {
+						g.shots_fire(c);
+					}
+				}
+				g.shot_cooldown = kShotInterval - 1;
+				g.powerup_remainingTime = g.powerup_remainingTime - 1;
+			}
+			g.shots_hit_row(g.counter);
+			break;
+
+		case pS_shoot:
+			g.shots_advance();
+			g.shots_hit_row(g.counter);
+			g.shot_cooldown = g.shot_cooldown - 1;
+			g.powerup_remainingTime = g.powerup_remainingTime - 1;
+			break;
+
+		default:
+			break;
+	}
+
+	return state;
+}
+
+/* walls_fill() over the given seeders at a score, each into an empty queue
+   after the wall the one before made */
+template<typename G>
+static void bench_fill(const char* name, unsigned char score, const std::vector<int>& seeders) {
+	G g;
+	g.power_on();
+	g.score = score;
+	bench(name, seeders.size(), [&] {
+		for(size_t k = 0; k < seeders.size(); ++k) {
+			g.seeder = seeders[k];
+			g.wall_count = 0;
+			g.walls_fill();
+		}
+	});
+}
+
+/* A board with every layer in use, for shift() */
+template<typename G>
+static void fill_layers(G& g) {
+	for(int r = 0; r < G::kRows; ++r) {
+		for(int c = 0; c < G::kCols; ++c) {
+			typename G::Row bit = G::bit(c);
+			switch((r + c) % 5) {
+				case kPowerup: g.powerup_rows[r] |= bit; break;
+				case kWall: g.wall_rows[r] |= bit; break;
+				case kPlayer: g.player_rows[r] |= bit; break;
+				case kBullet: g.shot_rows[r] |= bit; break;
+				default: break;
+			}
+		}
+	}
+}
+
+/* shift() and one mW_move step of pattern 3 on another board; the row ops
+   are the same, so per op they should cost what the 8x8 board does */
+template<typename G>
+static void bench_board(const char* geometry) {
+	char name[32];
+	{
+		G g;
+		g.power_on();
+		fill_layers(g);
+		snprintf(name, sizeof(name), "shift/%s", geometry);
+		bench(name, 64, [&] {
+			for(int k = 0; k < 64; ++k) {
+				g.shift();
+			}
+		});
+	}
+
+	const G start = wall_state<G>(3);
+	G g = start;
+	snprintf(name, sizeof(name), "mW_move/%s", geometry);
+	bench(name, G::kTop, [&] {
+		g = start;
+		for(int k = 0; k < G::kTop; ++k) {
+			g.moveWalls(mW_move);
+		}
+	});
+}
+
+/* Seeder values that walls_fill() makes a wall with a powerup from */
+static std::vector<int> spawn_seeders(size_t count) {
+	std::vector<int> seeders;
+	Game g;
+	for(int s = 0; seeders.size() < count; ++s) {
+		g.reset(0);
+		g.seeder = s;
+		g.walls_fill();
+		if(g.wall_spawn[0] != kNoPowerup) {
+			seeders.push_back(s);
+		}
+	}
+	return seeders;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//Baseline comparison
+
+static bool parse_number(const char* line, const char* key, double* out) {
+	const char* p = strstr(line, key);
+	if(!p) {
+		return false;
+	}
+	p += strlen(key);
+	while(*p == '"' || *p == ':' || *p == ' ') {
+		++p;
+	}
+	if(strncmp(p, "null", 4) == 0) {
+		*out = -1.0;
+		return true;
+	}
+	*out = strtod(p, NULL);
+	return true;
+}
+
+static bool load(const char* path, std::vector<Result>& out) {
+	FILE* f = fopen(path, "r");
+	if(!f) {
+		return false;
+	}
+
+	char line[512];
+	while(fgets(line, sizeof(line), f)) {
+		const char* p = strstr(line, "\"name\": \"");
+		if(!p) {
+			continue;
+		}
+		p += strlen("\"name\": \"");
+		const char* end = strchr(p, '"');
+		if(!end) {
+			continue;
+		}
+
+		Result r;
+		snprintf(r.name, sizeof(r.name), "%.*s", (int)(end - p), p);
+		if(parse_number(line, "\"ns_per_op\"", &r.ns_per_op) &&
+			parse_number(line, "\"allocs_per_op\"", &r.allocs_per_op) &&
+			parse_number(line, "\"instructions_per_op\"", &r.instructions_per_op)) {
+			out.push_back(r);
+		}
+	}
+
+	fclose(f);
+	return true;
+}
+
+static bool save(const char* path) {
+	FILE* f = fopen(path, "w");
+	if(!f) {
+		return false;
+	}
+
+	fprintf(f, "{\n  \"schema\": 1,\n  \"benchmarks\": [\n");
+	for(size_t k = 0; k < g_results.size(); ++k) {
+		const Result& r = g_results[k];
+		fprintf(f, "    {\"name\": \"%s\", \"ns_per_op\": %.3f, \"allocs_per_op\": %.3f, \"instructions_per_op\": ",
+			r.name, r.ns_per_op, r.allocs_per_op);
+		if(r.instructions_per_op >= 0) {
+			fprintf(f, "%.1f}", r.instructions_per_op);
+		}
+
+		else {
+			fprintf(f, "null}");
+		}
+		fprintf(f, "%s\n", k + 1 < g_results.size() ? "," : "");
+	}
+	fprintf(f, "  ]\n}\n");
+
+	return fclose(f) == 0;
+}
+
+static int compare(const std::vector<Result>& baseline, double threshold) {
+	int regressions = 0, slower = 0;
+	printf("\n%-32s %10s %10s %8s\n", "benchmark", "base ns", "ns", "change");
+
+	for(size_t k = 0; k < g_results.size(); ++k) {
+		const Result& r = g_results[k];
+		const Result* b = NULL;
+		for(size_t j = 0; j < baseline.size(); ++j) {
+			if(strcmp(baseline[j].name, r.name) == 0) {
+				b = &baseline[j];
+			}
+		}
+		if(!b) {
+			printf("%-32s %10s %10.2f %8s\n", r.name, "-", r.ns_per_op, "new");
+			continue;
+		}
+
+		double change = (r.ns_per_op - b->ns_per_op) / b->ns_per_op;
+		const char* flag = "";
+		if(b->instructions_per_op > 0 && r.instructions_per_op > 0 &&
+			r.instructions_per_op > b->instructions_per_op * 1.02) {
+			flag = "  MORE INSTRUCTIONS";
+		}
+
+		else if(r.allocs_per_op > b->allocs_per_op) {
+			flag = "  MORE ALLOCATIONS";
+		}
+
+		if(*flag) {
+			++regressions;
+		}
+
+		/* Machine dependent, for information only */
+		else if(change > threshold) {
+			flag = "  slower";
+			++slower;
+		}
+		printf("%-32s %10.2f %10.2f %+7.1f%%%s\n", r.name, b->ns_per_op, r.ns_per_op, change * 100, flag);
+	}
+
+	printf("%d regression%s, %d slower by the clock (not checked)\n", regressions,
+		regressions == 1 ? "" : "s", slower);
+	return regressions ? 1 : 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+int main(int argc, char** argv) {
+	const char* json = NULL;
+	const char* baseline_path = NULL;
+	double threshold = 0.25;
+
+	for(int a = 1; a < argc; ++a) {
+		if(strcmp(argv[a], "--json") == 0 && a + 1 < argc) {
+			json = argv[++a];
+		}
+
+		else if(strcmp(argv[a], "--compare") == 0 && a + 1 < argc) {
+			baseline_path = argv[++a];
+		}
+
+		else if(strcmp(argv[a], "--threshold") == 0 && a + 1 < argc) {
+			threshold = strtod(argv[++a], NULL) / 100.0;
+		}
+
+		else if(strcmp(argv[a], "--filter") == 0 && a + 1 < argc) {
+			g_filter = argv[++a];
+		}
+
+		else {
+			fprintf(stderr, "usage: escalade_bench [--filter text] [--json out.json] "
+				"[--compare baseline.json [--threshold percent]]\n");
+			return 2;
+		}
+	}
+
+	std::vector<Result> baseline;
+	if(baseline_path && !load(baseline_path, baseline)) {
+		fprintf(stderr, "cannot read %s\n", baseline_path);
+		return 2;
+	}
+
+	if(!g_counter.available()) {
+		printf("perf counters unavailable, instructions not measured\n");
+	}
+
+	/* shift(): composite one display row, over a board using every layer */
+	{
+		Game g;
+		g.power_on();
+		fill_layers(g);
+		bench("shift", 64, [&] {
+			for(int k = 0; k < 64; ++k) {
+				g.shift();
+			}
+		});
+	}
+
+	/* mW_move: one wall step, per pattern. A batch walks the wall from the
+	   top row to row 0 and restores the state, so 1/kTop of a Game copy is
+	   included. */
+	for(int n = 1; n <= 10; ++n) {
+		const Game start = wall_state(n);
+		Game g = start;
+		char name[32];
+		snprintf(name, sizeof(name), "mW_move/pattern_%d", n);
+		bench(name, Game::kTop, [&] {
+			g = start;
+			for(int k = 0; k < Game::kTop; ++k) {
+				g.moveWalls(mW_move);
+			}
+		});
+	}
+
+	/* Both of the above on a 16x16 board and on 32 columns by 8 rows */
+	bench_board<BasicGame<16, 16>>("16x16");
+	bench_board<BasicGame<8, 32>>("32x8");
+
+	/* mW_generate: taking a queued wall, row cleanup and placing its
+	   powerup, a full queue of walls from consecutive seeders and then of
+	   walls that all carry a powerup */
+	{
+		std::vector<int> spawns = spawn_seeders(kWallQueue);
+		Game plain;
+		Game spawning;
+		plain.power_on();
+		spawning.power_on();
+		for(int k = 0; k < kWallQueue; ++k) {
+			plain.walls_fill();
+			spawning.seeder = spawns[k];
+			spawning.walls_fill();
+		}
+
+		for(int v = 0; v < 2; ++v) {
+			const Game start = v ? spawning : plain;
+			Game g = start;
+			bench(v ? "mW_generate/powerup_spawn" : "mW_generate", kWallQueue, [&] {
+				g = start;
+				for(int k = 0; k < kWallQueue; ++k) {
+					g.moveWalls(mW_wait);
+				}
+			});
+		}
+	}
+
+	/* walls_fill: drawing a wall, the passability search and the powerup
+	   roll, done in the idle slack of a tick. At score 0 over consecutive
+	   seeders and over seeders that spawn a powerup, then at score 59, where
+	   walls have one opening and the search is longest, and on 32 columns,
+	   where some draws fail it */
+	{
+		std::vector<int> seeders(64);
+		for(int k = 0; k < 64; ++k) {
+			seeders[k] = k;
+		}
+		bench_fill<Game>("walls_fill", 0, seeders);
+		bench_fill<Game>("walls_fill/powerup_spawn", 0, spawn_seeders(64));
+		bench_fill<Game>("walls_fill/score_59", 59, seeders);
+		bench_fill<BasicGame<8, 32>>("walls_fill/score_59/32x8", 59, seeders);
+	}
+
+	/* walls_fill() streaming the walls of level 1 out of kLevelData */
+	if(kLevelCount > 0) {
+		Game g;
+		g.power_on();
+		bench("walls_fill/level", kWinScore, [&] {
+			g.play_level(1);
+			for(int k = 0; k < kWinScore; ++k) {
+				g.wall_count = 0;
+				g.walls_fill();
+			}
+		});
+	}
+
+	/* powerupShooting: six shot steps through pattern 10 (every other column
+	   a wall), with one shot in flight and with one in each of rows 1-7.
+	   Shots move as row bitboards, so both should cost about the same. */
+	for(int n = 1; n <= 7; n += 6) {
+		Game start = wall_state(10);
+		for(int k = 0; k < n; ++k) {
+			start.shots_advance();
+			start.shots_fire(k);
+		}
+
+		Game g = start;
+		char name[32];
+		snprintf(name, sizeof(name), "shots_advance/%d_shot%s", n, n > 1 ? "s" : "");
+		bench(name, 6, [&] {
+			g = start;
+			for(int k = 0; k < 6; ++k) {
+				g.shots_advance();
+				g.shots_hit_row(g.counter);
+			}
+		});
+	}
+
+	/* powerupShooting as a protothread against the old switch version: 64
+	   ticks waiting for a powerup, the dispatch alone, and a whole powerup
+	   from the pickup, which has to leave both games the same */
+	{
+		Game start = wall_state(10);
+		start.powerup_activated = 0x00;
+
+		Game g = start;
+		int state = (signed char)g.powerupShooting(PT_START);
+		bench("powerupShooting/wait/pt", 64, [&] {
+			for(int k = 0; k < 64; ++k) {
+				state = g.powerupShooting(state);
+			}
+		});
+
+		g = start;
+		state = powerupShooting_switch(g, pS_init);
+		bench("powerupShooting/wait/switch", 64, [&] {
+			for(int k = 0; k < 64; ++k) {
+				state = powerupShooting_switch(g, state);
+			}
+		});
+
+		const int ticks = kShotSteps + 3;
+		Game by_pt = start;
+		Game by_switch = start;
+		bench("powerupShooting/powerup/pt", ticks, [&] {
+			by_pt = start;
+			by_pt.powerup_pickup(by_pt.width);
+			int st = PT_START;
+			for(int k = 0; k < ticks; ++k) {
+				st = by_pt.powerupShooting(st);
+			}
+		});
+		bench("powerupShooting/powerup/switch", ticks, [&] {
+			by_switch = start;
+			by_switch.powerup_pickup(by_switch.width);
+			int st = pS_init;
+			for(int k = 0; k < ticks; ++k) {
+				st = powerupShooting_switch(by_switch, st);
+			}
+		});
+
+		if(memcmp(&by_pt, &by_switch, sizeof(Game)) != 0) {
+			fprintf(stderr, "powerupShooting: the protothread and switch versions differ\n");
+			return 1;
+		}
+	}
+
+	/* moveObject: one step of the player, alternating right and left */
+	{
+		Game g;
+		g.power_on();
+		bench("moveObject", 64, [&] {
+			for(int k = 0; k < 64; ++k) {
+				g.bus_publish(kBusMove, (unsigned char)(1 + (k & 1)));
+				g.moveObject(mO_wait);
+			}
+		});
+	}
+
+	/* One simulated second of the whole main loop in mid-game, replaying
+	   thumbstick input recorded from the bot so the player survives */
+	{
+		Game start;
+		start.reset(7);
+		Bot bot;
+		Input in;
+		while(start.playing() && start.score < 10) {
+			if(ticks_until_sample(start) == 0) {
+				in.stick_x = stick_for(bot.decide(start));
+			}
+			start.tick(in);
+		}
+
+		std::vector<uint16_t> sticks(1000);
+		Game g = start;
+		for(size_t t = 0; t < sticks.size(); ++t) {
+			if(ticks_until_sample(g) == 0) {
+				in.stick_x = stick_for(bot.decide(g));
+			}
+			sticks[t] = in.stick_x;
+			g.tick(in);
+		}
+
+		bench("game_second", 1, [&] {
+			g = start;
+			Input replay;
+			for(size_t t = 0; t < sticks.size(); ++t) {
+				replay.stick_x = sticks[t];
+				g.tick(replay);
+			}
+		});
+	}
+
+	if(json && !save(json)) {
+		fprintf(stderr, "cannot write %s\n", json);
+		return 2;
+	}
+
+	return baseline_path ? compare(baseline, threshold) : 0;
+}
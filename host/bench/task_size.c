@@ -0,0 +1,97 @@
+// powerupShooting of main.c, a protothread (pt.h), against the transition
+// and action switches it was before, so that make task-size can compare their
+// code size on the AVR. main.c is compiled in as it is, with main renamed by
+// the Makefile, so the protothread measured is the one the firmware runs.
+// escalade_bench times the two on the host (powerupShooting/*).
+
+////////////////////////////////////////////////////////////////////////////////
+
+#include "main.c"
+
+enum powerupShooting_States {pS_init, pS_wait, pS_generate, pS_shoot};
+int powerupShooting_switch(int state) {
+	unsigned char col;
+	
+	switch(state) {
+		case pS_init:
+			state = pS_wait;
+			break;
+		
+		case pS_wait:
+			if(bus_take(BUS_SUB_POWERUP, &col) != BUS_EMPTY) {
+				state = pS_generate;
+				game.powerup_remainingTime = SHOT_STEPS;
+				game.shot_cooldown = 0;
+			}
+			
+			else {
+				state = pS_wait;
+			}
+			
+			break;
+			
+		case pS_generate:
+			if(game.powerup_remainingTime > 0) {
+				state = (game.shot_cooldown == 0) ? pS_generate : pS_shoot;
+			}
+			
+			if(game.powerup_remainingTime == 0) {
+				state = pS_wait;
+				game.powerup_activated = 0x00;
+				shots_clear();
+				TELEMETRY_EVENT(TELEMETRY_POWERUP_EXPIRE, 0);
+			}
+			
+			break;
+		
+		case pS_shoot:
+			if(game.shot_cooldown == 0 || game.powerup_remainingTime == 0) {
+				state = pS_generate;
+			}
+			
+			else {
+				state = pS_shoot;
+			}
+			
+			break;
+			
+		default:
+			break;
+	}
+	
+	switch(state) {
+		case pS_init:
+			break;
+			
+		case pS_wait:
+			break;
+			
+		case pS_generate:
+			shots_advance();
+			if(game.powerup_remainingTime > 0) {
+				/* A volley from the player's column, SHOT_SPREAD wide each side */
+				for(int c = game.width - SHOT_SPREAD; c <= game.width + SHOT_SPREAD; ++c) {
+					if(c >= 0 && c < BOARD_COLS) {
+						shots_fire(c);
+					}
+				}
+				game.shot_cooldown = SHOT_INTERVAL - 1;
+				game.powerup_remainingTime = game.powerup_remainingTime - 1;
+			}
+			shots_hit_row(game.counter);
+			
+			break;
+			
+		case pS_shoot:
+			shots_advance();
+			shots_hit_row(game.counter);
+			game.shot_cooldown = game.shot_cooldown - 1;
+			game.powerup_remainingTime = game.powerup_remainingTime - 1;
+			break;
+			
+		default:
+			break;
+	}
+	
+	return state;
+}
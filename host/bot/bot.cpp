@@ -0,0 +1,393 @@
+// Lookahead autoplayer and wall survivability oracle for the host game port.
+
+////////////////////////////////////////////////////////////////////////////////
+
+#include "bot.h"
+
+#include <chrono>
+
+namespace escalade {
+
+namespace {
+
+const int kMaxEvents = 128;
+const int kMaxMoves = kMaxEvents;
+
+enum EventKind : uint8_t { kSample, kArrive, kGenerate, kWin };
+
+typedef Game::Row Row;
+
+inline Row rotl(Row m) { return (Row)((m << 1) | (m >> (Game::kCols - 1))); }
+inline Row rotr(Row m) { return (Row)((m >> 1) | (m << (Game::kCols - 1))); }
+
+/* Columns reachable in one move, wrapping like moveObject */
+inline Row spread(Row m) { return rotl(m) | rotr(m); }
+
+inline int popcount(Row m) { return __builtin_popcountll(m); }
+
+////////////////////////////////////////////////////////////////////////////////
+//The parts of run_tasks() that decide when the thumbstick is read and when
+//walls move, stepped without running the game. moveObject shares getMovement's
+//period and phase in main(), so a sample is also the tick the player moves.
+struct Schedule {
+	uint32_t gm_next, gm_period;
+	signed char gm_state;
+	uint32_t mw_next, mw_period;
+	signed char mw_state;
+	unsigned char counter;
+	unsigned char score;
+	bool speedup;  /* random walls: faster at a score of 20 and 40 */
+	unsigned char periods[kWallQueue]; /* of the queued walls, see walls_take() */
+	int taken, queued;
+
+	/* Advances to the next tick that matters to the player */
+	EventKind next() {
+		while(1) {
+			/* getMovement runs before moveWalls within a tick */
+			if(gm_next <= mw_next) {
+				gm_state = (gm_state == wait) ? x_axis : wait;
+				gm_next += gm_period;
+				if(gm_state == x_axis) {
+					return kSample;
+				}
+				continue;
+			}
+
+			int kind = -1;
+			switch(mw_state) {
+				case mW_init:
+					mw_state = mW_wait;
+					break;
+
+				case mW_wait:
+					mw_state = mW_generate;
+					counter = Game::kTop;
+					kind = kGenerate;
+					break;
+
+				case mW_generate:
+					mw_state = mW_move;
+					--counter;
+					break;
+
+				case mW_move:
+					if(counter == 0) {
+						++score;
+						mw_state = mW_generate;
+						counter = Game::kTop;
+						kind = (score >= kWinScore) ? kWin : kGenerate;
+					}
+
+					else if(--counter == 0) {
+						kind = kArrive;
+					}
+					break;
+
+				default:
+					break;
+			}
+
+			/* A new wall brings its level's period with it */
+			if((kind == kGenerate || kind == kWin) && taken < queued) {
+				unsigned char period = periods[taken++];
+				if(period) {
+					mw_period = period;
+				}
+			}
+
+			if(speedup) {
+				if(score == 20) {
+					mw_period = 150;
+				}
+
+				else if(score == 40) {
+					mw_period = 100;
+				}
+			}
+			mw_next += mw_period;
+
+			if(kind >= 0) {
+				return (EventKind)kind;
+			}
+		}
+	}
+};
+
+Schedule schedule_of(const Game& g) {
+	const Task& gm = g.tasks[kGetMovement];
+	const Task& mw = g.tasks[kMoveWalls];
+
+	Schedule s;
+	s.gm_next = gm.period - gm.elapsedTime;
+	s.gm_period = gm.period;
+	s.gm_state = gm.state;
+	s.mw_next = mw.period - mw.elapsedTime;
+	s.mw_period = mw.period;
+	s.mw_state = mw.state;
+	s.counter = g.counter;
+	s.score = g.score;
+	s.speedup = (g.level == 0);
+	s.taken = 0;
+	s.queued = g.wall_count;
+	for(int k = 0; k < g.wall_count; ++k) {
+		s.periods[k] = g.wall_period[(g.wall_head + k) % kWallQueue];
+	}
+	return s;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//Everything a decision needs, built once and then replayed per action
+struct Lookahead {
+	uint8_t events[kMaxEvents];
+	int count;
+	bool truncated;
+
+	int width;
+	Row block;         /* row 0 wall cells the player cannot move into now */
+	bool has_current;  /* a generated wall still has to reach row 0 */
+	Row current;       /* its solid columns */
+	Row next[kMaxMoves + 2]; /* next wall pattern after m moves */
+};
+
+void build(const Game& g, uint32_t max_events, Lookahead& la) {
+	Schedule s = schedule_of(g);
+
+	la.width = g.width;
+	la.block = 0;
+	la.has_current = false;
+	la.current = 0;
+
+	bool on_board = (g.tasks[kMoveWalls].state == mW_generate || g.tasks[kMoveWalls].state == mW_move);
+	if(on_board && g.counter == 0) {
+		la.block = g.wall_rows[0];
+	}
+
+	else if(on_board) {
+		/* Holes already punched stay open, see move_walls */
+		Row mask = g.wall;
+		la.has_current = true;
+		la.current = mask & (Row)~g.pos & g.occupied(g.counter);
+	}
+
+	if(max_events > (uint32_t)kMaxEvents) {
+		max_events = kMaxEvents;
+	}
+
+	int arrivals = la.has_current ? 2 : 1;
+	int samples = 0;
+	bool generated = false;
+	la.count = 0;
+	la.truncated = true;
+	while(la.count < (int)max_events) {
+		EventKind kind = s.next();
+		la.events[la.count++] = kind;
+		if(kind == kSample && !generated) {
+			++samples;
+		}
+
+		else if(kind == kGenerate) {
+			generated = true;
+		}
+
+		else if(kind == kWin || (kind == kArrive && --arrivals == 0)) {
+			la.truncated = false;
+			break;
+		}
+	}
+
+	/* The next wall is the oldest in the queue whatever the moves. The queue
+	   is only empty in the first ticks after a restart, before the first
+	   wall; walls.h makes that one passable from any column. */
+	Row next = g.wall_count > 0 ? stretch<Game::kCols>(g.wall_next[g.wall_head]) : 0;
+	for(int m = 0; m <= samples; ++m) {
+		la.next[m] = next;
+	}
+}
+
+/* Number of (move count, column) states alive at the end of the lookahead
+   when first is held until the next sample */
+uint32_t survivors(const Lookahead& la, Action first, uint64_t& nodes) {
+	Row reach[kMaxMoves + 2] = {0};
+	reach[0] = Game::bit(la.width);
+	int top = 0;
+	bool counting = true;
+	bool sampled = false;
+	bool current_pending = la.has_current;
+	Row block = la.block;
+
+	for(int e = 0; e < la.count; ++e) {
+		switch(la.events[e]) {
+			case kSample:
+				if(!sampled) {
+					sampled = true;
+					if(first != kStay) {
+						Row to = (first == kLeft) ? rotl(reach[0]) : rotr(reach[0]);
+						reach[0] = 0;
+						reach[counting ? 1 : 0] = to & (Row)~block;
+						top = counting ? 1 : 0;
+					}
+					++nodes;
+				}
+
+				else if(counting) {
+					for(int m = top; m >= 0; --m) {
+						reach[m + 1] |= spread(reach[m]) & (Row)~block;
+					}
+					if(top < kMaxMoves) {
+						++top;
+					}
+					nodes += top + 1;
+				}
+
+				else {
+					for(int m = 0; m <= top; ++m) {
+						reach[m] |= spread(reach[m]) & (Row)~block;
+					}
+					nodes += top + 1;
+				}
+				break;
+
+			case kArrive:
+				if(current_pending) {
+					for(int m = 0; m <= top; ++m) {
+						reach[m] &= (Row)~la.current;
+					}
+					block = la.current;
+					current_pending = false;
+				}
+
+				else {
+					for(int m = 0; m <= top; ++m) {
+						reach[m] &= (Row)~la.next[m];
+					}
+				}
+				nodes += top + 1;
+				break;
+
+			case kGenerate:
+				/* Moves from here on no longer change the next pattern */
+				block = 0;
+				counting = false;
+				break;
+
+			default:
+				break;
+		}
+	}
+
+	uint32_t alive = 0;
+	for(int m = 0; m <= top; ++m) {
+		alive += popcount(reach[m]);
+	}
+	return alive;
+}
+
+} // namespace
+
+uint32_t ticks_until_sample(const Game& g) {
+	const Task& gm = g.tasks[kGetMovement];
+	uint32_t next = gm.period - gm.elapsedTime;
+	return (gm.state == wait) ? next : next + gm.period;
+}
+
+Action Bot::decide(const Game& g) {
+	if(!g.playing()) {
+		return kStay;
+	}
+
+	std::chrono::steady_clock::time_point start;
+	if(config_.timed) {
+		start = std::chrono::steady_clock::now();
+	}
+
+	Lookahead la;
+	build(g, config_.max_events, la);
+
+	uint64_t nodes = 0;
+	uint32_t stay = survivors(la, kStay, nodes);
+	uint32_t right = survivors(la, kRight, nodes);
+	uint32_t left = survivors(la, kLeft, nodes);
+
+	Action move = (left > right) ? kLeft : kRight;
+	uint32_t moved = (left > right) ? left : right;
+
+	Action choice;
+	if(config_.prefer_move) {
+		choice = (moved > 0 || stay == 0) ? move : kStay;
+	}
+
+	else {
+		choice = (stay > 0 || moved == 0) ? kStay : move;
+	}
+
+	++stats_.decisions;
+	stats_.nodes += nodes;
+	if(nodes > stats_.max_nodes) {
+		stats_.max_nodes = nodes;
+	}
+	if(la.truncated) {
+		++stats_.truncated;
+	}
+
+	if(config_.timed) {
+		uint64_t ns = (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+			std::chrono::steady_clock::now() - start).count();
+		stats_.ns_total += ns;
+		if(ns > stats_.ns_max) {
+			stats_.ns_max = ns;
+		}
+	}
+
+	return choice;
+}
+
+Survival check_survivable(const Game::Row* masks, size_t count, uint32_t period,
+	int start_width) {
+	/* Schedule right after the restart block */
+	Schedule s;
+	s.gm_next = 0;
+	s.gm_period = kTaskPeriods[kGetMovement];
+	s.gm_state = init;
+	s.mw_next = 0;
+	s.mw_period = period;
+	s.mw_state = mW_init;
+	s.counter = Game::kTop;
+	s.score = 0;
+	s.speedup = false;
+	s.taken = 0;
+	s.queued = 0;
+
+	Survival result = {true, 0, 0};
+	Row reach = Game::bit(start_width);
+	Row block = 0;
+
+	while(result.walls_passed < count) {
+		switch(s.next()) {
+			case kSample:
+				reach |= spread(reach) & (Row)~block;
+				break;
+
+			case kArrive:
+				block = masks[result.walls_passed];
+				reach &= (Row)~block;
+				if(reach == 0) {
+					result.survivable = false;
+					return result;
+				}
+				++result.walls_passed;
+				break;
+
+			case kGenerate:
+				block = 0;
+				break;
+
+			default:
+				break;
+		}
+		++result.nodes;
+	}
+
+	return result;
+}
+
+} // namespace escalade
@@ -0,0 +1,82 @@
+// Lookahead autoplayer and wall survivability oracle for the host game port.
+
+////////////////////////////////////////////////////////////////////////////////
+
+#ifndef ESCALADE_BOT_H
+#define ESCALADE_BOT_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "../sim/game.h"
+
+namespace escalade {
+
+////////////////////////////////////////////////////////////////////////////////
+//max_events  - lookahead budget per decision, counted in thumbstick samples,
+//              wall moves and wall generations. Bounds the search cost.
+//prefer_move - move whenever a move is as safe as staying. Off plays calmly;
+//              on turns the bot into a worst-case load generator that drives
+//              moveObject and the seeder on every sample.
+//timed       - measure wall-clock time per decision into BotStats.
+struct BotConfig {
+	uint32_t max_events = 64;
+	bool prefer_move = false;
+	bool timed = true;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+//nodes counts reachable-column mask updates, one per move count per event, so
+//it is the search cost independent of the machine it runs on.
+struct BotStats {
+	uint64_t decisions = 0;
+	uint64_t nodes = 0;
+	uint64_t max_nodes = 0;
+	uint64_t truncated = 0; /* decisions that ran out of max_events */
+	uint64_t ns_total = 0;
+	uint64_t ns_max = 0;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+//Picks left/right/stay for the next getMovement sample by exact dynamic
+//programming over the set of reachable columns (a Game::Row, wrapping at the
+//first and last column like moveObject) up to the arrival of the next wall that has
+//not been generated yet, which is the oldest in the wall queue (walls.h). The
+//search keeps one column mask per move count, from when that wall depended on
+//the moves made before it. Bullets only ever open walls, so they are ignored
+//and the bot stays on the safe side.
+//
+//The action is held from now until the sample, see ticks_until_sample().
+class Bot {
+public:
+	explicit Bot(const BotConfig& config = BotConfig()) : config_(config) {}
+
+	Action decide(const Game& g);
+
+	const BotStats& stats() const { return stats_; }
+	void reset_stats() { stats_ = BotStats(); }
+
+private:
+	BotConfig config_;
+	BotStats stats_;
+};
+
+/* Ticks until getMovement next reads the thumbstick, 0 = the next tick() */
+uint32_t ticks_until_sample(const Game& g);
+
+////////////////////////////////////////////////////////////////////////////////
+//Oracle: can a player starting at start_width after a restart get through the
+//walls masks[0..count) (bit n = column n) with moveWalls running at a fixed
+//period? Ignores the seeder, powerups and the score speed-ups.
+struct Survival {
+	bool survivable;
+	size_t walls_passed;
+	uint64_t nodes;
+};
+
+Survival check_survivable(const Game::Row* masks, size_t count, uint32_t period,
+	int start_width = Game::kStartCol);
+
+} // namespace escalade
+
+#endif //ESCALADE_BOT_H
@@ -0,0 +1,71 @@
+// Batched reinforcement learning environment over the host game port.
+
+////////////////////////////////////////////////////////////////////////////////
+
+#include "vec_env.h"
+
+#include <string.h>
+
+namespace escalade {
+
+VecEnv::VecEnv(size_t num_envs, const EnvConfig& config)
+	: config_(config), games_(num_envs), seeds_(num_envs, 0) {
+	for(size_t e = 0; e < num_envs; ++e) {
+		games_[e].reset(0);
+	}
+}
+
+void VecEnv::write_obs(size_t env) {
+	const Game& g = games_[env];
+	uint8_t* obs = buffers_.obs + env * kObsSize;
+	g.compose(reinterpret_cast<int8_t (*)[Game::kCols]>(obs));
+	obs[kObsCells] = g.powerup_remainingTime;
+}
+
+void VecEnv::reset(const uint16_t* seeds) {
+	for(size_t e = 0; e < games_.size(); ++e) {
+		seeds_[e] = seeds[e];
+		games_[e].reset(seeds[e]);
+		write_obs(e);
+		buffers_.rewards[e] = 0.0f;
+		buffers_.dones[e] = 0;
+	}
+}
+
+void VecEnv::step(const uint8_t* actions) {
+	const uint16_t stride = (uint16_t)games_.size();
+
+	for(size_t e = 0; e < games_.size(); ++e) {
+		Game& g = games_[e];
+		Input in;
+		in.stick_x = stick_for((Action)actions[e]);
+
+		unsigned char score = g.score;
+		for(uint32_t t = 0; t < config_.ticks_per_step && g.playing(); ++t) {
+			g.tick(in);
+		}
+
+		float reward = (float)(g.score - score);
+		uint8_t done = 0;
+
+		/* The tick that ends a game only runs the tasks; the next one
+		   enters the end screen, so both game_over and score are final */
+		if(!g.playing()) {
+			if(g.game_over == 0x01) {
+				reward -= config_.death_penalty;
+			}
+			if(buffers_.final_scores) {
+				buffers_.final_scores[e] = g.score;
+			}
+			done = 1;
+			seeds_[e] = (uint16_t)(seeds_[e] + stride);
+			g.reset(seeds_[e]);
+		}
+
+		buffers_.rewards[e] = reward;
+		buffers_.dones[e] = done;
+		write_obs(e);
+	}
+}
+
+} // namespace escalade
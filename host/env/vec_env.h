@@ -0,0 +1,79 @@
+// Batched reinforcement learning environment over the host game port.
+
+////////////////////////////////////////////////////////////////////////////////
+
+#ifndef ESCALADE_VEC_ENV_H
+#define ESCALADE_VEC_ENV_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <vector>
+
+#include "../sim/game.h"
+
+namespace escalade {
+
+/* Observation layout: Game::compose() row-major, then powerup_remainingTime */
+const size_t kObsCells = Game::kRows * Game::kCols;
+const size_t kObsSize = kObsCells + 1;
+
+////////////////////////////////////////////////////////////////////////////////
+//ticks_per_step - 1 ms game ticks an action is held for. 90 is one full
+//                 getMovement wait/x_axis cycle, so every step is sampled once.
+//death_penalty  - subtracted from the reward of the step the player dies in.
+//                 Every wall passed (score + 1) is worth 1.
+struct EnvConfig {
+	uint32_t ticks_per_step = 90;
+	float death_penalty = 1.0f;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+//Caller owned output arrays, num_envs entries each (obs is num_envs * kObsSize
+//bytes). They are written in place by every reset() and step() and never
+//reallocated. final_scores is optional and receives the score of an episode
+//on the step it ends.
+struct EnvBuffers {
+	uint8_t* obs = nullptr;
+	float* rewards = nullptr;
+	uint8_t* dones = nullptr;
+	uint8_t* final_scores = nullptr;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+//A batch of independent games stepped together. All memory is allocated by the
+//constructor; reset() and step() only touch the games and the bound buffers.
+//
+//An episode ends when the game reaches the game over or win screen. The env is
+//then reset in place with its next seed (seed + num_envs, so consecutive
+//starting seeds never collide) and the observation written for that step is
+//the first one of the new episode, with dones[i] = 1.
+class VecEnv {
+public:
+	explicit VecEnv(size_t num_envs, const EnvConfig& config = EnvConfig());
+
+	size_t size() const { return games_.size(); }
+	const EnvConfig& config() const { return config_; }
+
+	void bind(const EnvBuffers& buffers) { buffers_ = buffers; }
+
+	/* seeds[num_envs] become each game's starting seeder value */
+	void reset(const uint16_t* seeds);
+	/* actions[num_envs] of Action, anything else is kStay */
+	void step(const uint8_t* actions);
+
+	const Game& game(size_t env) const { return games_[env]; }
+	uint16_t seed(size_t env) const { return seeds_[env]; }
+
+private:
+	void write_obs(size_t env);
+
+	EnvConfig config_;
+	EnvBuffers buffers_;
+	std::vector<Game> games_;
+	std::vector<uint16_t> seeds_;
+};
+
+} // namespace escalade
+
+#endif //ESCALADE_VEC_ENV_H
@@ -0,0 +1,66 @@
+// Scripted player for the firmware harnesses.
+
+////////////////////////////////////////////////////////////////////////////////
+
+#include "driver.h"
+
+namespace escalade {
+
+namespace {
+
+BotConfig untimed() {
+	BotConfig config;
+	config.timed = false;
+	return config;
+}
+
+} // namespace
+
+Driver::Driver(uint16_t seed)
+	: state_(0x9E3779B97F4A7C15ull ^ ((uint64_t)seed << 17)), bot_(untimed()) {}
+
+uint64_t Driver::random() {
+	state_ ^= state_ << 13;
+	state_ ^= state_ >> 7;
+	state_ ^= state_ << 17;
+	return state_;
+}
+
+void Driver::press() {
+	in_.button = true;
+	held_ = (uint32_t)(random() % 60);
+}
+
+Input Driver::next(const Game& g) {
+	if(held_ > 0) {
+		--held_;
+		return in_;
+	}
+	in_.button = false;
+
+	if(g.finished()) {
+		/* Up to 5 s, long enough for the face and a whole score scroll */
+		if(end_delay_ == 0) {
+			end_delay_ = 100 + (uint32_t)(random() % 4900);
+		}
+
+		if(--end_delay_ == 0) {
+			press();
+		}
+		return in_;
+	}
+
+	if(random() % 200000 == 0) {
+		press();
+		return in_;
+	}
+
+	if(g.playing() && ticks_until_sample(g) == 0) {
+		uint64_t r = random();
+		Action a = (r % 512 == 0) ? (Action)((r >> 8) % 3) : bot_.decide(g);
+		in_.stick_x = stick_for(a);
+	}
+	return in_;
+}
+
+} // namespace escalade
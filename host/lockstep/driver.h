@@ -0,0 +1,39 @@
+// Scripted player for the firmware harnesses: the lookahead bot with random
+// mistakes and button presses mixed in.
+
+////////////////////////////////////////////////////////////////////////////////
+
+#ifndef ESCALADE_DRIVER_H
+#define ESCALADE_DRIVER_H
+
+#include <stdint.h>
+
+#include "../bot/bot.h"
+
+namespace escalade {
+
+//Bot input with mistakes: a random action on 1 in 512 samples, a mid-game
+//button press every few minutes, and a restart 0.1 to 2 s into an end screen.
+//Deterministic per seed, so runs cover wins, deaths, restarts and all three
+//speeds reproducibly.
+class Driver {
+public:
+	explicit Driver(uint16_t seed);
+
+	/* Input for the next tick of g */
+	Input next(const Game& g);
+
+private:
+	void press();
+	uint64_t random();
+
+	uint64_t state_;
+	Bot bot_;
+	Input in_;
+	uint32_t held_ = 0;
+	uint32_t end_delay_ = 0;
+};
+
+} // namespace escalade
+
+#endif
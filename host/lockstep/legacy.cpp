@@ -0,0 +1,278 @@
+// Runs ../main.c, compiled against shim/regs.h, as a coroutine of the harness.
+
+////////////////////////////////////////////////////////////////////////////////
+
+#include "legacy.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ucontext.h>
+
+#include <vector>
+
+#define LOCKSTEP_HARNESS
+#include "shim/regs.h"
+
+/* Globals of main.c. Only the types are taken from game_state.h: included in
+   extern "C" it would clash with main.c over findGCD() from scheduler.h. */
+#include "../../game_state.h"
+
+extern "C" {
+void TIMER1_COMPA_vect(void);
+void TIMER1_COMPB_vect(void);
+extern unsigned short highscore_games;
+extern unsigned short highscore_wins;
+extern unsigned char highscore_best;
+
+int legacy_main(void);
+
+/* Only in firmware built with -DTELEMETRY */
+void USART0_UDRE_vect(void) __attribute__((weak));
+void EE_READY_vect(void) __attribute__((weak));
+}
+
+namespace {
+
+ucontext_t harness_ctx, firmware_ctx;
+char firmware_stack[1 << 16];
+bool booted = false;
+
+uint16_t stick = escalade::kStickCenter;
+bool button = false;
+uint8_t adcsra = 0;
+escalade::AvrRand rng;
+
+/* 38400 baud 8N1 is 3.84 bytes per ms, counted in hundredths */
+const uint32_t kUartBytesPerTick = 384;
+uint32_t uart_credit = 0;
+std::vector<uint8_t> uart_bytes;
+
+void drain_uart() {
+	uart_credit += kUartBytesPerTick;
+	while(uart_credit >= 100) {
+		if(!USART0_UDRE_vect || !(UCSR0B & (1 << UDRIE0))) {
+			/* The line idles, nothing to catch up on later */
+			uart_credit = 0;
+			return;
+		}
+
+		UDR0 = 0xFFFF;
+		USART0_UDRE_vect();
+		if(UDR0 <= 0xFF) {
+			uart_bytes.push_back((uint8_t)UDR0);
+			uart_credit -= 100;
+		}
+	}
+}
+
+/* 3.4 ms per byte */
+const uint32_t kEepromWriteTicks = 4;
+uint8_t eeprom_image[escalade::legacy::kEepromSize];
+uint8_t eedr = 0;
+uint32_t eeprom_busy = 0;
+uint64_t eeprom_reads = 0;
+uint32_t eeprom_writes[escalade::legacy::kEepromSize];
+
+struct EepromErase {
+	EepromErase() { memset(eeprom_image, 0xFF, sizeof(eeprom_image)); }
+} eeprom_erase;
+
+void drain_eeprom() {
+	if(EECR & (1 << EEPE)) {
+		if(++eeprom_busy < kEepromWriteTicks) {
+			return;
+		}
+		eeprom_image[EEAR % escalade::legacy::kEepromSize] = eedr;
+		++eeprom_writes[EEAR % escalade::legacy::kEepromSize];
+		EECR &= (uint8_t)~(1 << EEPE);
+		eeprom_busy = 0;
+	}
+
+	if(EE_READY_vect && (EECR & (1 << EERIE))) {
+		EE_READY_vect();
+	}
+}
+
+void firmware_entry() {
+	legacy_main();
+	fprintf(stderr, "legacy main() returned\n");
+	abort();
+}
+
+} // namespace
+
+extern "C" {
+
+volatile uint8_t PORTA, PORTB, PORTC, PORTD;
+volatile uint8_t DDRA, DDRB, DDRC, DDRD;
+volatile uint8_t ADMUX, SREG, TIMSK1, TIFR1, TCCR1B, TCCR3A, TCCR3B;
+volatile uint16_t OCR1A, OCR1B, TCNT1, OCR3A, TCNT3;
+volatile uint8_t TCNT1L;
+volatile uint8_t UCSR0A, UCSR0B, UCSR0C;
+volatile uint16_t UBRR0, UDR0;
+volatile uint8_t EECR;
+volatile uint16_t EEAR;
+
+/* Conversions complete instantly */
+volatile uint8_t* lockstep_adcsra(void) {
+	adcsra |= (uint8_t)(1 << ADIF);
+	adcsra &= (uint8_t)~(1 << ADSC);
+	return &adcsra;
+}
+
+uint16_t lockstep_adc(void) {
+	return stick;
+}
+
+/* The button read ends the tick; it returns the next tick's input */
+uint8_t lockstep_pinb(void) {
+	swapcontext(&firmware_ctx, &harness_ctx);
+	return button ? (uint8_t)~0x02 : 0xFF;
+}
+
+volatile uint8_t* lockstep_eedr(void) {
+	if(EECR & (1 << EERE)) {
+		eedr = eeprom_image[EEAR % escalade::legacy::kEepromSize];
+		EECR &= (uint8_t)~(1 << EERE);
+		++eeprom_reads;
+	}
+	return &eedr;
+}
+
+void eeprom_read_block(void* dst, const void* src, size_t n) {
+	uintptr_t addr = (uintptr_t)src;
+	for(size_t k = 0; k < n; ++k) {
+		((uint8_t*)dst)[k] = eeprom_image[(addr + k) % escalade::legacy::kEepromSize];
+	}
+	++eeprom_reads;
+}
+
+int lockstep_rand(void) {
+	return rng.rand();
+}
+
+void lockstep_srand(unsigned int seed) {
+	rng.seed((uint16_t)seed);
+}
+
+}
+
+namespace escalade {
+
+bool Snapshot::operator==(const Snapshot& o) const {
+	return memcmp(wall_rows, o.wall_rows, sizeof(wall_rows)) == 0 &&
+		memcmp(powerup_rows, o.powerup_rows, sizeof(powerup_rows)) == 0 &&
+		memcmp(player_rows, o.player_rows, sizeof(player_rows)) == 0 && score == o.score &&
+		game_over == o.game_over && powerup_activated == o.powerup_activated &&
+		counter == o.counter && wall_count == o.wall_count && level_pos == o.level_pos && powerup_remainingTime == o.powerup_remainingTime &&
+		memcmp(shot_rows, o.shot_rows, sizeof(shot_rows)) == 0 && seeder == o.seeder && width == o.width &&
+		screen_step == o.screen_step && screen_ms == o.screen_ms;
+}
+
+Snapshot snapshot_of(const Game& g) {
+	Snapshot s;
+	memcpy(s.wall_rows, g.wall_rows, sizeof(s.wall_rows));
+	memcpy(s.powerup_rows, g.powerup_rows, sizeof(s.powerup_rows));
+	memcpy(s.player_rows, g.player_rows, sizeof(s.player_rows));
+	s.score = g.score;
+	s.game_over = g.game_over;
+	s.powerup_activated = g.powerup_activated;
+	s.counter = g.counter;
+	s.wall_count = g.wall_count;
+	s.level_pos = g.level_pos;
+	s.powerup_remainingTime = g.powerup_remainingTime;
+	memcpy(s.shot_rows, g.shot_rows, sizeof(s.shot_rows));
+	s.seeder = g.seeder;
+	s.width = g.width;
+	s.screen_step = g.screen_step;
+	s.screen_ms = g.screen_ms;
+	return s;
+}
+
+namespace legacy {
+
+void boot(uint16_t seed) {
+	if(booted) {
+		fprintf(stderr, "legacy firmware booted twice\n");
+		abort();
+	}
+	booted = true;
+
+	getcontext(&firmware_ctx);
+	firmware_ctx.uc_stack.ss_sp = firmware_stack;
+	firmware_ctx.uc_stack.ss_size = sizeof(firmware_stack);
+	firmware_ctx.uc_link = NULL;
+	makecontext(&firmware_ctx, firmware_entry, 0);
+	swapcontext(&harness_ctx, &firmware_ctx);
+
+	game.seeder = (int16_t)seed;
+}
+
+void tick(const Input& in) {
+	stick = in.stick_x;
+	button = in.button;
+	/* The timer's compare A interrupt has fired by the end of every tick,
+	   and with it TimerFast(): the display scan step and the stick sample.
+	   Compare B only matters with an alarm set */
+	TIMER1_COMPA_vect();
+	if(TIMSK1 & (1 << OCIE1B)) {
+		TIMER1_COMPB_vect();
+	}
+	swapcontext(&harness_ctx, &firmware_ctx);
+	drain_uart();
+	drain_eeprom();
+}
+
+uint8_t* eeprom() {
+	return eeprom_image;
+}
+
+const uint32_t* eeprom_write_counts() {
+	return eeprom_writes;
+}
+
+uint64_t eeprom_read_count() {
+	return eeprom_reads;
+}
+
+bool eeprom_idle() {
+	return !(EECR & ((1 << EEPE) | (1 << EERIE)));
+}
+
+HighScores high_scores() {
+	HighScores h = {highscore_games, highscore_wins, highscore_best};
+	return h;
+}
+
+void take_uart(std::vector<uint8_t>& out) {
+	out.insert(out.end(), uart_bytes.begin(), uart_bytes.end());
+	uart_bytes.clear();
+}
+
+/* main.c and the host engine have to be built for the same board */
+static_assert(sizeof(GameState::wall_rows) == sizeof(Snapshot::wall_rows), "BOARD_ROWS/BOARD_COLS differ");
+
+Snapshot snapshot() {
+	Snapshot s;
+	memcpy(s.wall_rows, game.wall_rows, sizeof(s.wall_rows));
+	memcpy(s.powerup_rows, game.powerup_rows, sizeof(s.powerup_rows));
+	memcpy(s.player_rows, game.player_rows, sizeof(s.player_rows));
+	s.score = game.score;
+	s.game_over = game.game_over;
+	s.powerup_activated = game.powerup_activated;
+	s.counter = game.counter;
+	s.wall_count = game.wall_count;
+	s.level_pos = game.level_pos;
+	s.powerup_remainingTime = game.powerup_remainingTime;
+	memcpy(s.shot_rows, game.shot_rows, sizeof(s.shot_rows));
+	s.seeder = game.seeder;
+	s.width = game.width;
+	s.screen_step = game.screen_step;
+	s.screen_ms = game.screen_ms;
+	return s;
+}
+
+} // namespace legacy
+
+} // namespace escalade
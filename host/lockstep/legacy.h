@@ -0,0 +1,80 @@
+// The unmodified firmware (../main.c) run on the host as the reference for
+// lockstep testing of the host engine, plus the state both are compared on.
+
+////////////////////////////////////////////////////////////////////////////////
+
+#ifndef ESCALADE_LEGACY_H
+#define ESCALADE_LEGACY_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <vector>
+
+#include "../sim/game.h"
+
+namespace escalade {
+
+//What the harness compares after every tick. Board, score, game_over and
+//powerup_activated are the observable game; seeder, width, counter and
+//powerup_remainingTime usually diverge first and point at the cause.
+struct Snapshot {
+	Game::Row wall_rows[Game::kRows];
+	Game::Row powerup_rows[Game::kRows];
+	Game::Row player_rows[Game::kRows];
+	unsigned char score;
+	unsigned char game_over;
+	unsigned char powerup_activated;
+	unsigned char counter;
+	unsigned char wall_count;
+	unsigned short level_pos;
+	unsigned char powerup_remainingTime;
+	Game::Row shot_rows[Game::kRows];
+	int seeder;
+	int width;
+	unsigned char screen_step;
+	unsigned short screen_ms;
+
+	bool operator==(const Snapshot& o) const;
+	bool operator!=(const Snapshot& o) const { return !(*this == o); }
+};
+
+Snapshot snapshot_of(const Game& g);
+
+namespace legacy {
+
+//main.c keeps its state in globals and never returns, so there is exactly one
+//legacy game per process and it can be booted once. Fork before boot() to run
+//another one.
+
+/* Runs main() up to its first button read, then seeds like Game::reset() */
+void boot(uint16_t seed);
+/* Lets main() run until its next button read, see Game::tick() */
+void tick(const Input& in);
+Snapshot snapshot();
+/* Appends what USART0 sent so far, only firmware built with -DTELEMETRY sends */
+void take_uart(std::vector<uint8_t>& out);
+
+//The EEPROM, erased (0xFF) at start. Fill it before boot() to power up with
+//saved contents.
+const size_t kEepromSize = 4096;
+uint8_t* eeprom();
+/* Byte writes per address, and eeprom_read_block() calls plus EERE reads */
+const uint32_t* eeprom_write_counts();
+uint64_t eeprom_read_count();
+/* No byte write in progress and none queued by the firmware */
+bool eeprom_idle();
+
+/* Stats main.c keeps in RAM and logs to EEPROM, see ../highscore.h */
+struct HighScores {
+	unsigned games;
+	unsigned wins;
+	unsigned best;
+};
+HighScores high_scores();
+
+} // namespace legacy
+
+} // namespace escalade
+
+#endif
@@ -0,0 +1 @@
+#include "../regs.h"
@@ -0,0 +1,84 @@
+// Register shim for compiling the unmodified firmware (../../main.c) on the
+// host. Ports and timer registers become plain variables, the ADC always has
+// a conversion ready, and reading PINB hands control back to the harness,
+// which makes one PINB read one tick, as in the host port. USART0 sends what
+// the firmware writes to UDR0 at 38400 baud worth of bytes per tick. The
+// EEPROM is an image in the harness; a byte write started with EEPE takes
+// four ticks, and EEDR holds the addressed byte once EERE is set. TCNT1 does
+// not count, so timer.h's clock only has ms resolution and an alarm goes off
+// in the tick after the one it is due in. rand()/srand() are routed to the avr-libc generator of the host
+// port.
+
+////////////////////////////////////////////////////////////////////////////////
+
+#ifndef LOCKSTEP_REGS_H
+#define LOCKSTEP_REGS_H
+
+#include <stdint.h>
+#include <stdlib.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+extern volatile uint8_t PORTA, PORTB, PORTC, PORTD;
+extern volatile uint8_t DDRA, DDRB, DDRC, DDRD;
+extern volatile uint8_t ADMUX, SREG, TIMSK1, TIFR1, TCCR1B, TCCR3A, TCCR3B;
+extern volatile uint16_t OCR1A, OCR1B, TCNT1, OCR3A, TCNT3;
+extern volatile uint8_t TCNT1L;
+extern volatile uint8_t UCSR0A, UCSR0B, UCSR0C;
+extern volatile uint16_t UBRR0, UDR0;
+extern volatile uint8_t EECR;
+extern volatile uint16_t EEAR;
+
+volatile uint8_t* lockstep_adcsra(void);
+uint16_t lockstep_adc(void);
+uint8_t lockstep_pinb(void);
+volatile uint8_t* lockstep_eedr(void);
+void eeprom_read_block(void* dst, const void* src, size_t n);
+
+int lockstep_rand(void);
+void lockstep_srand(unsigned int seed);
+
+#ifdef __cplusplus
+}
+#endif
+
+#define REFS0	6
+#define ADEN	7
+#define ADSC	6
+#define ADIF	4
+#define ADPS2	2
+#define ADPS1	1
+#define ADPS0	0
+#define OCF1A	1
+#define OCF1B	2
+#define OCIE1B	2
+#define COM3A0	6
+#define WGM32	3
+#define CS31	1
+#define CS30	0
+#define U2X0	1
+#define UCSZ01	2
+#define UCSZ00	1
+#define TXEN0	3
+#define UDRIE0	5
+#define EERE	0
+#define EEPE	1
+#define EEMPE	2
+#define EERIE	3
+
+/* Only for the firmware, legacy.cpp implements these */
+#ifndef LOCKSTEP_HARNESS
+#define ADCSRA	(*lockstep_adcsra())
+#define ADC		(lockstep_adc())
+#define PINB	(lockstep_pinb())
+#define EEDR	(*lockstep_eedr())
+
+#define ISR(vector) void vector(void)
+
+#define rand	lockstep_rand
+#define srand	lockstep_srand
+#endif
+
+#endif //LOCKSTEP_REGS_H
@@ -0,0 +1,815 @@
+// Input recordings of host engine games and tick-exact replay.
+
+////////////////////////////////////////////////////////////////////////////////
+
+#include "replay.h"
+
+#include <ctype.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <algorithm>
+
+#include "../bot/bot.h"
+
+namespace escalade {
+
+namespace {
+
+const uint64_t kFnvOffset = 0xCBF29CE484222325ull;
+const uint64_t kFnvPrime = 0x100000001B3ull;
+
+struct Hasher {
+	uint64_t h = kFnvOffset;
+
+	template <typename T>
+	void add(const T& v) {
+		const uint8_t* p = (const uint8_t*)&v;
+		for(size_t k = 0; k < sizeof(T); ++k) {
+			h = (h ^ p[k]) * kFnvPrime;
+		}
+	}
+};
+
+/* Little endian field writer and reader for keyframes */
+struct Packer {
+	uint8_t* p;
+
+	void u8(unsigned v) { *p++ = (uint8_t)v; }
+	void u16(unsigned v) { u8(v & 0xFF); u8(v >> 8); }
+	void u32(uint32_t v) { u16(v & 0xFFFF); u16(v >> 16); }
+	/* A board row or the ground lines, in as many bytes as T has */
+	template<typename T> void bits(T v) {
+		for(size_t b = 0; b < sizeof(T); ++b) {
+			u8((uint8_t)(v >> (8 * b)));
+		}
+	}
+};
+
+struct Unpacker {
+	const uint8_t* p;
+
+	uint8_t u8() { return *p++; }
+	uint16_t u16() { uint16_t lo = u8(); return lo | (uint16_t)(u8() << 8); }
+	uint32_t u32() { uint32_t lo = u16(); return lo | ((uint32_t)u16() << 16); }
+	template<typename T> T bits() {
+		T v = 0;
+		for(size_t b = 0; b < sizeof(T); ++b) {
+			v |= (T)((T)u8() << (8 * b));
+		}
+		return v;
+	}
+};
+
+bool parse_hex(const char* text, uint8_t* out, size_t bytes) {
+	for(size_t b = 0; b < bytes; ++b) {
+		unsigned v;
+		if(!isxdigit((unsigned char)text[0]) || !isxdigit((unsigned char)text[1]) ||
+			sscanf(text, "%2x", &v) != 1) {
+			return false;
+		}
+		out[b] = (uint8_t)v;
+		text += 2;
+	}
+	return true;
+}
+
+/* What getMovement makes of the stick, as a stored value */
+uint16_t canonical_stick(uint16_t adc) {
+	if(adc > 900) {
+		return kStickRight;
+	}
+
+	else if(adc < 100) {
+		return kStickLeft;
+	}
+	return kStickCenter;
+}
+
+/* Same tick in telemetry terms: the firmware's 1 ms tick count */
+uint64_t ms_of(const TelemetryEvent& ev) {
+	return ev.time / kTelemetryTicksPerMs;
+}
+
+bool is_end(uint8_t type) {
+	return type == TELEMETRY_GAME_OVER || type == TELEMETRY_WIN;
+}
+
+/* Records about the stream and task timing rather than the game */
+bool is_bookkeeping(uint8_t type) {
+	return type == TELEMETRY_TICK_START || type == TELEMETRY_DROPPED || type == TELEMETRY_FRAMES ||
+		(type >= TELEMETRY_RAM_DATA && type <= TELEMETRY_STACK_PEAK) || type >= TELEMETRY_TASK_START;
+}
+
+} // namespace
+
+uint64_t state_hash(const Game& g) {
+	Hasher h;
+	h.add(g.wall_rows);
+	h.add(g.powerup_rows);
+	h.add(g.player_rows);
+	h.add(g.row);
+	h.add(g.screen_step);
+	h.add(g.screen_ms);
+	h.add(g.seeder);
+	h.add(g.score);
+	h.add(g.height);
+	h.add(g.width);
+	h.add(g.game_over);
+	h.add(g.powerup_activated);
+	h.add(g.wall);
+	h.add(g.powerup_randomNum);
+	h.add(g.powerup_spawn);
+	h.add(g.counter);
+	h.add(g.pos);
+	h.add(g.wall_next);
+	h.add(g.wall_spawn);
+	h.add(g.wall_period);
+	h.add(g.wall_head);
+	h.add(g.wall_count);
+	h.add(g.wall_last);
+	h.add(g.level);
+	h.add(g.level_pos);
+	h.add(g.level_run);
+	h.add(g.powerup_remainingTime);
+	h.add(g.shot_cooldown);
+	h.add(g.shot_rows);
+	h.add(g.shot_clock);
+	h.add(g.shot_fired);
+	h.add(g.shot_col);
+	h.add(g.shot_next);
+	h.add(g.shot_free);
+	h.add(g.shot_fresh);
+	h.add(g.bus_topic);
+	h.add(g.bus_arg);
+	h.add(g.bus_head);
+	h.add(g.bus_count);
+	h.add(g.bus_lost);
+	h.add(g.i);
+	for(int t = 0; t < kNumTasks; ++t) {
+		h.add(g.tasks[t].state);
+		h.add(g.tasks[t].period);
+		h.add(g.tasks[t].elapsedTime);
+	}
+	h.add(g.mode);
+	h.add(g.rng.next);
+	return h.h;
+}
+
+void pack_keyframe(const Game& g, uint8_t* out) {
+	Packer p = {out};
+	for(int r = 0; r < Game::kRows; ++r) {
+		p.bits(g.wall_rows[r]);
+		p.bits(g.powerup_rows[r]);
+		p.bits(g.player_rows[r]);
+	}
+	p.u8(g.GND);
+	p.u8(g.B2);
+	p.u8(g.row);
+	p.u8(g.screen_step);
+	p.u16(g.screen_ms);
+	p.u8(g.scan.gnd);
+	for(int y = 0; y < Game::kPanelRows; ++y) {
+		p.bits(g.scan.r[y]);
+		p.bits(g.scan.g[y]);
+		p.bits(g.scan.b[y]);
+	}
+	p.u32((uint32_t)g.seeder);
+	p.u8(g.score);
+	p.u8(g.height);
+	p.u8(g.width);
+	p.u8(g.game_over);
+	p.u8(g.powerup_activated);
+	p.u16((uint16_t)g.x_val);
+	p.bits(g.wall);
+	p.u8(g.powerup_randomNum);
+	p.u8(g.powerup_spawn);
+	p.u8(g.counter);
+	p.bits(g.pos);
+	for(int k = 0; k < kWallQueue; ++k) {
+		p.u8(g.wall_next[k]);
+		p.u8(g.wall_spawn[k]);
+		p.u8(g.wall_period[k]);
+	}
+	p.u8(g.wall_head);
+	p.u8(g.wall_count);
+	p.u8(g.wall_last);
+	p.u8(g.level);
+	p.u16(g.level_pos);
+	p.u8(g.level_run);
+	p.u8(g.powerup_remainingTime);
+	p.u8(g.shot_cooldown);
+	for(int r = 0; r < Game::kRows; ++r) {
+		p.bits(g.shot_rows[r]);
+	}
+	p.u8(g.shot_clock);
+	for(int s = 0; s < kShotCapacity; ++s) {
+		p.u8(g.shot_fired[s]);
+		p.u8(g.shot_col[s]);
+		p.u8(g.shot_next[s]);
+	}
+	p.u8(g.shot_free);
+	p.u8(g.shot_fresh);
+	for(int s = 0; s < kBusSubscribers; ++s) {
+		for(int k = 0; k < kBusRing; ++k) {
+			p.u8(g.bus_topic[s][k]);
+			p.u8(g.bus_arg[s][k]);
+		}
+		p.u8(g.bus_head[s]);
+		p.u8(g.bus_count[s]);
+		p.u8(g.bus_lost[s]);
+	}
+	p.u8(g.i);
+	uint64_t frequency;
+	memcpy(&frequency, &g.current_frequency, sizeof(frequency));
+	p.u32((uint32_t)frequency);
+	p.u32((uint32_t)(frequency >> 32));
+	p.u8(g.pwm_on);
+	/* Periods are at most 255 ms (a level sets them with a byte), and elapsedTime never passes its period */
+	for(int t = 0; t < kNumTasks; ++t) {
+		p.u8((uint8_t)g.tasks[t].state);
+		p.u8(g.tasks[t].period);
+		p.u8(g.tasks[t].elapsedTime);
+	}
+	p.u8(g.mode);
+	p.u32(g.rng.next);
+	p.u16(g.adc);
+	p.u32(g.ticks);
+}
+
+void unpack_keyframe(const uint8_t* in, Game& g) {
+	g = Game();
+	Unpacker p = {in};
+	for(int r = 0; r < Game::kRows; ++r) {
+		g.wall_rows[r] = p.bits<Game::Row>();
+		g.powerup_rows[r] = p.bits<Game::Row>();
+		g.player_rows[r] = p.bits<Game::Row>();
+	}
+	g.GND = p.u8();
+	g.B2 = p.u8();
+	g.row = p.u8();
+	g.screen_step = p.u8();
+	g.screen_ms = p.u16();
+	g.scan.gnd = p.u8();
+	for(int y = 0; y < Game::kPanelRows; ++y) {
+		g.scan.r[y] = p.bits<Game::Row>();
+		g.scan.g[y] = p.bits<Game::Row>();
+		g.scan.b[y] = p.bits<Game::Row>();
+	}
+	g.seeder = (int32_t)p.u32();
+	g.score = p.u8();
+	g.height = p.u8();
+	g.width = p.u8();
+	g.game_over = p.u8();
+	g.powerup_activated = p.u8();
+	g.x_val = (int16_t)p.u16();
+	g.wall = p.bits<Game::Row>();
+	g.powerup_randomNum = p.u8();
+	g.powerup_spawn = p.u8();
+	g.counter = p.u8();
+	g.pos = p.bits<Game::Row>();
+	for(int k = 0; k < kWallQueue; ++k) {
+		g.wall_next[k] = p.u8();
+		g.wall_spawn[k] = p.u8();
+		g.wall_period[k] = p.u8();
+	}
+	g.wall_head = p.u8();
+	g.wall_count = p.u8();
+	g.wall_last = p.u8();
+	g.level = p.u8();
+	g.level_pos = p.u16();
+	g.level_run = p.u8();
+	g.powerup_remainingTime = p.u8();
+	g.shot_cooldown = p.u8();
+	for(int r = 0; r < Game::kRows; ++r) {
+		g.shot_rows[r] = p.bits<Game::Row>();
+	}
+	g.shot_clock = p.u8();
+	for(int s = 0; s < kShotCapacity; ++s) {
+		g.shot_fired[s] = p.u8();
+		g.shot_col[s] = p.u8();
+		g.shot_next[s] = p.u8();
+	}
+	g.shot_free = p.u8();
+	g.shot_fresh = p.u8();
+	for(int s = 0; s < kBusSubscribers; ++s) {
+		for(int k = 0; k < kBusRing; ++k) {
+			g.bus_topic[s][k] = p.u8();
+			g.bus_arg[s][k] = p.u8();
+		}
+		g.bus_head[s] = p.u8();
+		g.bus_count[s] = p.u8();
+		g.bus_lost[s] = p.u8();
+	}
+	g.i = p.u8();
+	uint64_t frequency = p.u32();
+	frequency |= (uint64_t)p.u32() << 32;
+	memcpy(&g.current_frequency, &frequency, sizeof(frequency));
+	g.pwm_on = p.u8() != 0;
+	for(int t = 0; t < kNumTasks; ++t) {
+		g.tasks[t].state = (signed char)p.u8();
+		g.tasks[t].period = p.u8();
+		g.tasks[t].elapsedTime = p.u8();
+	}
+	g.mode = (Mode)p.u8();
+	g.rng.next = p.u32();
+	g.adc = p.u16();
+	g.ticks = p.u32();
+}
+
+FinalState final_state_of(const Game& g) {
+	FinalState f;
+	f.score = g.score;
+	f.game_over = g.game_over;
+	f.mode = g.mode;
+	f.hash = state_hash(g);
+	return f;
+}
+
+bool write_recording(const char* path, const Recording& rec, const char* comment) {
+	FILE* f = fopen(path, "w");
+	if(!f) {
+		return false;
+	}
+
+	fprintf(f, "# escalade recording\n");
+	if(comment) {
+		fprintf(f, "# %s\n", comment);
+	}
+	fprintf(f, "version %d\nseed %u\nticks %" PRIu64 "\n", rec.keyframes.empty() ? 1 : 2, rec.seed,
+		rec.ticks);
+	if(!rec.keyframes.empty()) {
+		fprintf(f, "keyframes %u %zu\n", rec.keyframe_interval, kKeyframeBytes);
+	}
+
+	Input last;
+	for(const InputChange& c : rec.changes) {
+		if(c.stick_x != last.stick_x) {
+			fprintf(f, "%u stick %u\n", c.tick, c.stick_x);
+		}
+		if(c.button != last.button) {
+			fprintf(f, "%u button %s\n", c.tick, c.button ? "down" : "up");
+		}
+		last.stick_x = c.stick_x;
+		last.button = c.button;
+	}
+
+	for(const Keyframe& k : rec.keyframes) {
+		fprintf(f, "keyframe %" PRIu64 " ", k.tick);
+		for(size_t b = 0; b < kKeyframeBytes; ++b) {
+			fprintf(f, "%02x", k.state[b]);
+		}
+		fprintf(f, "\n");
+	}
+
+	if(rec.has_final) {
+		fprintf(f, "final score %u game_over %u mode %u hash %016" PRIx64 "\n",
+			rec.final_state.score, rec.final_state.game_over, rec.final_state.mode,
+			rec.final_state.hash);
+	}
+	return fclose(f) == 0;
+}
+
+bool read_recording(const char* path, Recording& rec, std::string& error) {
+	FILE* f = fopen(path, "r");
+	if(!f) {
+		error = std::string("cannot open ") + path;
+		return false;
+	}
+
+	rec = Recording();
+	char line[512];
+	int line_no = 0;
+	Input in;
+	bool ok = true;
+
+	while(ok && fgets(line, sizeof(line), f)) {
+		++line_no;
+		char* hash = strchr(line, '#');
+		if(hash) {
+			*hash = '\0';
+		}
+
+		unsigned v, s, go, m;
+		int n = 0;
+		unsigned long long t;
+		char what[16], h[32];
+		if(sscanf(line, " %15s", what) != 1) {
+			continue;
+		}
+
+		else if(sscanf(line, "version %u", &v) == 1) {
+			ok = (v == 1 || v == 2);
+		}
+
+		else if(sscanf(line, "keyframes %u %u", &v, &s) == 2) {
+			rec.keyframe_interval = v;
+			ok = (s == kKeyframeBytes);
+		}
+
+		else if(sscanf(line, "keyframe %llu %n", &t, &n) == 1) {
+			Keyframe k;
+			k.tick = t;
+			ok = parse_hex(line + n, k.state, kKeyframeBytes) &&
+				(rec.keyframes.empty() || rec.keyframes.back().tick < t);
+			rec.keyframes.push_back(k);
+			continue;
+		}
+
+		else if(sscanf(line, "seed %u", &v) == 1) {
+			rec.seed = (uint16_t)v;
+		}
+
+		else if(sscanf(line, "ticks %llu", &t) == 1) {
+			rec.ticks = t;
+		}
+
+		else if(sscanf(line, "final score %u game_over %u mode %u hash %31s", &s, &go, &m, h) == 4) {
+			rec.has_final = true;
+			rec.final_state.score = (unsigned char)s;
+			rec.final_state.game_over = (unsigned char)go;
+			rec.final_state.mode = (uint8_t)m;
+			rec.final_state.hash = strtoull(h, NULL, 16);
+		}
+
+		else if(sscanf(line, "%llu %15s %u", &t, what, &v) == 3 && strcmp(what, "stick") == 0) {
+			in.stick_x = (uint16_t)v;
+		}
+
+		else if(sscanf(line, "%llu button %15s", &t, what) == 2) {
+			in.button = strcmp(what, "down") == 0;
+		}
+
+		else {
+			ok = false;
+		}
+
+		if(!ok) {
+			break;
+		}
+
+		if(isdigit((unsigned char)line[0])) {
+			/* Stick and button lines of the same tick make one change */
+			if(!rec.changes.empty() && rec.changes.back().tick == t) {
+				rec.changes.back().stick_x = in.stick_x;
+				rec.changes.back().button = in.button;
+			}
+
+			else if(!rec.changes.empty() && rec.changes.back().tick > t) {
+				ok = false;
+			}
+
+			else {
+				rec.changes.push_back(InputChange{(uint32_t)t, in.stick_x, in.button});
+			}
+		}
+	}
+	fclose(f);
+
+	if(!ok) {
+		error = std::string(path) + ":" + std::to_string(line_no) + ": bad line";
+	}
+	return ok;
+}
+
+void replay(const Recording& rec, Game& g, uint64_t max_ticks) {
+	InputCursor cursor(rec.changes);
+	uint64_t ticks = (rec.ticks < max_ticks) ? rec.ticks : max_ticks;
+
+	g.reset(rec.seed);
+	for(uint64_t t = 0; t < ticks; ++t) {
+		g.tick(cursor.at(t));
+	}
+}
+
+uint64_t seek(const Recording& rec, uint64_t tick, Game& g) {
+	if(tick > rec.ticks) {
+		tick = rec.ticks;
+	}
+
+	/* Last keyframe at or before tick */
+	std::vector<Keyframe>::const_iterator k = std::upper_bound(rec.keyframes.begin(),
+		rec.keyframes.end(), tick, [](uint64_t t, const Keyframe& key) { return t < key.tick; });
+
+	uint64_t from = 0;
+	if(k == rec.keyframes.begin()) {
+		g.reset(rec.seed);
+	}
+
+	else {
+		--k;
+		unpack_keyframe(k->state, g);
+		from = k->tick;
+	}
+
+	InputCursor cursor(rec.changes, from);
+	for(uint64_t t = from; t < tick; ++t) {
+		g.tick(cursor.at(t));
+	}
+	return tick - from;
+}
+
+void add_keyframes(Recording& rec, uint32_t interval) {
+	rec.keyframe_interval = interval;
+	rec.keyframes.clear();
+	if(interval == 0) {
+		return;
+	}
+
+	InputCursor cursor(rec.changes);
+	Game g;
+	g.reset(rec.seed);
+	for(uint64_t t = 0; t < rec.ticks; ++t) {
+		if(t > 0 && t % interval == 0) {
+			rec.keyframes.push_back(Keyframe());
+			rec.keyframes.back().tick = t;
+			pack_keyframe(g, rec.keyframes.back().state);
+		}
+		g.tick(cursor.at(t));
+	}
+}
+
+InputCursor::InputCursor(const std::vector<InputChange>& changes, uint64_t tick) : changes_(changes) {
+	next_ = std::upper_bound(changes.begin(), changes.end(), tick,
+		[](uint64_t t, const InputChange& c) { return t < c.tick; }) - changes.begin();
+	if(next_ > 0) {
+		in_.stick_x = changes[next_ - 1].stick_x;
+		in_.button = changes[next_ - 1].button;
+	}
+}
+
+void Recorder::record(const Game& g, const Input& in) {
+	uint32_t interval = rec_.keyframe_interval;
+	if(interval && rec_.ticks > 0 && rec_.ticks % interval == 0) {
+		rec_.keyframes.push_back(Keyframe());
+		rec_.keyframes.back().tick = rec_.ticks;
+		pack_keyframe(g, rec_.keyframes.back().state);
+	}
+
+	Input next = last_;
+	next.button = in.button;
+	/* Only the ticks getMovement reads the stick on count */
+	if(g.mode == kRun && ticks_until_sample(g) == 0) {
+		next.stick_x = canonical_stick(in.stick_x);
+	}
+
+	if(next.stick_x != last_.stick_x || next.button != last_.button) {
+		rec_.changes.push_back(InputChange{(uint32_t)rec_.ticks, next.stick_x, next.button});
+		last_ = next;
+	}
+	++rec_.ticks;
+}
+
+const Recording& Recorder::finish(const Game& g) {
+	rec_.has_final = true;
+	rec_.final_state = final_state_of(g);
+	return rec_;
+}
+
+namespace {
+
+/* Ticks checked after each guess at where a button release lost in dropped records was */
+const uint64_t kReleaseHorizonMs = 1000;
+
+struct TelemetryReplay {
+	const std::vector<TelemetryEvent>* events;
+	size_t k = 0;
+	/* Firmware tick count of the next tick */
+	uint64_t ms = 0;
+	Game g;
+	Recorder recorder{0};
+	/* Button down in the last tick */
+	bool held = false;
+	/* Records dropped since the button went down */
+	bool lossy = false;
+	/* Button forced down up to this ms, where records were dropped */
+	bool forced = false;
+	uint64_t hold_until = 0;
+
+	bool done() {
+		while(k < events->size() && is_bookkeeping((*events)[k].type)) {
+			lossy |= ((*events)[k].type == TELEMETRY_DROPPED);
+			++k;
+		}
+		return k == events->size();
+	}
+
+	/* First game event from k on, events->size() if none */
+	size_t next_game_event(bool& dropped) const {
+		size_t e = k;
+		dropped = false;
+		for(; e < events->size() && is_bookkeeping((*events)[e].type); ++e) {
+			dropped |= ((*events)[e].type == TELEMETRY_DROPPED);
+		}
+		return e;
+	}
+
+	bool step(std::string& error);
+};
+
+bool TelemetryReplay::step(std::string& error) {
+	char msg[160];
+	const TelemetryEvent& first = (*events)[k];
+	Input in;
+
+	if(g.mode != kRun) {
+		if(first.type != TELEMETRY_RESTART) {
+			snprintf(msg, sizeof(msg), "ms %" PRIu64 ": %s on the end screen", ms,
+				telemetry_name(first.type));
+			error = msg;
+			return false;
+		}
+
+		in.button = true;
+		recorder.record(g, in);
+		g.tick(in);
+		held = true;
+		++k;
+		++ms;
+		return true;
+	}
+
+	if(ms_of(first) < ms) {
+		snprintf(msg, sizeof(msg), "ms %" PRIu64 ": %s belongs to an earlier tick", ms,
+			telemetry_name(first.type));
+		error = msg;
+		return false;
+	}
+
+	/* Input of this tick */
+	in.button = (ms_of(first) == ms && first.type == TELEMETRY_RESTART) || (forced && ms <= hold_until);
+	for(size_t e = k; e < events->size() && ms_of((*events)[e]) == ms && !is_end((*events)[e].type); ++e) {
+		if((*events)[e].type == TELEMETRY_MOVE) {
+			in.stick_x = ((g.width + Game::kCols - 1) % Game::kCols == (int)(*events)[e].arg) ? kStickRight : kStickLeft;
+		}
+	}
+
+	int width = g.width;
+	unsigned char score = g.score;
+	recorder.record(g, in);
+	g.tick(in);
+	held = in.button;
+	if(!held) {
+		lossy = false;
+	}
+
+	/* Everything else the firmware reported for it */
+	bool wall = false, move = false, scored = false;
+	for(; k < events->size() && ms_of((*events)[k]) == ms; ++k) {
+		const TelemetryEvent& ev = (*events)[k];
+		bool ok = true;
+		switch(ev.type) {
+			case TELEMETRY_DROPPED: lossy = true; break;
+			case TELEMETRY_WALL: ok = ((uint16_t)g.wall == ev.arg); wall = true; break;
+			case TELEMETRY_POWERUP_SPAWN: ok = (g.powerup_spawn == (int)ev.arg); break;
+			case TELEMETRY_MOVE: ok = (g.width == (int)ev.arg); move = true; break;
+			case TELEMETRY_POWERUP_PICKUP: ok = (g.powerup_activated == 0x01); break;
+			case TELEMETRY_SCORE: ok = (g.score == ev.arg); scored = true; break;
+			case TELEMETRY_GAME_OVER: ok = (g.mode == kLoseScreen && g.score == ev.arg); break;
+			case TELEMETRY_WIN: ok = (g.mode == kWinScreen); break;
+			default: break;
+		}
+
+		if(!ok) {
+			snprintf(msg, sizeof(msg), "ms %" PRIu64 ": capture has %s %u, simulator disagrees",
+				ms, telemetry_name(ev.type), ev.arg);
+			error = msg;
+			return false;
+		}
+
+		/* The restart on the end screen is the next tick's input */
+		if(is_end(ev.type)) {
+			++k;
+			break;
+		}
+	}
+
+	/* And nothing the simulator did went unreported, in ticks that ran the tasks */
+	const char* missing = NULL;
+	if(!in.button && g.mode == kRun) {
+		const Task& walls = g.tasks[kMoveWalls];
+		if(walls.state == mW_generate && walls.elapsedTime == 1 && !wall) {
+			missing = "wall";
+		}
+
+		else if(g.width != width && !move) {
+			missing = "move";
+		}
+
+		else if(g.score != score && !scored) {
+			missing = "score";
+		}
+	}
+
+	if(missing) {
+		snprintf(msg, sizeof(msg), "ms %" PRIu64 ": simulator has a %s the capture lacks", ms, missing);
+		error = msg;
+		return false;
+	}
+
+	if(g.mode == kRun) {
+		++ms;
+	}
+	return true;
+}
+
+} // namespace
+
+////////////////////////////////////////////////////////////////////////////////
+//Replays the capture through the simulator one firmware tick at a time. The
+//firmware's tick count (the event time in ms) advances at the end of every
+//main loop iteration that waits for the timer, which is every tick that ends
+//in kRun; end screen spins do not count. A tick's input is then known from
+//its events: the button was down if it starts with a restart, and the stick
+//pushed if the player moved.
+//
+//Holding the button restarts the game every tick, which sends more records
+//than the link carries, so the restarts at the end of a press may have been
+//dropped. The release is then placed at the first tick that the following
+//second of the capture agrees with.
+bool recording_from_telemetry(const std::vector<TelemetryEvent>& events, Recording& rec,
+	std::string& error) {
+	TelemetryReplay r;
+	r.events = &events;
+	r.g.reset(0);
+
+	/* Skip to the power on or first restart */
+	if(r.done()) {
+		error = "no game events in the capture";
+		return false;
+	}
+	r.ms = ms_of(events[r.k]);
+
+	if(r.ms != 0) {
+		size_t s = r.k;
+		while(s < events.size() && events[s].type != TELEMETRY_RESTART) {
+			++s;
+		}
+		if(s == events.size()) {
+			error = "capture starts after power on and has no restart";
+			return false;
+		}
+
+		/* Restarting from an end screen skips the tasks for that tick */
+		if(s > 0 && is_end(events[s - 1].type) && ms_of(events[s - 1]) == ms_of(events[s])) {
+			r.g.mode = (events[s - 1].type == TELEMETRY_WIN) ? kWinScreen : kLoseScreen;
+		}
+		r.k = s;
+		r.ms = ms_of(events[s]);
+	}
+
+	while(!r.done()) {
+		bool dropped;
+		size_t next = r.next_game_event(dropped);
+		bool restart_now = events[next].type == TELEMETRY_RESTART && ms_of(events[next]) == r.ms;
+
+		if(r.g.mode == kRun && r.held && !restart_now && !(r.forced && r.ms <= r.hold_until + 1) &&
+			(r.lossy || dropped)) {
+			uint64_t next_ms = ms_of(events[next]);
+
+			/* Restarts still to come: the press went on */
+			if(events[next].type == TELEMETRY_RESTART) {
+				r.forced = true;
+				r.hold_until = next_ms - 1;
+			}
+
+			else {
+				bool placed = false;
+				for(uint64_t c = r.ms - 1; c < next_ms && !placed; ++c) {
+					TelemetryReplay trial = r;
+					std::string trial_error;
+					trial.forced = true;
+					trial.hold_until = c;
+					bool ok = true;
+					while(ok && !trial.done() && trial.ms <= next_ms + kReleaseHorizonMs) {
+						ok = trial.step(trial_error);
+					}
+
+					if(ok) {
+						r.forced = true;
+						r.hold_until = c;
+						placed = true;
+					}
+				}
+
+				if(!placed) {
+					char msg[160];
+					snprintf(msg, sizeof(msg), "ms %" PRIu64 ": no button release fits the records "
+						"dropped during the press", r.ms);
+					error = msg;
+					return false;
+				}
+			}
+		}
+
+		if(!r.step(error)) {
+			return false;
+		}
+	}
+
+	rec = r.recorder.finish(r.g);
+	return true;
+}
+
+} // namespace escalade
@@ -0,0 +1,148 @@
+// Input recordings of host engine games and tick-exact replay.
+//
+// A game is fully determined by its seed, the thumbstick at the ticks
+// getMovement samples it and the button at every tick, so a recording only
+// holds changes of those. The text format is
+//
+//	version 1
+//	seed <seed>
+//	ticks <length of the recording>
+//	<tick> stick <adc>
+//	<tick> button down|up
+//	final score <score> game_over <0|1> mode <Mode> hash <state_hash>
+//
+// with the final line optional, '#' comments, and inputs held from their tick
+// until the next change. Stick values are stored as 0, 512 or 1023.
+//
+// Version 2 adds keyframes, the packed game state every <interval> ticks, so
+// a replay can start from the nearest one instead of tick 0:
+//
+//	keyframes <interval> <bytes per keyframe>
+//	keyframe <tick> <hex state before that tick's input>
+
+////////////////////////////////////////////////////////////////////////////////
+
+#ifndef ESCALADE_REPLAY_H
+#define ESCALADE_REPLAY_H
+
+#include <stdint.h>
+
+#include <string>
+#include <vector>
+
+#include "../sim/game.h"
+#include "../telemetry/decoder.h"
+
+namespace escalade {
+
+/* Input from this tick on */
+struct InputChange {
+	uint32_t tick;
+	uint16_t stick_x;
+	bool button;
+};
+
+/* State at the end of a recording, to check a replay against */
+struct FinalState {
+	unsigned char score;
+	unsigned char game_over;
+	uint8_t mode;
+	uint64_t hash;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+//Everything in a Game that later ticks depend on, byte packed: the board
+//layers and shots a row at a time, every task's state and timing, counter,
+//pos, the wall queue, the bus rings, the powerup and music fields, the PRNG,
+//the display scan and the end screen animation. 164 bytes on the 8x8 board.
+const size_t kKeyframeBytes = 93 + 3 * kWallQueue + (2 * kBusRing + 3) * kBusSubscribers + (4 * Game::kRows + 2 + 3 * Game::kPanelRows) * sizeof(Game::Row);
+
+struct Keyframe {
+	uint64_t tick;
+	uint8_t state[kKeyframeBytes];
+};
+
+void pack_keyframe(const Game& g, uint8_t* out);
+void unpack_keyframe(const uint8_t* in, Game& g);
+
+struct Recording {
+	uint16_t seed = 0;
+	uint64_t ticks = 0;
+	std::vector<InputChange> changes;
+	bool has_final = false;
+	FinalState final_state = {0, 0, 0, 0};
+	/* Every keyframe_interval ticks from keyframe_interval on, 0 for none */
+	uint32_t keyframe_interval = 0;
+	std::vector<Keyframe> keyframes;
+};
+
+/* FNV-1a over every field of g that can influence later ticks */
+uint64_t state_hash(const Game& g);
+FinalState final_state_of(const Game& g);
+
+bool write_recording(const char* path, const Recording& rec, const char* comment = nullptr);
+bool read_recording(const char* path, Recording& rec, std::string& error);
+
+////////////////////////////////////////////////////////////////////////////////
+//Walks a change list tick by tick; ticks must not go backwards
+class InputCursor {
+public:
+	explicit InputCursor(const std::vector<InputChange>& changes) : changes_(changes) {}
+	/* Starts at tick, which at() may then be called with */
+	InputCursor(const std::vector<InputChange>& changes, uint64_t tick);
+
+	Input at(uint64_t tick) {
+		while(next_ < changes_.size() && changes_[next_].tick <= tick) {
+			in_.stick_x = changes_[next_].stick_x;
+			in_.button = changes_[next_].button;
+			++next_;
+		}
+		return in_;
+	}
+
+private:
+	const std::vector<InputChange>& changes_;
+	size_t next_ = 0;
+	Input in_;
+};
+
+/* Resets g to the recording's seed and runs it for up to max_ticks ticks */
+void replay(const Recording& rec, Game& g, uint64_t max_ticks = UINT64_MAX);
+/* Puts g in its state after tick ticks from the last keyframe before it,
+   returning how many ticks had to be simulated */
+uint64_t seek(const Recording& rec, uint64_t tick, Game& g);
+/* Replaces the keyframes of rec by one every interval ticks */
+void add_keyframes(Recording& rec, uint32_t interval);
+
+////////////////////////////////////////////////////////////////////////////////
+//Records a game as it is played: call record() with the input right before
+//every g.tick(), then finish() once done.
+class Recorder {
+public:
+	explicit Recorder(uint16_t seed, uint32_t keyframe_interval = 0) {
+		rec_.seed = seed;
+		rec_.keyframe_interval = keyframe_interval;
+	}
+
+	void record(const Game& g, const Input& in);
+	/* Recording so far, with g as its final state */
+	const Recording& finish(const Game& g);
+
+private:
+	Recording rec_;
+	Input last_;
+};
+
+//Rebuilds the recording of a game from a hardware telemetry capture. The unit
+//must have been captured from power on (seed 0) or the capture has to contain
+//a restart, which is then where the recording starts. Every wall, score,
+//move, pickup and game end in the capture is checked against the simulator,
+//and every one the simulator makes has to be in the capture; false with error
+//set at the first disagreement, e.g. where records other than the restarts of
+//a held button were dropped.
+bool recording_from_telemetry(const std::vector<TelemetryEvent>& events, Recording& rec,
+	std::string& error);
+
+} // namespace escalade
+
+#endif
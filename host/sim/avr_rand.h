@@ -0,0 +1,42 @@
+// Host model of the avr-libc pseudo random number generator.
+
+////////////////////////////////////////////////////////////////////////////////
+
+#ifndef ESCALADE_AVR_RAND_H
+#define ESCALADE_AVR_RAND_H
+
+#include <stdint.h>
+
+namespace escalade {
+
+////////////////////////////////////////////////////////////////////////////////
+//Functionality - bit-exact copy of avr-libc's rand()/srand() so the host draws
+//the same walls and powerups as the ATmega1284p for the same seeder value.
+//avr-libc uses the Park-Miller "minimal standard" generator with RAND_MAX 0x7FFF
+//and a 16-bit unsigned int seed.
+struct AvrRand {
+	static const int16_t kRandMax = 0x7FFF;
+
+	uint32_t next = 1;
+
+	void seed(uint16_t s) { next = s; }
+
+	int16_t rand() {
+		int32_t x = (int32_t)next;
+		if(x == 0) {
+			x = 123459876L;
+		}
+		int32_t hi = x / 127773L;
+		int32_t lo = x % 127773L;
+		x = 16807L * lo - 2836L * hi;
+		if(x < 0) {
+			x += 0x7fffffffL;
+		}
+		next = (uint32_t)x;
+		return (int16_t)(next % ((uint32_t)kRandMax + 1));
+	}
+};
+
+} // namespace escalade
+
+#endif //ESCALADE_AVR_RAND_H
@@ -0,0 +1,949 @@
+// Host port of the Escalade game logic in main.c.
+
+////////////////////////////////////////////////////////////////////////////////
+
+#include "game.h"
+
+#include <string.h>
+
+#include "../../pt.h"
+
+namespace escalade {
+
+const uint8_t kWallPatterns[10] = {
+	0x1F, /* 1:  X X X X X O O O */
+	0xF8, /* 2:  O O O X X X X X */
+	0xE7, /* 3:  X X X O O X X X */
+	0xFC, /* 4:  O O X X X X X X */
+	0x3F, /* 5:  X X X X X X O O */
+	0xDB, /* 6:  X X O X X O X X */
+	0x7E, /* 7:  O X X X X X X O */
+	0x77, /* 8:  X X X O X X X O */
+	0xEE, /* 9:  O X X X O X X X */
+	0x55, /* 10: X O X O X O X O */
+};
+
+const uint32_t kTaskPeriods[kNumTasks] = {45, 45, 200, 75, 250};
+
+/* The levels the firmware is built with */
+namespace {
+#define PROGMEM
+#include "../../levels.h"
+#undef PROGMEM
+}
+
+const uint8_t* const kLevelData = level_data;
+const int kLevelCount = LEVEL_COUNT;
+const uint16_t kLevelStart[LEVEL_COUNT + 1] = {0, LEVEL_STARTS};
+static_assert(LEVEL >= 0 && LEVEL <= LEVEL_COUNT, "LEVEL is not in levels.h");
+
+/* Notes played by playMusic, frqs[] after set_frequencies() */
+static const double frqs[58] = {
+	164.81, 164.81, 164.81, 130.81, 164.81, 195.99, 195.99,
+	164.81, 195.99, 164.81, 220, 246.94, 233.08, 220, 195.99,
+	164.81, 195.99, 220.00, 174.61, 195.99, 164.81, 261.63,
+	261.63, 195.99,
+	164.81, 220.00, 246.94, 116.54, 220.00, 195.99,
+	164.81, 195.99, 220.00, 174.61, 195.99, 164.81, 261.63, 146.83, 246.94,
+	195.99, 184.99, 174.61, 311.13, 164.81,
+	220.00, 220.00, 261.63, 220.00, 261.63, 146.83,
+	195.99, 184.99, 174.61, 311.13, 164.81, 261.63, 261.63, 261.63,
+};
+
+/* Sprites and digit font of sprite.h, top row first, bit 7 / bit 2 on the left */
+static const uint8_t kSpriteWin[8] = {0x00, 0xE7, 0xA5, 0xE7, 0x00, 0x81, 0x42, 0x3C};
+static const uint8_t kSpriteLose[8] = {0x00, 0xE7, 0xA5, 0xE7, 0x00, 0x3C, 0x42, 0x81};
+
+static const int kFontRows = 5;
+static const int kFontCols = 3;
+static const uint8_t kFont[10][kFontRows] = {
+	{0x7, 0x5, 0x5, 0x5, 0x7}, {0x2, 0x6, 0x2, 0x2, 0x7}, {0x7, 0x1, 0x7, 0x4, 0x7},
+	{0x7, 0x1, 0x7, 0x1, 0x7}, {0x5, 0x5, 0x7, 0x1, 0x1}, {0x7, 0x4, 0x7, 0x1, 0x7},
+	{0x7, 0x4, 0x7, 0x5, 0x7}, {0x7, 0x1, 0x1, 0x1, 0x1}, {0x7, 0x5, 0x7, 0x5, 0x7},
+	{0x7, 0x5, 0x7, 0x1, 0x7},
+};
+
+/* sprite_draw(): an 8x8 sprite with its bottom right corner at row y, column x */
+template<typename Row>
+static void sprite_draw(Row* layer, const uint8_t* sprite, int x, int y) {
+	Row keep = (Row)~((Row)0xFF << x);
+	for(int r = 0; r < 8; ++r) {
+		Row& out = layer[y + 7 - r];
+		out = (Row)((out & keep) | ((Row)sprite[r] << x));
+	}
+}
+
+/* sprite_text(): value in decimal as a strip of glyph rows, returns the width */
+static int sprite_text(uint16_t strip[kFontRows], unsigned char value) {
+	unsigned char digits[3];
+	int n = 0;
+	do {
+		digits[n++] = value % 10;
+		value /= 10;
+	} while(value);
+
+	int width = n * (kFontCols + 1) - 1;
+	memset(strip, 0, kFontRows * sizeof(strip[0]));
+	while(n) {
+		const uint8_t* glyph = kFont[digits[--n]];
+		for(int r = 0; r < kFontRows; ++r) {
+			strip[r] = (uint16_t)((strip[r] << (kFontCols + 1)) | glyph[r]);
+		}
+	}
+	return width;
+}
+
+/* sprite_draw_text(): the strip scrolled in from the right by step columns */
+template<typename Row>
+static void sprite_draw_text(Row* layer, const uint16_t strip[kFontRows], int width, int step, int y) {
+	for(int r = 0; r < kFontRows; ++r) {
+		layer[y + kFontRows - 1 - r] = step >= width ? (Row)((Row)strip[r] << (step - width))
+		                                             : (Row)(strip[r] >> (width - step));
+	}
+}
+
+/* Subscribers of bus.h, kSubMove and kSubPowerup */
+const BusSubscriber kBusSubscriberTable[kBusSubscribers] = {
+	{1 << kBusMove, kMoveObject, true},
+	{1 << kBusPowerup, kPowerupShooting, true},
+};
+
+static const signed char kInitialStates[kNumTasks] = {init, mO_init, mW_init, PT_START, pM_wait};
+
+template<int Rows, int Cols>
+void BasicGame<Rows, Cols>::power_on() {
+	*this = BasicGame();
+	GND = 0x01;
+	counter = kTop;
+	adc = kStickCenter;
+	rng.next = 1;
+
+	for(int t = 0; t < kNumTasks; ++t) {
+		tasks[t].state = kInitialStates[t];
+		tasks[t].period = kTaskPeriods[t];
+		tasks[t].elapsedTime = kTaskPeriods[t];
+	}
+
+	rng.seed((uint16_t)seeder);
+	PWM_on();
+
+	height = 0;
+	width = kStartCol;
+	player_rows[height] = bit(width);
+
+	play_level(LEVEL);
+
+	mode = kRun;
+}
+
+template<int Rows, int Cols>
+void BasicGame<Rows, Cols>::reset(uint16_t seed) {
+	power_on();
+	seeder = (int16_t)seed;
+}
+
+template<int Rows, int Cols>
+void BasicGame<Rows, Cols>::restart() {
+	clear_board();
+
+	game_over = 0x00;
+	score = 0;
+
+	height = 0;
+	width = kStartCol;
+
+	player_rows[height] = bit(width);
+
+	for(int t = 0; t < kNumTasks; ++t) {
+		tasks[t].state = kInitialStates[t];
+		tasks[t].period = kTaskPeriods[t];
+		tasks[t].elapsedTime = kTaskPeriods[t];
+	}
+
+	/* The scan goes on where it was: display.h keeps it out of GameState */
+	B2 = 0x01;
+	PWM_on();
+	i = 0;
+	screen_step = 0;
+	screen_ms = 0;
+	seeder = 0;
+	powerup_activated = 0x00;
+	powerup_remainingTime = 0x00;
+	shot_cooldown = 0;
+	memset(shot_fired, 0, sizeof(shot_fired));
+	memset(shot_col, 0, sizeof(shot_col));
+	memset(shot_next, 0, sizeof(shot_next));
+	memset(bus_topic, 0, sizeof(bus_topic));
+	memset(bus_arg, 0, sizeof(bus_arg));
+	memset(bus_head, 0, sizeof(bus_head));
+	memset(bus_count, 0, sizeof(bus_count));
+	memset(bus_lost, 0, sizeof(bus_lost));
+	counter = kTop;
+	pos = 0;
+	wall = 0;
+	memset(wall_next, 0, sizeof(wall_next));
+	memset(wall_spawn, 0, sizeof(wall_spawn));
+	memset(wall_period, 0, sizeof(wall_period));
+	wall_head = 0;
+	wall_count = 0;
+	wall_last = 0;
+	play_level(LEVEL);
+}
+
+template<int Rows, int Cols>
+void BasicGame<Rows, Cols>::play_level(int n) {
+	level = (unsigned char)n;
+	level_pos = kLevelStart[n];
+	level_run = 0;
+}
+
+template<int Rows, int Cols>
+void BasicGame<Rows, Cols>::tick(const Input& in) {
+	adc = in.stick_x;
+	++ticks;
+	timer_fast();
+	B2 = in.button ? 0x02 : 0x00;
+
+	if(mode == kRun) {
+		if(B2 == 2) {
+			restart();
+		}
+
+		if(game_over == 0x00 && score < kWinScore && B2 != 2) {
+			run_tasks();
+		}
+
+		else if(score >= kWinScore) {
+			clear_board();
+			screen_step = 0;
+			screen_ms = 0;
+			mode = kWinScreen;
+			return;
+		}
+
+		else if(game_over == 0x01) {
+			clear_board();
+			screen_step = 0;
+			screen_ms = 0;
+			mode = kLoseScreen;
+			return;
+		}
+
+		/* Idle work before the timer wait */
+		walls_fill();
+		return;
+	}
+
+	end_screen(mode == kWinScreen);
+	PWM_off();
+
+	if(B2 == 2) {
+		restart();
+		mode = kRun;
+		walls_fill();
+	}
+}
+
+template<int Rows, int Cols>
+void BasicGame<Rows, Cols>::run_tasks() {
+	for(int t = 0; t < kNumTasks; ++t) {
+		Task& task = tasks[t];
+		if(task.elapsedTime >= task.period) { /* a task woken by the bus can be past it */
+			switch(t) {
+				case kGetMovement: task.state = getMovement(task.state); break;
+				case kMoveObject: task.state = moveObject(task.state); break;
+				case kMoveWalls: task.state = moveWalls(task.state); break;
+				case kPowerupShooting: task.state = powerupShooting(task.state); break;
+				default: task.state = playMusic(task.state); break;
+			}
+			task.elapsedTime = 0;
+			if(game_over == 0x01) {
+				break;
+			}
+
+			/* Speeds up, unless a level sets the speed */
+			if(score == 20 && level == 0) {
+				tasks[kMoveWalls].period = 150;
+			}
+
+			else if(score == 40 && level == 0) {
+				tasks[kMoveWalls].period = 100;
+			}
+
+			rng.seed((uint16_t)seeder);
+		}
+		task.elapsedTime += 1;
+	}
+}
+
+template<int Rows, int Cols>
+void BasicGame<Rows, Cols>::clear_board() {
+	memset(wall_rows, 0, sizeof(wall_rows));
+	memset(powerup_rows, 0, sizeof(powerup_rows));
+	memset(player_rows, 0, sizeof(player_rows));
+	shots_clear();
+}
+
+template<int Rows, int Cols>
+void BasicGame<Rows, Cols>::end_screen(bool won) {
+	const uint8_t* face = won ? kSpriteWin : kSpriteLose;
+	uint16_t strip[kFontRows];
+
+	if(screen_ms == 0) {
+		if(screen_step == 0) {
+			memset(powerup_rows, 0, sizeof(powerup_rows));
+			sprite_draw(wall_rows, face, (Cols - 8) / 2, 0);
+		}
+
+		else {
+			if(screen_step == 1) {
+				memset(wall_rows, 0, sizeof(wall_rows));
+			}
+			int width = sprite_text(strip, score);
+			sprite_draw_text(powerup_rows, strip, width, screen_step, (Rows - kFontRows) / 2);
+		}
+	}
+
+	if(++screen_ms == (screen_step ? kEndScrollMs : kEndFaceMs)) {
+		screen_ms = 0;
+		if(++screen_step == sprite_text(strip, score) + Cols) {
+			screen_step = 0;
+		}
+	}
+}
+
+template<int Rows, int Cols>
+void BasicGame<Rows, Cols>::compose(int8_t out[Rows][Cols]) const {
+	for(int r = 0; r < Rows; ++r) {
+		for(int c = 0; c < Cols; ++c) {
+			Row m = bit(c);
+			out[r][c] = (shot_rows[r] & m) ? kBullet :
+				(player_rows[r] & m) ? kPlayer :
+				(wall_rows[r] & m) ? kWall :
+				(powerup_rows[r] & m) ? kPowerup : kEmpty;
+		}
+	}
+}
+
+template<int Rows, int Cols>
+void BasicGame<Rows, Cols>::set_PWM(double frequency) {
+	if(frequency != current_frequency) {
+		current_frequency = frequency;
+	}
+}
+
+template<int Rows, int Cols>
+void BasicGame<Rows, Cols>::PWM_on() {
+	pwm_on = true;
+	set_PWM(0);
+}
+
+template<int Rows, int Cols>
+void BasicGame<Rows, Cols>::PWM_off() {
+	pwm_on = false;
+}
+
+template<int Rows, int Cols>
+void BasicGame<Rows, Cols>::timer_fast() {
+	shift();
+}
+
+template<int Rows, int Cols>
+void BasicGame<Rows, Cols>::shift() {
+	if(row == 7) {
+		GND = 0x01;
+		row = 0;
+	}
+
+	else {
+		GND = (unsigned char)(GND << 1);
+		row++;
+	}
+
+	/* The same row of every panel: each layer is one color, shots are white,
+	   inverted due to the common anode LED matrices */
+	scan.gnd = GND;
+	for(int y = 0; y < kPanelRows; ++y) {
+		int r = 8 * y + row;
+		scan.r[y] = (Row)~(player_rows[r] | shot_rows[r]);
+		scan.g[y] = (Row)~(powerup_rows[r] | shot_rows[r]);
+		scan.b[y] = (Row)~(wall_rows[r] | shot_rows[r]);
+	}
+}
+
+template<int Rows, int Cols>
+int BasicGame<Rows, Cols>::getMovement(int state) {
+	switch(state) {
+		case init:
+			state = wait;
+			break;
+
+		case wait:
+			state = x_axis;
+			break;
+
+		case x_axis:
+			state = wait;
+			break;
+
+		default:
+			break;
+	}
+
+	switch(state) {
+		case wait:
+			break;
+
+		case x_axis:
+			x_val = adc;
+
+			if(x_val > 900) {
+				bus_publish(kBusMove, 0x01); /* Right */
+			}
+
+			else if(x_val < 100) {
+				bus_publish(kBusMove, 0x02); /* Left */
+			}
+
+			break;
+
+		default:
+			break;
+	}
+
+	return state;
+}
+
+template<int Rows, int Cols>
+void BasicGame<Rows, Cols>::powerup_pickup(int col) {
+	if(powerup_activated == 0x00) {
+		powerup_activated = 0x01;
+		bus_publish(kBusPowerup, (unsigned char)col);
+	}
+}
+
+template<int Rows, int Cols>
+void BasicGame<Rows, Cols>::bus_publish(unsigned char topic, unsigned char arg) {
+	for(int s = 0; s < kBusSubscribers; ++s) {
+		if(!(kBusSubscriberTable[s].topics & (1 << topic))) {
+			continue;
+		}
+
+		if(bus_count[s] == kBusRing) {
+			if(bus_lost[s] != 0xFF) {
+				++bus_lost[s];
+			}
+		}
+
+		else {
+			int k = (bus_head[s] + bus_count[s]) & (kBusRing - 1);
+			bus_topic[s][k] = topic;
+			bus_arg[s][k] = arg;
+			++bus_count[s];
+		}
+
+		if(kBusSubscriberTable[s].wake) {
+			Task& t = tasks[kBusSubscriberTable[s].task];
+			t.elapsedTime = t.period;
+		}
+	}
+}
+
+template<int Rows, int Cols>
+unsigned char BasicGame<Rows, Cols>::bus_take(int s, unsigned char& arg) {
+	if(bus_count[s] == 0) {
+		return kBusEmpty;
+	}
+
+	int k = bus_head[s];
+	bus_head[s] = (unsigned char)((k + 1) & (kBusRing - 1));
+	--bus_count[s];
+	arg = bus_arg[s][k];
+	return bus_topic[s][k];
+}
+
+template<int Rows, int Cols>
+int BasicGame<Rows, Cols>::moveObject(int state) {
+	switch(state) {
+		case mO_init:
+			state = mO_wait;
+			break;
+
+		case mO_wait: {
+			unsigned char move;
+			if(bus_take(kSubMove, move) != kBusEmpty) {
+				state = move == 0x01 ? mO_right : mO_left;
+			}
+
+			break;
+		}
+
+		case mO_right:
+		case mO_left:
+			state = mO_wait;
+			break;
+
+		default:
+			break;
+	}
+
+	if(state == mO_right || state == mO_left) {
+		/* The player is the only thing in its layer */
+		player_rows[height] = 0;
+
+		/* Right decreases width, left increases it, wrapping at the edges */
+		if(state == mO_right) {
+			width = (width == 0) ? Cols - 1 : width - 1;
+		}
+
+		else {
+			width = (width == Cols - 1) ? 0 : width + 1;
+		}
+
+		Row m = bit(width);
+		if(wall_rows[height] & m) {
+			game_over = 0x01;
+		}
+
+		else {
+			if(powerup_rows[height] & m) {
+				powerup_pickup(width);
+				powerup_rows[height] &= (Row)~m;
+			}
+			player_rows[height] = m;
+		}
+
+		/* Creates new seed for randomness for walls */
+		++seeder;
+	}
+
+	return state;
+}
+
+template<int Rows, int Cols>
+int BasicGame<Rows, Cols>::moveWalls(int state) {
+	switch(state) {
+		case mW_init:
+			state = mW_wait;
+			break;
+
+		case mW_wait:
+			state = mW_generate;
+			break;
+
+		case mW_generate:
+			state = mW_move;
+			break;
+
+		case mW_move:
+			if(counter == 0) {
+				score = score + 1;
+				state = mW_generate;
+				powerup_randomNum = 0;
+			}
+
+			break;
+
+		default:
+			break;
+	}
+
+	switch(state) {
+		case mW_generate:
+			generate_walls();
+			break;
+
+		case mW_move:
+			move_walls();
+			break;
+
+		default:
+			break;
+	}
+
+	return state;
+}
+
+template<int Rows, int Cols>
+unsigned char BasicGame<Rows, Cols>::walls_moves(unsigned char score) {
+	int period = score >= 40 ? 100 : (score >= 20 ? 150 : 200);
+	int moves = (kTop * period - kWallReactMs) / kWallMoveMs - 1;
+	return (unsigned char)(moves < Cols / 2 ? moves : Cols / 2);
+}
+
+template<int Rows, int Cols>
+bool BasicGame<Rows, Cols>::walls_passable(Row from, Row mask, unsigned char moves) {
+	Row reach = (Row)~mask;
+	while(from & (Row)~reach) {
+		if(moves-- == 0) {
+			return false;
+		}
+		reach |= (Row)(reach << 1) | (Row)(reach >> (Cols - 1)) |
+			(Row)(reach >> 1) | (Row)(reach << (Cols - 1));
+	}
+	return true;
+}
+
+/* walls_draw(): open blocks open, in one opening or two */
+static uint8_t walls_draw(AvrRand& rng, unsigned char open) {
+	uint8_t p = 0xFF;
+	unsigned char split = open;
+
+	if(open > 1 && (rng.rand() & 0x01)) {
+		split = open / 2;
+	}
+
+	unsigned char at = (unsigned char)(rng.rand() % 8);
+	for(unsigned char k = 0; k < open; ++k) {
+		if(k == split) {
+			at = (unsigned char)(rng.rand() % 8);
+		}
+		p &= (uint8_t)~(1 << (at % 8));
+		++at;
+	}
+	return p;
+}
+
+template<int Rows, int Cols>
+void BasicGame<Rows, Cols>::walls_fill() {
+	if(wall_count == kWallQueue) {
+		return;
+	}
+
+	uint8_t p;
+	unsigned char spawn, period;
+	if(level && level_next(p, spawn, period)) {
+		walls_queue(p, spawn, period);
+		return;
+	}
+
+	++seeder;
+	rng.seed((uint16_t)seeder);
+
+	/* Score when the wall comes down, after the one on the board and the
+	   queued ones */
+	unsigned char at_score = (unsigned char)(score + wall_count + 1);
+	unsigned char open = at_score < 20 ? 3 : (at_score < 40 ? 2 : 1);
+	unsigned char moves = walls_moves(at_score);
+	Row from = (Row)~stretch<Cols>(wall_last);
+
+	for(int tries = 1; ; ++tries) {
+		p = walls_draw(rng, open);
+		if(walls_passable(from, stretch<Cols>(p), moves)) {
+			break;
+		}
+
+		if(tries == kWallTries) {
+			p &= wall_last;
+			break;
+		}
+	}
+
+	/* 20% chance of a powerup in an opening of the wall */
+	spawn = kNoPowerup;
+	unsigned char roll = (unsigned char)(rng.rand() % 10 + 1);
+	if(roll == 1 || roll == 5) {
+		int b = rng.rand() % 8;
+		while(p & (1 << b)) {
+			b = (b + 1) % 8;
+		}
+		spawn = (unsigned char)(b * (Cols / 8) + rng.rand() % (Cols / 8));
+	}
+
+	walls_queue(p, spawn, 0);
+}
+
+template<int Rows, int Cols>
+void BasicGame<Rows, Cols>::walls_queue(uint8_t p, unsigned char spawn, unsigned char period) {
+	int k = (wall_head + wall_count) % kWallQueue;
+	wall_next[k] = p;
+	wall_spawn[k] = spawn;
+	wall_period[k] = period;
+	wall_last = p;
+	++wall_count;
+}
+
+template<int Rows, int Cols>
+bool BasicGame<Rows, Cols>::level_next(uint8_t& pattern, unsigned char& spawn, unsigned char& period) {
+	spawn = kNoPowerup;
+	period = 0;
+
+	while(level_run == 0) {
+		uint8_t op = kLevelData[level_pos];
+		if(op == kLevelEnd) {
+			return false;
+		}
+
+		uint8_t arg = kLevelData[level_pos + 1];
+		level_pos = (uint16_t)(level_pos + 2);
+		if(op & kLevelWalls) {
+			level_run = (unsigned char)((op & ~kLevelWalls) + 1);
+		}
+
+		else if(op == kLevelSpeed) {
+			period = arg;
+		}
+
+		else {
+			spawn = (unsigned char)(arg * (Cols / 8));
+		}
+	}
+
+	--level_run;
+	pattern = kLevelData[level_pos - 1];
+	return true;
+}
+
+template<int Rows, int Cols>
+void BasicGame<Rows, Cols>::walls_take() {
+	if(wall_count == 0) {
+		walls_fill();
+	}
+
+	int k = wall_head;
+	wall_head = (unsigned char)((k + 1) % kWallQueue);
+	--wall_count;
+
+	wall = stretch<Cols>(wall_next[k]);
+	if(wall_period[k]) {
+		tasks[kMoveWalls].period = wall_period[k];
+	}
+	if(powerup_activated == 0x00) {
+		powerup_randomNum = (wall_spawn[k] != kNoPowerup);
+		if(powerup_randomNum) {
+			powerup_spawn = wall_spawn[k];
+		}
+	}
+}
+
+template<int Rows, int Cols>
+void BasicGame<Rows, Cols>::generate_walls() {
+	counter = kTop;
+
+	/* The next wall and its powerup, made ahead by walls_fill() */
+	walls_take();
+
+	/* Disables walls and powerups left over on the bottom row */
+	wall_rows[0] = 0;
+	powerup_rows[0] = 0;
+	wall_rows[kTop] = 0;
+	powerup_rows[kTop] = 0;
+	pos = 0;
+
+	wall_rows[kTop] = wall;
+
+	if(powerup_activated == 0x00 && powerup_spawned()) {
+		powerup_rows[kTop] = bit(powerup_spawn);
+	}
+
+	shots_hit_row(kTop);
+}
+
+template<int Rows, int Cols>
+void BasicGame<Rows, Cols>::move_walls() {
+	Row mask = wall;
+
+	/* Columns already broken, e.g. by a shot, stay open */
+	pos |= mask & (Row)~wall_rows[counter];
+	wall_rows[counter] &= (Row)~mask;
+
+	if(powerup_spawned()) {
+		powerup_rows[counter] &= (Row)~bit(powerup_spawn);
+	}
+
+	counter = counter - 1;
+
+	/* The wall lands on the player */
+	if(mask & (Row)~pos & player_rows[counter]) {
+		game_over = 0x01;
+	}
+
+	else {
+		wall_rows[counter] = (Row)((wall_rows[counter] & ~mask) | (mask & ~pos));
+		powerup_rows[counter] &= (Row)~mask;
+
+		if(powerup_activated == 0x00 && powerup_spawned()) {
+			if(player_rows[counter] & bit(powerup_spawn)) {
+				powerup_pickup(width);
+			}
+
+			else {
+				powerup_rows[counter] |= bit(powerup_spawn);
+			}
+		}
+	}
+
+	shots_hit_row(counter);
+}
+
+/* A protothread as in main.c, see ../../pt.h */
+template<int Rows, int Cols>
+int BasicGame<Rows, Cols>::powerupShooting(int state) {
+	unsigned char col;
+
+	PT_BEGIN(state);
+	PT_YIELD();
+
+	while(1) {
+		PT_AWAIT(bus_take(kSubPowerup, col) != kBusEmpty);
+		powerup_remainingTime = kShotSteps;
+		shot_cooldown = 0;
+
+		while(1) {
+			/* A volley */
+			shots_advance();
+			if(powerup_remainingTime > 0) {
+				for(int c = width - kShotSpread; c <= width + kShotSpread; ++c) {
+					if(c >= 0 && c < Cols) {
+						shots_fire(c);
+					}
+				}
+				shot_cooldown = kShotInterval - 1;
+				powerup_remainingTime = powerup_remainingTime - 1;
+			}
+			shots_hit_row(counter);
+			PT_YIELD();
+
+			if(powerup_remainingTime == 0) {
+				break;
+			}
+
+			/* The shots fly on until the next volley */
+			while(shot_cooldown != 0 && powerup_remainingTime != 0) {
+				shots_advance();
+				shots_hit_row(counter);
+				shot_cooldown = shot_cooldown - 1;
+				powerup_remainingTime = powerup_remainingTime - 1;
+				PT_YIELD();
+			}
+		}
+
+		powerup_activated = 0x00;
+		shots_clear();
+		PT_YIELD();
+	}
+
+	PT_END();
+}
+
+template<int Rows, int Cols>
+bool BasicGame<Rows, Cols>::shots_in_use(int s) const {
+	unsigned char r = (unsigned char)(shot_clock - shot_fired[s] + 1);
+	return r < Rows && ((shot_rows[r] >> shot_col[s]) & 0x01);
+}
+
+template<int Rows, int Cols>
+void BasicGame<Rows, Cols>::shots_sweep() {
+	for(int s = 0; s < shot_fresh; ++s) {
+		if(!shots_in_use(s)) {
+			shot_next[s] = shot_free;
+			shot_free = (unsigned char)(s + 1);
+		}
+	}
+}
+
+template<int Rows, int Cols>
+void BasicGame<Rows, Cols>::shots_fire(int col) {
+	Row m = bit(col);
+
+	if(shot_rows[1] & m) {
+		return;
+	}
+
+	if(!shot_free && shot_fresh == kShotCapacity) {
+		shots_sweep();
+	}
+
+	unsigned char s = shot_free;
+	if(s) {
+		shot_free = shot_next[s - 1];
+	}
+
+	else if(shot_fresh < kShotCapacity) {
+		s = ++shot_fresh;
+	}
+
+	else {
+		return;
+	}
+
+	shot_fired[s - 1] = shot_clock;
+	shot_col[s - 1] = (unsigned char)col;
+	shot_rows[1] |= m;
+}
+
+template<int Rows, int Cols>
+void BasicGame<Rows, Cols>::shots_hit_row(int r) {
+	Row hits = shot_rows[r] & wall_rows[r];
+	wall_rows[r] &= (Row)~hits;
+	if(!kShotPierce) {
+		shot_rows[r] &= (Row)~hits;
+	}
+}
+
+template<int Rows, int Cols>
+void BasicGame<Rows, Cols>::shots_advance() {
+	for(int r = kTop; r > 1; --r) {
+		shot_rows[r] = shot_rows[r - 1];
+	}
+	shot_rows[1] = 0;
+	++shot_clock;
+}
+
+template<int Rows, int Cols>
+void BasicGame<Rows, Cols>::shots_clear() {
+	memset(shot_rows, 0, sizeof(shot_rows));
+	shot_clock = 0;
+	shot_free = 0;
+	shot_fresh = 0;
+}
+
+template<int Rows, int Cols>
+int BasicGame<Rows, Cols>::playMusic(int state) {
+	switch(state) {
+		case pM_wait:
+			state = pM_play;
+			break;
+
+		case pM_play:
+			if(i <= 16) {
+				++i;
+			}
+
+			if(i > 16) {
+				i = 0;
+			}
+
+			break;
+
+		default:
+			break;
+	}
+
+	switch(state) {
+		case pM_wait:
+			set_PWM(0);
+			i = 0;
+			break;
+
+		case pM_play:
+			set_PWM(frqs[i]);
+			break;
+
+		default:
+			break;
+	}
+
+	return state;
+}
+
+/* The board of the firmware build, and the two bigger panels it was tried on */
+template struct BasicGame<BOARD_ROWS, BOARD_COLS>;
+#if BOARD_ROWS != 16 || BOARD_COLS != 16
+template struct BasicGame<16, 16>;
+#endif
+#if BOARD_ROWS != 8 || BOARD_COLS != 32
+template struct BasicGame<8, 32>;
+#endif
+
+} // namespace escalade
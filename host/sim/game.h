@@ -0,0 +1,322 @@
+// Host port of the Escalade game logic in main.c.
+
+////////////////////////////////////////////////////////////////////////////////
+
+#ifndef ESCALADE_GAME_H
+#define ESCALADE_GAME_H
+
+#include <stdint.h>
+
+#include <type_traits>
+
+#include "avr_rand.h"
+
+/* Board geometry, set with the same -DBOARD_ROWS/-DBOARD_COLS as ../board.h */
+#ifndef BOARD_ROWS
+#define BOARD_ROWS 8
+#endif
+#ifndef BOARD_COLS
+#define BOARD_COLS 8
+#endif
+/* Level played from power on, as -DLEVEL for ../level.h; 0 for random walls */
+#ifndef LEVEL
+#define LEVEL 0
+#endif
+
+namespace escalade {
+
+/* What compose() puts in a cell, the led_arr values main.c used before the
+   board was split into layers. kBullet marks a shot. */
+enum Cell : int8_t { kEmpty = 0, kPowerup = 1, kWall = 2, kPlayer = 3, kBullet = 4 };
+
+/* Thumbstick thresholds used by getMovement */
+const uint16_t kStickRight = 1023; /* > 900 moves right (width - 1) */
+const uint16_t kStickLeft = 0;     /* < 100 moves left  (width + 1) */
+const uint16_t kStickCenter = 512;
+
+/* Thumbstick positions, named after the moves getMovement publishes */
+enum Action : uint8_t { kStay = 0, kRight = 1, kLeft = 2 };
+
+inline uint16_t stick_for(Action a) {
+	return a == kRight ? kStickRight : (a == kLeft ? kStickLeft : kStickCenter);
+}
+
+const unsigned char kWinScore = 60;
+const int kNumTasks = 5;
+
+/* Shot pool of shots.h, with its default build options */
+const int kShotCapacity = 8;
+const int kShotInterval = 7;
+const int kShotSpread = 0;
+const bool kShotPierce = true;
+const unsigned char kShotSteps = 112;
+
+/* Wall generator of walls.h */
+const int kWallQueue = 4;
+const unsigned char kNoPowerup = 0xFF;
+const int kWallTries = 4;
+const int kWallMoveMs = 90;
+const int kWallReactMs = 300;
+
+/* Authored levels of ../levels.h in the format of ../level.h, n from 1 to
+   kLevelCount starting at kLevelData[kLevelStart[n]] */
+enum LevelOp : uint8_t { kLevelEnd = 0x00, kLevelSpeed = 0x01, kLevelPowerup = 0x02, kLevelWalls = 0x80 };
+extern const uint8_t* const kLevelData;
+extern const int kLevelCount;
+extern const uint16_t kLevelStart[];
+
+/* Event bus of bus.h: topics, subscribers in kBusSubscriberTable order, and
+   what each listens to and which task it wakes */
+enum BusTopic : unsigned char { kBusMove = 0, kBusPowerup = 1, kBusEmpty = 0xFF };
+enum BusSubscriberId { kSubMove = 0, kSubPowerup = 1 };
+const int kBusSubscribers = 2;
+const int kBusRing = 4;
+struct BusSubscriber {
+	unsigned char topics;
+	int task;
+	bool wake;
+};
+extern const BusSubscriber kBusSubscriberTable[kBusSubscribers];
+
+/* End screen timing of main.c */
+const unsigned short kEndFaceMs = 1500;
+const unsigned short kEndScrollMs = 100;
+
+/* The ten fixed wall patterns mW_generate picked from before walls.h made
+   walls, bit n = column n, for 8 columns; BasicGame::kWalls has them
+   stretched to its width. escalade_autoplay -c and the bench still use them. */
+extern const uint8_t kWallPatterns[10];
+
+////////////////////////////////////////////////////////////////////////////////
+//The smallest unsigned type with a bit per column, board_row_t of board.h.
+//Boards are made of whole 8x8 panels.
+template<int Lines> struct LineMask {
+	static_assert(Lines % 8 == 0 && Lines >= 8 && Lines <= 64, "a multiple of 8 from 8 to 64");
+	typedef typename std::conditional<(Lines <= 8), uint8_t,
+		typename std::conditional<(Lines <= 16), uint16_t,
+		typename std::conditional<(Lines <= 32), uint32_t, uint64_t>::type>::type>::type type;
+};
+
+/* An 8-column pattern stretched to Cols columns, bit n covering Cols / 8 of
+   them, as BOARD_STRETCH */
+template<int Cols> constexpr typename LineMask<Cols>::type stretch(uint8_t p) {
+	typedef typename LineMask<Cols>::type Row;
+	Row block = (Row)(((Row)1 << (Cols / 8)) - 1);
+	Row out = 0;
+	for(int n = 0; n < 8; ++n) {
+		if((p >> n) & 0x01) {
+			out |= (Row)(block << (n * (Cols / 8)));
+		}
+	}
+	return out;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//Inputs sampled by the firmware: the thumbstick x axis ADC value and the
+//restart button on PB1.
+struct Input {
+	uint16_t stick_x = kStickCenter;
+	bool button = false;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+//Which branch of the main loop the next button read belongs to. The firmware
+//spins inside a while(1) on the win and game over screens until the button is
+//pressed, so those reads are not 1 ms apart.
+enum Mode : uint8_t { kRun, kWinScreen, kLoseScreen };
+
+////////////////////////////////////////////////////////////////////////////////
+//Same layout as task in scheduler.h, with the tick function chosen by index
+struct Task {
+	signed char state;
+	uint32_t period;
+	uint32_t elapsedTime;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+//One Escalade unit on a Rows x Cols board. Every field of main.c's GameState
+//(game_state.h) is a member with the same name and every task is a member
+//function with the same transitions and actions, so the two can be read side
+//by side. The object is trivially copyable and holds no pointers, so any
+//number of games can run at once and a copy is a full snapshot. Game is the
+//board the firmware is built for; game.cpp also instantiates a 16x16 board and
+//one of 32 columns by 8 rows.
+//
+//tick() runs one button read of the firmware main loop: in play that is one
+//1 ms scheduler tick, on the end screens one spin of the inner while(1),
+//which the end screen animation takes as 1 ms, as in the lockstep shim. Each
+//one starts with the timer interrupt's TimerFast(), timer_fast() here.
+template<int Rows, int Cols>
+struct BasicGame {
+	typedef typename LineMask<Cols>::type Row; /* a row of a layer */
+
+	static const int kRows = Rows;
+	static const int kCols = Cols;
+	static const int kTop = Rows - 1;         /* row new walls appear in */
+	static const int kStartCol = Cols / 2 - 1;
+	static const int kPanelRows = Rows / 8;
+	static constexpr Row kWalls[10] = {
+		stretch<Cols>(0x1F), stretch<Cols>(0xF8), stretch<Cols>(0xE7), stretch<Cols>(0xFC),
+		stretch<Cols>(0x3F), stretch<Cols>(0xDB), stretch<Cols>(0x7E), stretch<Cols>(0x77),
+		stretch<Cols>(0xEE), stretch<Cols>(0x55),
+	};
+
+	static Row bit(int c) { return (Row)((Row)1 << c); }
+
+	/* What the last shift() call clocked into the shift registers: the
+	   ground lines every panel shares and, per row of panels, the colors of
+	   the row it shows (display.h) */
+	struct Scan {
+		unsigned char gnd;
+		Row r[kPanelRows];
+		Row g[kPanelRows];
+		Row b[kPanelRows];
+	};
+
+	/* Display; GND and row are display_gnd and display_row of display.h */
+	unsigned char GND;
+	unsigned char B2;
+	int row;
+	Scan scan;
+	unsigned char screen_step; /* end screens: 0 the face, then scroll steps */
+	unsigned short screen_ms;
+
+	/* Game: one bitboard per layer and row, bit n = column n */
+	Row wall_rows[Rows];
+	Row powerup_rows[Rows];
+	Row player_rows[Rows];
+	int seeder;
+	unsigned char score;
+	int height, width;
+	unsigned char game_over;
+	unsigned char powerup_activated;
+
+	/* getMovement */
+	int x_val;
+
+	/* moveWalls */
+	Row wall; /* columns of the descending wall */
+	int powerup_randomNum, powerup_spawn;
+	unsigned char counter;
+	Row pos; /* wall columns already broken */
+	uint8_t wall_next[kWallQueue];        /* walls made ahead, 8-block patterns */
+	unsigned char wall_spawn[kWallQueue]; /* their powerup column or kNoPowerup */
+	unsigned char wall_period[kWallQueue]; /* and moveWalls period, 0 to keep it */
+	unsigned char wall_head, wall_count;
+	uint8_t wall_last; /* pattern of the newest wall made */
+	unsigned char level; /* level played, 0 for none */
+	uint16_t level_pos;  /* its next byte in kLevelData */
+	unsigned char level_run; /* walls left of the pattern before it */
+
+	/* powerupShooting and its shot pool; links are slot + 1, 0 ends a list */
+	unsigned char powerup_remainingTime;
+	unsigned char shot_cooldown;
+	Row shot_rows[Rows];
+	unsigned char shot_clock;
+	unsigned char shot_fired[kShotCapacity];
+	unsigned char shot_col[kShotCapacity];
+	unsigned char shot_next[kShotCapacity];
+	unsigned char shot_free, shot_fresh;
+
+	/* Event rings of bus.h, one per subscriber */
+	unsigned char bus_topic[kBusSubscribers][kBusRing];
+	unsigned char bus_arg[kBusSubscribers][kBusRing];
+	unsigned char bus_head[kBusSubscribers], bus_count[kBusSubscribers];
+	unsigned char bus_lost[kBusSubscribers]; /* events that found the ring full */
+
+	/* playMusic / set_PWM */
+	unsigned char i;
+	double current_frequency;
+	bool pwm_on;
+
+	Task tasks[kNumTasks];
+	Mode mode;
+	AvrRand rng;
+	uint16_t adc;
+	uint32_t ticks;
+
+	/* Power-on state: everything main() sets up before its first loop */
+	void power_on();
+	/* Power-on followed by seeding the wall generator with seed */
+	void reset(uint16_t seed);
+	/* Restart block of main(), run when the button is pressed */
+	void restart();
+	/* Plays level n (0 for random walls) from the next wall made on, as if
+	   the firmware had been built with -DLEVEL=n; restart() goes back to
+	   LEVEL */
+	void play_level(int n);
+	/* One main loop button read, see above */
+	void tick(const Input& in);
+
+	bool playing() const { return mode == kRun && game_over == 0x00 && score < kWinScore; }
+	bool finished() const { return mode != kRun; }
+	/* Walls, powerups and the player in row r */
+	Row occupied(int r) const { return wall_rows[r] | powerup_rows[r] | player_rows[r]; }
+	/* The board as one Cell per square, shots on top as in shift() */
+	void compose(int8_t out[Rows][Cols]) const;
+
+	/* Tasks of main.c */
+	int getMovement(int state);
+	int moveObject(int state);
+	int moveWalls(int state);
+	int powerupShooting(int state);
+	int playMusic(int state);
+
+	/* Wall generator and queue of walls.h; walls_fill() is the idle work of a
+	   main loop pass */
+	void walls_fill();
+	void walls_take();
+	bool level_next(uint8_t& pattern, unsigned char& spawn, unsigned char& period);
+	static unsigned char walls_moves(unsigned char score);
+	static bool walls_passable(Row from, Row mask, unsigned char moves);
+
+	/* Event bus of bus.h */
+	void bus_publish(unsigned char topic, unsigned char arg);
+	unsigned char bus_take(int s, unsigned char& arg);
+	/* The player takes the powerup in column col */
+	void powerup_pickup(int col);
+
+	/* Shot pool of shots.h */
+	void shots_fire(int col);
+	void shots_hit_row(int r);
+	void shots_advance();
+	void shots_clear();
+
+	/* The high priority level of timer.h: a display scan step; the stick
+	   sample it latches is adc */
+	void timer_fast();
+	void shift();
+	void set_PWM(double frequency);
+	void PWM_on();
+	void PWM_off();
+
+private:
+	void run_tasks();
+	void clear_board();
+	void end_screen(bool won);
+	void walls_queue(uint8_t p, unsigned char spawn, unsigned char period);
+	void generate_walls();
+	void move_walls();
+	bool shots_in_use(int s) const;
+	void shots_sweep();
+	bool powerup_spawned() const { return powerup_randomNum == 1 || powerup_randomNum == 5; }
+};
+
+typedef BasicGame<BOARD_ROWS, BOARD_COLS> Game;
+
+/* Task states, same values as main.c. powerupShooting is a protothread
+   (../../pt.h) whose state is where it stopped, PT_START at power on. */
+enum getMovement_States {init, wait, x_axis};
+enum moveObject_States {mO_init, mO_wait, mO_right, mO_left};
+enum moveWalls_States {mW_init, mW_wait, mW_generate, mW_move};
+enum playMusic_States {pM_wait, pM_play};
+
+/* Task indices in tasks[], same order as main() */
+enum TaskId { kGetMovement, kMoveObject, kMoveWalls, kPowerupShooting, kPlayMusic };
+
+/* Default task periods from main() in ms */
+extern const uint32_t kTaskPeriods[kNumTasks];
+
+} // namespace escalade
+
+#endif //ESCALADE_GAME_H
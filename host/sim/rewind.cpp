@@ -0,0 +1,140 @@
+// Host port of the rewind buffer in ../rewind.h.
+
+////////////////////////////////////////////////////////////////////////////////
+
+#include "rewind.h"
+
+#include <string.h>
+
+namespace escalade {
+
+Rewind::Rewind(size_t bytes, uint32_t period) : ring_(bytes), period_(period) {}
+
+void Rewind::clear() {
+	used_ = 0;
+	entries_ = 0;
+	ms_ = 0;
+	have_prev_ = false;
+}
+
+size_t Rewind::encode(const Game& g, bool write, size_t pos_at) {
+	const uint8_t* cur = (const uint8_t*)&g;
+	const uint8_t* prev = (const uint8_t*)&prev_;
+	const size_t size = sizeof(Game);
+	size_t len = 0;
+	size_t pos = 0;
+
+	while(pos < size) {
+		size_t skip = 0;
+		while(pos < size && skip < 255 && cur[pos] == prev[pos]) {
+			++skip;
+			++pos;
+		}
+		if(pos == size) {
+			break;
+		}
+
+		/* The run goes on through gaps of up to two unchanged bytes */
+		size_t end = pos;
+		while(end < size && end - pos < 255) {
+			if(cur[end] != prev[end]) {
+				++end;
+			}
+
+			else if(end + 2 < size && (cur[end + 1] != prev[end + 1] || cur[end + 2] != prev[end + 2])) {
+				++end;
+			}
+
+			else {
+				break;
+			}
+		}
+
+		if(write) {
+			at(pos_at + len) = (uint8_t)skip;
+			at(pos_at + len + 1) = (uint8_t)(end - pos);
+			for(size_t k = pos; k < end; ++k) {
+				at(pos_at + len + 2 + k - pos) = cur[k] ^ prev[k];
+			}
+		}
+		len += 2 + (end - pos);
+		pos = end;
+	}
+
+	return len;
+}
+
+void Rewind::push(const Game& g) {
+	if(have_prev_) {
+		size_t len = encode(g, false, 0);
+		last_entry_ = len + 2;
+
+		if(len > kMaxEntry || len + 2 > ring_.size()) {
+			used_ = 0;
+			entries_ = 0;
+		}
+
+		else {
+			/* Drop the oldest entries until it fits */
+			while(used_ + len + 2 > ring_.size()) {
+				used_ -= at(head_ - used_) + 2;
+				--entries_;
+			}
+
+			at(head_) = (uint8_t)len;
+			encode(g, true, head_ + 1);
+			at(head_ + 1 + len) = (uint8_t)len;
+			head_ += len + 2;
+			used_ += len + 2;
+			++entries_;
+		}
+	}
+
+	memcpy((void*)&prev_, &g, sizeof(g));
+	have_prev_ = true;
+}
+
+uint32_t Rewind::restore(Game& g, uint32_t steps) {
+	uint32_t done = 0;
+	if(!have_prev_) {
+		return 0;
+	}
+
+	uint8_t* prev = (uint8_t*)&prev_;
+	while(done < steps && entries_ > 0) {
+		size_t len = at(head_ - 1);
+		size_t pos_at = head_ - 1 - len;
+		size_t end = head_ - 1;
+		size_t pos = 0;
+
+		while(pos_at != end) {
+			pos += at(pos_at);
+			size_t count = at(pos_at + 1);
+			pos_at += 2;
+			while(count--) {
+				prev[pos++] ^= at(pos_at++);
+			}
+		}
+
+		head_ -= len + 2;
+		used_ -= len + 2;
+		--entries_;
+		++done;
+	}
+
+	memcpy((void*)&g, &prev_, sizeof(g));
+	ms_ = 0;
+	return done;
+}
+
+bool Rewind::tick(const Game& g) {
+	if(!g.playing() || ++ms_ < period_) {
+		return false;
+	}
+
+	ms_ = 0;
+	push(g);
+	return true;
+}
+
+} // namespace escalade
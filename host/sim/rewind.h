@@ -0,0 +1,60 @@
+// Host port of the rewind buffer in ../rewind.h.
+
+////////////////////////////////////////////////////////////////////////////////
+
+#ifndef ESCALADE_REWIND_H
+#define ESCALADE_REWIND_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <vector>
+
+#include "game.h"
+
+namespace escalade {
+
+////////////////////////////////////////////////////////////////////////////////
+//The last snapshots of a Game, as run-length encoded XOR deltas in a byte ring
+//of fixed size, in the same entry format as the firmware. The ring holds
+//however many entries fit; restoring decodes at most its size in bytes.
+class Rewind {
+public:
+	static const size_t kDefaultBytes = 512;
+	static const uint32_t kDefaultPeriod = 250;
+	/* Longer deltas start the history over */
+	static const size_t kMaxEntry = 253;
+
+	/* bytes must be a power of two */
+	explicit Rewind(size_t bytes = kDefaultBytes, uint32_t period = kDefaultPeriod);
+
+	void clear();
+	/* Call after every tick; snapshots every period ticks of play and then
+	   returns true */
+	bool tick(const Game& g);
+	void push(const Game& g);
+	/* Puts g back steps snapshots from the newest, returns how many it went */
+	uint32_t restore(Game& g, uint32_t steps);
+
+	size_t entries() const { return entries_; }
+	size_t used() const { return used_; }
+	size_t last_entry() const { return last_entry_; }
+
+private:
+	size_t encode(const Game& g, bool write, size_t at);
+	uint8_t& at(size_t pos) { return ring_[pos & (ring_.size() - 1)]; }
+
+	std::vector<uint8_t> ring_;
+	uint32_t period_;
+	size_t head_ = 0;
+	size_t used_ = 0;
+	size_t entries_ = 0;
+	size_t last_entry_ = 0;
+	uint32_t ms_ = 0;
+	bool have_prev_ = false;
+	Game prev_;
+};
+
+} // namespace escalade
+
+#endif
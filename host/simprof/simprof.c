@@ -0,0 +1,404 @@
+// Cycle-accurate profiler for the Escalade firmware under simavr.
+//
+//   escalade_simprof firmware.elf script.txt [--budget cycles]
+//
+// Runs the firmware image on a simulated 8 MHz ATmega1284p, feeds it the
+// thumbstick and button events of the script and reports, per function, the
+// calls and inclusive cycles (ISRs included, under their __vector_N names) and
+// the busiest millisecond of the main loop. Build the image with -DSIMPROF so
+// main.c marks where it waits for TimerFlag (see simprof.h), and without
+// inlining so every function keeps its own symbol.
+//
+// Script lines are "<ms> stick <adc 0..1023>", "<ms> button down|up" and
+// "<ms> end"; '#' starts a comment. Exits with 1 if a millisecond went over
+// --budget (default 8000 cycles, i.e. all of it).
+
+////////////////////////////////////////////////////////////////////////////////
+
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <gelf.h>
+#include <libelf.h>
+
+#include <simavr/avr_adc.h>
+#include <simavr/avr_ioport.h>
+#include <simavr/sim_avr.h>
+#include <simavr/sim_elf.h>
+#include <simavr/sim_io.h>
+
+#define F_CPU			8000000UL
+#define CYCLES_PER_MS	(F_CPU / 1000)
+#define FLASH_WORDS		(128UL * 1024 / 2)
+
+/* Same values as simprof.h */
+#define SIMPROF_IDLE		0x01
+#define SIMPROF_BUSY		0x02
+#define SIMPROF_END_SCREEN	0x03
+#define GPIOR0_DATA			0x3E // GPIOR0 (I/O 0x1E) in data space
+
+#define MAX_FUNCTIONS	256
+#define MAX_DEPTH		64
+#define MAX_EVENTS		4096
+#define MAX_WINDOW_LOG	32
+
+typedef struct {
+	char name[48];
+	uint32_t addr;
+	uint64_t calls;
+	uint64_t cycles;
+	uint64_t max;
+} function_t;
+
+typedef struct {
+	int fn;
+	uint64_t start;
+	uint16_t sp;
+} frame_t;
+
+enum { EV_STICK, EV_BUTTON, EV_END };
+
+typedef struct {
+	uint64_t ms;
+	int kind;
+	int value;
+} event_t;
+
+typedef struct {
+	int fn;
+	uint64_t cycles;
+} call_t;
+
+static function_t functions[MAX_FUNCTIONS];
+static int num_functions = 0;
+static uint16_t entry_of[FLASH_WORDS]; // function index + 1 by word address
+
+static frame_t stack[MAX_DEPTH];
+static int depth = 0;
+
+static event_t events[MAX_EVENTS];
+static int num_events = 0;
+
+/* Main loop windows between SIMPROF_BUSY and SIMPROF_IDLE */
+static int in_window = 0;
+static uint64_t window_start;
+static call_t window_log[MAX_WINDOW_LOG];
+static int window_calls = 0;
+
+static uint64_t windows = 0;
+static uint64_t busy_total = 0;
+static uint64_t over_budget = 0;
+static uint64_t budget = CYCLES_PER_MS;
+static uint64_t worst = 0;
+static uint64_t worst_start = 0;
+static call_t worst_log[MAX_WINDOW_LOG];
+static int worst_calls = 0;
+
+////////////////////////////////////////////////////////////////////////////////
+//Functionality - collects every sized function symbol of the image
+//Parameter: path of the ELF file
+//Returns: 0 on success
+static int load_symbols(const char* path) {
+	int fd = open(path, O_RDONLY);
+	if(fd < 0) {
+		return -1;
+	}
+
+	elf_version(EV_CURRENT);
+	Elf* elf = elf_begin(fd, ELF_C_READ, NULL);
+	Elf_Scn* scn = NULL;
+
+	while(elf && (scn = elf_nextscn(elf, scn)) != NULL) {
+		GElf_Shdr shdr;
+		if(!gelf_getshdr(scn, &shdr) || shdr.sh_type != SHT_SYMTAB) {
+			continue;
+		}
+
+		Elf_Data* data = elf_getdata(scn, NULL);
+		size_t count = shdr.sh_size / shdr.sh_entsize;
+		for(size_t k = 0; k < count; ++k) {
+			GElf_Sym sym;
+			gelf_getsym(data, (int)k, &sym);
+			if(GELF_ST_TYPE(sym.st_info) != STT_FUNC || sym.st_size == 0) {
+				continue;
+			}
+
+			const char* name = elf_strptr(elf, shdr.sh_link, sym.st_name);
+			if(!name || strcmp(name, "main") == 0 || num_functions == MAX_FUNCTIONS) {
+				continue;
+			}
+
+			uint32_t word = (uint32_t)(sym.st_value / 2);
+			if(word >= FLASH_WORDS || entry_of[word]) {
+				continue;
+			}
+
+			function_t* f = &functions[num_functions++];
+			snprintf(f->name, sizeof(f->name), "%s", name);
+			f->addr = (uint32_t)sym.st_value;
+			entry_of[word] = (uint16_t)num_functions;
+		}
+	}
+
+	if(elf) {
+		elf_end(elf);
+	}
+	close(fd);
+	return num_functions ? 0 : -1;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//Functionality - reads the input script
+//Parameter: path of the script
+//Returns: 0 on success
+static int load_script(const char* path) {
+	FILE* f = fopen(path, "r");
+	if(!f) {
+		return -1;
+	}
+
+	char line[256];
+	int line_no = 0;
+	while(fgets(line, sizeof(line), f)) {
+		++line_no;
+		char* hash = strchr(line, '#');
+		if(hash) {
+			*hash = '\0';
+		}
+
+		unsigned long long ms;
+		char what[16], arg[16] = "";
+		int n = sscanf(line, "%llu %15s %15s", &ms, what, arg);
+		if(n <= 0) {
+			continue;
+		}
+
+		event_t* e = &events[num_events];
+		e->ms = ms;
+		if(n == 3 && strcmp(what, "stick") == 0) {
+			e->kind = EV_STICK;
+			e->value = atoi(arg);
+		}
+
+		else if(n == 3 && strcmp(what, "button") == 0) {
+			e->kind = EV_BUTTON;
+			e->value = strcmp(arg, "down") == 0;
+		}
+
+		else if(n == 2 && strcmp(what, "end") == 0) {
+			e->kind = EV_END;
+		}
+
+		else {
+			fprintf(stderr, "%s:%d: bad event\n", path, line_no);
+			fclose(f);
+			return -1;
+		}
+
+		if(num_events > 0 && e->ms < events[num_events - 1].ms) {
+			fprintf(stderr, "%s:%d: events out of order\n", path, line_no);
+			fclose(f);
+			return -1;
+		}
+
+		if(++num_events == MAX_EVENTS) {
+			break;
+		}
+	}
+
+	fclose(f);
+	return 0;
+}
+
+static void on_mark(avr_t* avr, avr_io_addr_t addr, uint8_t v, void* param) {
+	(void)param;
+	avr->data[addr] = v;
+
+	switch(v) {
+		case SIMPROF_BUSY:
+			in_window = 1;
+			window_start = avr->cycle;
+			window_calls = 0;
+			break;
+
+		case SIMPROF_IDLE:
+			if(in_window) {
+				uint64_t busy = avr->cycle - window_start;
+				++windows;
+				busy_total += busy;
+				if(busy > budget) {
+					++over_budget;
+				}
+				if(busy > worst) {
+					worst = busy;
+					worst_start = window_start;
+					worst_calls = window_calls;
+					memcpy(worst_log, window_log, sizeof(window_log));
+				}
+			}
+			in_window = 0;
+			break;
+
+		case SIMPROF_END_SCREEN:
+			in_window = 0;
+			break;
+
+		default:
+			break;
+	}
+}
+
+/* Attributes the cycles of every frame the last instruction returned from */
+static void track_calls(avr_t* avr) {
+	uint16_t sp = (uint16_t)(avr->data[R_SPL] | (avr->data[R_SPH] << 8));
+
+	while(depth > 0 && sp > stack[depth - 1].sp) {
+		frame_t* fr = &stack[--depth];
+		function_t* f = &functions[fr->fn];
+		uint64_t cycles = avr->cycle - fr->start;
+		++f->calls;
+		f->cycles += cycles;
+		if(cycles > f->max) {
+			f->max = cycles;
+		}
+
+		/* Direct calls from main() make up the window log */
+		if(depth == 0 && in_window && window_calls < MAX_WINDOW_LOG) {
+			window_log[window_calls].fn = fr->fn;
+			window_log[window_calls].cycles = cycles;
+			++window_calls;
+		}
+	}
+
+	uint32_t word = avr->pc / 2;
+	int fn = word < FLASH_WORDS ? entry_of[word] : 0;
+	if(fn && depth < MAX_DEPTH && (depth == 0 || sp < stack[depth - 1].sp)) {
+		stack[depth].fn = fn - 1;
+		stack[depth].start = avr->cycle;
+		stack[depth].sp = sp;
+		++depth;
+	}
+}
+
+static int by_cycles(const void* a, const void* b) {
+	const function_t* fa = (const function_t*)a;
+	const function_t* fb = (const function_t*)b;
+	return (fa->cycles < fb->cycles) - (fa->cycles > fb->cycles);
+}
+
+int main(int argc, char** argv) {
+	if(argc < 3) {
+		fprintf(stderr, "usage: escalade_simprof firmware.elf script.txt [--budget cycles]\n");
+		return 2;
+	}
+
+	for(int a = 3; a < argc; ++a) {
+		if(strcmp(argv[a], "--budget") == 0 && a + 1 < argc) {
+			budget = strtoull(argv[++a], NULL, 0);
+		}
+	}
+
+	if(load_symbols(argv[1]) != 0) {
+		fprintf(stderr, "%s: no function symbols\n", argv[1]);
+		return 2;
+	}
+
+	if(load_script(argv[2]) != 0) {
+		fprintf(stderr, "cannot read script %s\n", argv[2]);
+		return 2;
+	}
+
+	elf_firmware_t firmware;
+	memset(&firmware, 0, sizeof(firmware));
+	if(elf_read_firmware(argv[1], &firmware) != 0) {
+		fprintf(stderr, "%s: cannot load firmware\n", argv[1]);
+		return 2;
+	}
+
+	avr_t* avr = avr_make_mcu_by_name("atmega1284p");
+	if(!avr) {
+		fprintf(stderr, "simavr has no atmega1284p core\n");
+		return 2;
+	}
+
+	avr_init(avr);
+	avr->frequency = F_CPU;
+	avr->vcc = avr->avcc = avr->aref = 5000;
+	avr_load_firmware(avr, &firmware);
+	avr_register_io_write(avr, GPIOR0_DATA, on_mark, NULL);
+
+	avr_irq_t* adc0 = avr_io_getirq(avr, AVR_IOCTL_ADC_GETIRQ, ADC_IRQ_ADC0);
+	avr_irq_t* button = avr_io_getirq(avr, AVR_IOCTL_IOPORT_GETIRQ('B'), 1);
+
+	/* Thumbstick centered, button released (PB1 is active low) */
+	avr_raise_irq(adc0, 2500);
+	avr_raise_irq(button, 1);
+
+	uint64_t end_ms = num_events ? events[num_events - 1].ms : 10000;
+	int next = 0;
+	int state = cpu_Running;
+
+	while(state != cpu_Done && state != cpu_Crashed) {
+		uint64_t now_ms = avr->cycle / CYCLES_PER_MS;
+		while(next < num_events && events[next].ms <= now_ms) {
+			const event_t* e = &events[next++];
+			if(e->kind == EV_STICK) {
+				avr_raise_irq(adc0, (uint32_t)e->value * 5000 / 1023);
+			}
+
+			else if(e->kind == EV_BUTTON) {
+				avr_raise_irq(button, e->value ? 0 : 1);
+			}
+		}
+
+		if(now_ms >= end_ms) {
+			break;
+		}
+
+		state = avr_run(avr);
+		track_calls(avr);
+	}
+
+	if(state == cpu_Crashed) {
+		fprintf(stderr, "firmware crashed at pc 0x%04x\n", avr->pc);
+	}
+
+	double run_cycles = (double)avr->cycle;
+	printf("simulated %.1f ms, %llu cycles at %lu Hz\n\n",
+		run_cycles / CYCLES_PER_MS, (unsigned long long)avr->cycle, F_CPU);
+
+	/* Keep the worst window's call names before sorting */
+	char worst_names[MAX_WINDOW_LOG][48];
+	for(int k = 0; k < worst_calls; ++k) {
+		snprintf(worst_names[k], sizeof(worst_names[k]), "%s", functions[worst_log[k].fn].name);
+	}
+
+	qsort(functions, num_functions, sizeof(function_t), by_cycles);
+	printf("%-28s %10s %14s %10s %10s %7s\n", "function", "calls", "cycles", "mean", "max", "% run");
+	for(int k = 0; k < num_functions; ++k) {
+		const function_t* f = &functions[k];
+		if(f->calls == 0) {
+			continue;
+		}
+		printf("%-28s %10llu %14llu %10.1f %10llu %6.2f%%\n", f->name,
+			(unsigned long long)f->calls, (unsigned long long)f->cycles,
+			(double)f->cycles / f->calls, (unsigned long long)f->max,
+			100.0 * f->cycles / run_cycles);
+	}
+
+	printf("\nmain loop: %llu ticks, mean %.1f busy cycles, %llu over the %llu cycle budget\n",
+		(unsigned long long)windows, windows ? (double)busy_total / windows : 0.0,
+		(unsigned long long)over_budget, (unsigned long long)budget);
+	printf("worst millisecond: %llu cycles (%.1f%% of %lu) at %.3f ms\n",
+		(unsigned long long)worst, 100.0 * worst / CYCLES_PER_MS, CYCLES_PER_MS,
+		(double)worst_start / CYCLES_PER_MS);
+	for(int k = 0; k < worst_calls; ++k) {
+		printf("    %-24s %10llu\n", worst_names[k], (unsigned long long)worst_log[k].cycles);
+	}
+
+	return over_budget ? 1 : 0;
+}
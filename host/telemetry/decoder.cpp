@@ -0,0 +1,183 @@
+// Decoder for the firmware's USART0 telemetry stream.
+
+////////////////////////////////////////////////////////////////////////////////
+
+#include "decoder.h"
+
+namespace escalade {
+
+namespace {
+
+/* Sync times are the 16-bit tick count times 125 plus TCNT1 */
+const uint64_t kSyncPeriod = 65536ull * kTelemetryTicksPerMs;
+
+const char* const kArgNames[] = {
+	NULL, "wall", "powerup_spawn", "move", "powerup_pickup", "score",
+	"game_over", "win", "dropped", "frames", "ram_data", "ram_bss", "ram_heap",
+	"stack_peak",
+};
+
+const char* const kPlainNames[] = { "tick", "powerup_expire", "restart", "rewind" };
+
+} // namespace
+
+bool telemetry_has_arg(uint8_t type) {
+	return type >= TELEMETRY_WALL && type <= TELEMETRY_STACK_PEAK;
+}
+
+const char* telemetry_name(uint8_t type) {
+	if(telemetry_has_arg(type)) {
+		return kArgNames[type];
+	}
+
+	else if(type >= TELEMETRY_TICK_START && type <= TELEMETRY_REWIND) {
+		return kPlainNames[type - TELEMETRY_TICK_START];
+	}
+
+	else if(type >= TELEMETRY_TASK_START && type < TELEMETRY_TASK_START + 5) {
+		return "task_start";
+	}
+
+	else if(type >= TELEMETRY_TASK_END && type < TELEMETRY_TASK_END + 5) {
+		return "task_end";
+	}
+	return NULL;
+}
+
+void TelemetryDecoder::lose() {
+	state_ = kLost;
+	++stats_.resyncs;
+}
+
+bool TelemetryDecoder::varint(uint8_t b, bool& bad) {
+	if(shift_ >= 35) {
+		bad = true;
+		return false;
+	}
+
+	value_ |= (uint32_t)(b & 0x7F) << shift_;
+	shift_ += 7;
+	return (b & 0x80) == 0;
+}
+
+bool TelemetryDecoder::push(uint8_t b, TelemetryEvent& ev) {
+	++stats_.bytes;
+	bool bad = false;
+
+	switch(state_) {
+		case kLost:
+			if(b == TELEMETRY_SYNC_0) {
+				state_ = kSync1;
+			}
+
+			else {
+				++stats_.skipped;
+			}
+			break;
+
+		case kSync1:
+			if(b == TELEMETRY_SYNC_1) {
+				state_ = kVersion;
+			}
+
+			else if(b != TELEMETRY_SYNC_0) {
+				stats_.skipped += 2;
+				state_ = kLost;
+			}
+
+			else {
+				++stats_.skipped;
+			}
+			break;
+
+		case kVersion:
+			if(b == TELEMETRY_VERSION) {
+				state_ = kSyncTime;
+				value_ = 0;
+				shift_ = 0;
+			}
+
+			else {
+				++stats_.bad_version;
+				state_ = kLost;
+			}
+			break;
+
+		case kSyncTime:
+			if(varint(b, bad)) {
+				/* The sync time wraps with the tick count; keep ours monotonic */
+				uint64_t t = time_ - time_ % kSyncPeriod + value_;
+				if(locked_ && t < time_) {
+					t += kSyncPeriod;
+				}
+				time_ = t;
+				locked_ = true;
+				++stats_.syncs;
+				state_ = kType;
+			}
+
+			else if(bad) {
+				lose();
+			}
+			break;
+
+		case kType:
+			if(b == TELEMETRY_SYNC_0) {
+				state_ = kSync1;
+			}
+
+			else if(telemetry_name(b)) {
+				type_ = b;
+				value_ = 0;
+				shift_ = 0;
+				state_ = kDelta;
+			}
+
+			else {
+				lose();
+				++stats_.skipped;
+			}
+			break;
+
+		case kDelta:
+			if(varint(b, bad)) {
+				time_ += value_;
+				if(telemetry_has_arg(type_)) {
+					value_ = 0;
+					shift_ = 0;
+					state_ = kArg;
+					break;
+				}
+
+				ev.time = time_;
+				ev.type = type_;
+				ev.arg = 0;
+				++stats_.records;
+				state_ = kType;
+				return true;
+			}
+
+			else if(bad) {
+				lose();
+			}
+			break;
+
+		case kArg:
+			if(varint(b, bad)) {
+				ev.time = time_;
+				ev.type = type_;
+				ev.arg = value_;
+				++stats_.records;
+				state_ = kType;
+				return true;
+			}
+
+			else if(bad) {
+				lose();
+			}
+			break;
+	}
+	return false;
+}
+
+} // namespace escalade
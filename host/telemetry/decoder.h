@@ -0,0 +1,76 @@
+// Decoder for the firmware's USART0 telemetry stream, see ../../telemetry.h for
+// the format.
+
+////////////////////////////////////////////////////////////////////////////////
+
+#ifndef ESCALADE_TELEMETRY_DECODER_H
+#define ESCALADE_TELEMETRY_DECODER_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "../../telemetry.h"
+
+namespace escalade {
+
+/* 8 us steps of TCNT1 */
+const uint32_t kTelemetryTicksPerMs = 125;
+
+struct TelemetryEvent {
+	uint64_t time;   /* in kTelemetryTicksPerMs units since the first sync */
+	uint8_t type;    /* TELEMETRY_ */
+	uint32_t arg;    /* 0 for types without one */
+};
+
+struct TelemetryStats {
+	uint64_t bytes;
+	uint64_t records;
+	uint64_t syncs;
+	uint64_t skipped;     /* bytes thrown away while looking for a sync */
+	uint64_t resyncs;     /* times the stream went bad after a sync */
+	uint64_t bad_version; /* syncs of another format version */
+};
+
+bool telemetry_has_arg(uint8_t type);
+/* Name of a record type, "task_start" etc. for the task ranges, NULL if unknown */
+const char* telemetry_name(uint8_t type);
+
+//Byte-at-a-time decoder, so it can sit on a serial port or a partial file.
+//Nothing is reported before the first sync; after a malformed record it skips
+//to the next sync and carries the time on from there.
+class TelemetryDecoder {
+public:
+	/* Returns true when b completed a record, which is then in ev */
+	bool push(uint8_t b, TelemetryEvent& ev);
+
+	template <typename Sink>
+	void feed(const uint8_t* data, size_t n, Sink sink) {
+		TelemetryEvent ev;
+		for(size_t k = 0; k < n; ++k) {
+			if(push(data[k], ev)) {
+				sink(ev);
+			}
+		}
+	}
+
+	const TelemetryStats& stats() const { return stats_; }
+
+private:
+	enum State : uint8_t { kLost, kSync1, kVersion, kSyncTime, kType, kDelta, kArg };
+
+	void lose();
+	/* Adds b to the varint being read; true when it is complete */
+	bool varint(uint8_t b, bool& bad);
+
+	State state_ = kLost;
+	bool locked_ = false;  /* time is known */
+	uint64_t time_ = 0;
+	uint8_t type_ = 0;
+	uint32_t value_ = 0;
+	uint8_t shift_ = 0;
+	TelemetryStats stats_ = {0, 0, 0, 0, 0, 0};
+};
+
+} // namespace escalade
+
+#endif
@@ -0,0 +1,136 @@
+// Plays games with the lookahead bot, or checks a wall sequence with the oracle.
+//
+//   escalade_autoplay [-n games] [-s first_seed] [-e max_events] [-m]
+//   escalade_autoplay -c period wall...
+//
+// -m makes the bot move whenever it safely can (load generator mode). A wall is
+// one of the ten old fixed patterns, 1..10, or a column mask like 0xE7 (bit n =
+// column n).
+
+////////////////////////////////////////////////////////////////////////////////
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <chrono>
+#include <vector>
+
+#include "../bot/bot.h"
+
+using namespace escalade;
+
+static int usage() {
+	fprintf(stderr,
+		"usage: escalade_autoplay [-n games] [-s first_seed] [-e max_events] [-m]\n"
+		"       escalade_autoplay -c period wall...\n");
+	return 2;
+}
+
+static int check(int argc, char** argv) {
+	uint32_t period = (uint32_t)strtoul(argv[0], NULL, 0);
+	std::vector<Game::Row> masks;
+	for(int a = 1; a < argc; ++a) {
+		unsigned long v = strtoul(argv[a], NULL, 0);
+		if(strncmp(argv[a], "0x", 2) == 0) {
+			masks.push_back((Game::Row)strtoull(argv[a], NULL, 0));
+		}
+
+		else if(v >= 1 && v <= 10) {
+			masks.push_back(Game::kWalls[v - 1]);
+		}
+
+		else {
+			fprintf(stderr, "bad wall '%s'\n", argv[a]);
+			return 2;
+		}
+	}
+
+	if(period == 0 || masks.empty()) {
+		return usage();
+	}
+
+	Survival s = check_survivable(masks.data(), masks.size(), period);
+	printf("%s: %zu/%zu walls at %u ms (%llu nodes)\n",
+		s.survivable ? "survivable" : "unsurvivable", s.walls_passed, masks.size(),
+		period, (unsigned long long)s.nodes);
+	return s.survivable ? 0 : 1;
+}
+
+int main(int argc, char** argv) {
+	unsigned games = 100;
+	unsigned seed = 0;
+	BotConfig config;
+
+	for(int a = 1; a < argc; ++a) {
+		if(strcmp(argv[a], "-c") == 0 && a + 2 < argc) {
+			return check(argc - a - 1, argv + a + 1);
+		}
+
+		else if(strcmp(argv[a], "-n") == 0 && a + 1 < argc) {
+			games = (unsigned)strtoul(argv[++a], NULL, 0);
+		}
+
+		else if(strcmp(argv[a], "-s") == 0 && a + 1 < argc) {
+			seed = (unsigned)strtoul(argv[++a], NULL, 0);
+		}
+
+		else if(strcmp(argv[a], "-e") == 0 && a + 1 < argc) {
+			config.max_events = (uint32_t)strtoul(argv[++a], NULL, 0);
+		}
+
+		else if(strcmp(argv[a], "-m") == 0) {
+			config.prefer_move = true;
+		}
+
+		else {
+			return usage();
+		}
+	}
+
+	Bot bot(config);
+	Game g;
+	unsigned wins = 0;
+	uint64_t ticks = 0;
+	uint64_t score_total = 0;
+
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+	for(unsigned n = 0; n < games; ++n) {
+		g.reset((uint16_t)(seed + n));
+		Input in;
+		while(g.playing()) {
+			if(ticks_until_sample(g) == 0) {
+				in.stick_x = stick_for(bot.decide(g));
+			}
+			g.tick(in);
+		}
+
+		ticks += g.ticks;
+		score_total += g.score;
+		if(g.game_over == 0x00) {
+			++wins;
+		}
+
+		else {
+			printf("seed %u: died at score %u\n", seed + n, g.score);
+		}
+	}
+
+	double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	const BotStats& st = bot.stats();
+	double decisions = st.decisions ? (double)st.decisions : 1.0;
+
+	printf("games %u  won %u  lost %u  mean score %.1f\n",
+		games, wins, games - wins, (double)score_total / (games ? games : 1));
+	printf("game ticks %llu (%.1f M/s including decisions)\n",
+		(unsigned long long)ticks, ticks / seconds / 1e6);
+	printf("decisions %llu  %.0f/s of search  mean %.0f ns  max %llu ns\n",
+		(unsigned long long)st.decisions, st.ns_total ? decisions / (st.ns_total * 1e-9) : 0.0,
+		st.ns_total / decisions, (unsigned long long)st.ns_max);
+	printf("nodes/decision mean %.1f  max %llu  truncated %llu\n",
+		st.nodes / decisions, (unsigned long long)st.max_nodes,
+		(unsigned long long)st.truncated);
+
+	return wins == games ? 0 : 1;
+}
@@ -0,0 +1,97 @@
+// Runs the firmware built with -DTELEMETRY under the lockstep register shim and
+// writes what it sends on USART0, for working on the telemetry tools without a
+// unit. TCNT1 does not count in the shim, so times only have tick resolution.
+//
+//   escalade_capture [-s seed] [-t ticks] [-r recording] -o capture.bin
+//
+// -r also records the inputs on the host engine side, for comparing with the
+// recording escalade_replay -T rebuilds from the capture.
+
+////////////////////////////////////////////////////////////////////////////////
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <vector>
+
+#include "../lockstep/driver.h"
+#include "../lockstep/legacy.h"
+#include "../replay/replay.h"
+
+using namespace escalade;
+
+static int usage() {
+	fprintf(stderr, "usage: escalade_capture [-s seed] [-t ticks] [-r recording] -o capture.bin\n");
+	return 2;
+}
+
+int main(int argc, char** argv) {
+	unsigned seed = 0;
+	uint64_t max_ticks = 600000;
+	const char* out = NULL;
+	const char* record = NULL;
+
+	for(int a = 1; a < argc; ++a) {
+		if(strcmp(argv[a], "-s") == 0 && a + 1 < argc) {
+			seed = (unsigned)strtoul(argv[++a], NULL, 0);
+		}
+
+		else if(strcmp(argv[a], "-t") == 0 && a + 1 < argc) {
+			max_ticks = strtoull(argv[++a], NULL, 0);
+		}
+
+		else if(strcmp(argv[a], "-o") == 0 && a + 1 < argc) {
+			out = argv[++a];
+		}
+
+		else if(strcmp(argv[a], "-r") == 0 && a + 1 < argc) {
+			record = argv[++a];
+		}
+
+		else {
+			return usage();
+		}
+	}
+
+	if(!out) {
+		return usage();
+	}
+
+	FILE* f = fopen(out, "wb");
+	if(!f) {
+		fprintf(stderr, "cannot write %s\n", out);
+		return 2;
+	}
+
+	/* The host engine runs alongside only to give the driver a board to look at */
+	Driver driver((uint16_t)seed);
+	Recorder recorder((uint16_t)seed);
+	Game g;
+	legacy::boot((uint16_t)seed);
+	g.reset((uint16_t)seed);
+
+	std::vector<uint8_t> bytes;
+	uint64_t total = 0;
+	for(uint64_t t = 0; t < max_ticks; ++t) {
+		Input in = driver.next(g);
+		recorder.record(g, in);
+		legacy::tick(in);
+		g.tick(in);
+
+		legacy::take_uart(bytes);
+		if(bytes.size() >= 4096 || t + 1 == max_ticks) {
+			fwrite(bytes.data(), 1, bytes.size(), f);
+			total += bytes.size();
+			bytes.clear();
+		}
+	}
+
+	fclose(f);
+	if(record && !write_recording(record, recorder.finish(g), "escalade_capture")) {
+		fprintf(stderr, "cannot write %s\n", record);
+		return 2;
+	}
+	printf("%llu ticks, %llu bytes\n", (unsigned long long)max_ticks, (unsigned long long)total);
+	return 0;
+}
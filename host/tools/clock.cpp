@@ -0,0 +1,256 @@
+// Checks the clock and the software alarms of ../timer.h. The header is
+// compiled against the lockstep register shim with Timer1 emulated here a step
+// (8 us) at a time: TCNT1 counting up to OCR1A and over, the compare flags, and
+// both compare interrupts taken when they are enabled and interrupts are not
+// held off.
+//
+//   escalade_clock
+//
+// The clock is read at every step over a stretch where interrupts are held off
+// across compare matches now and then, and has to be exactly the time the
+// timer has run, pending match or not. Then alarms are set at different
+// offsets, from the main loop and from callbacks, one is canceled and one falls
+// due while interrupts are held off; they have to go off in order, at most 3
+// steps after they are due, or 5 after interrupts come back on. Exits with 1 on the first thing wrong.
+
+////////////////////////////////////////////////////////////////////////////////
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../lockstep/shim/regs.h"
+
+volatile uint8_t PORTA, PORTB, PORTC, PORTD;
+volatile uint8_t DDRA, DDRB, DDRC, DDRD;
+volatile uint8_t ADMUX, SREG, TIMSK1, TIFR1, TCCR1B, TCCR3A, TCCR3B;
+volatile uint16_t OCR1A, OCR1B, TCNT1, OCR3A, TCNT3;
+volatile uint8_t TCNT1L;
+volatile uint8_t UCSR0A, UCSR0B, UCSR0C;
+volatile uint16_t UBRR0, UDR0;
+volatile uint8_t EECR;
+volatile uint16_t EEAR;
+
+#include "../../timer.h"
+
+namespace {
+
+/* Set in TIFR1 while the firmware runs; gone if it wrote the register */
+const uint8_t kUntouched = 0x80;
+
+unsigned long steps;   /* timer steps since TimerOn() */
+uint8_t flags;         /* the real TIFR1 */
+bool held;             /* interrupts off, as in some long interrupt elsewhere */
+unsigned long fast_calls;
+
+struct Fired {
+	char id;
+	unsigned long at;   /* time it was set for */
+	unsigned long when; /* time it went off */
+};
+
+Fired fired[16];
+int fired_count;
+unsigned long due[128]; /* time each alarm id is set for */
+int repeats;
+
+unsigned long now_us() {
+	return steps * TIMER_STEP_US;
+}
+
+/* Runs firmware code; a write to TIFR1 clears the flags written as 1 */
+template<class F>
+void firmware(F f) {
+	TIFR1 = flags | kUntouched;
+	f();
+	if(!(TIFR1 & kUntouched)) {
+		flags &= ~TIFR1;
+	}
+}
+
+void interrupts() {
+	if(held) {
+		return;
+	}
+	if((flags & (1 << OCF1A)) && (TIMSK1 & 0x02)) {
+		flags &= ~(1 << OCF1A);
+		firmware([] { TIMER1_COMPA_vect(); });
+	}
+	if((flags & (1 << OCF1B)) && (TIMSK1 & (1 << OCIE1B))) {
+		flags &= ~(1 << OCF1B);
+		firmware([] { TIMER1_COMPB_vect(); });
+	}
+}
+
+/* One timer clock. A compare flag is set on the clock after TCNT1 equals the
+   OCR1x; for OCR1A that is the clock that clears TCNT1 (the CTC timing
+   diagram of the datasheet) */
+void step() {
+	uint8_t was = TCNT1L;
+	TCNT1L = (was == OCR1A) ? 0 : was + 1;
+	TCNT1 = TCNT1L;
+	++steps;
+	if(was == OCR1A) {
+		flags |= 1 << OCF1A;
+	}
+	if(was == OCR1B) {
+		flags |= 1 << OCF1B;
+	}
+	interrupts();
+}
+
+unsigned long micros() {
+	unsigned long us = 0;
+	firmware([&] { us = TimerMicros(); });
+	return us;
+}
+
+unsigned char set_alarm(char id, void (*fct)(void), unsigned long us) {
+	unsigned char slot = TIMER_NO_ALARM;
+	firmware([&] { slot = TimerAlarmSet(fct, us); });
+	if(slot != TIMER_NO_ALARM) {
+		due[(int)id] = micros() + us;
+	}
+	return slot;
+}
+
+void record(char id) {
+	if(fired_count < (int)(sizeof(fired) / sizeof(fired[0]))) {
+		fired[fired_count++] = {id, due[(int)id], TimerMicros()};
+	}
+}
+
+void alarm_a() { record('a'); }
+void alarm_b();
+void alarm_c() { record('c'); }
+void alarm_d() { record('d'); }
+void alarm_y() { record('y'); }
+
+/* Sets itself again twice, 1 ms apart */
+void alarm_r() {
+	record('r');
+	if(++repeats < 3) {
+		due['r'] = TimerMicros() + 1000;
+		TimerAlarmSet(alarm_r, 1000);
+	}
+}
+
+/* Due at once; sets r from its callback */
+void alarm_z() {
+	record('z');
+	due['r'] = TimerMicros() + 100;
+	TimerAlarmSet(alarm_r, 100);
+}
+
+/* Sets y to fall due while interrupts are held off */
+void alarm_b() {
+	record('b');
+	due['y'] = TimerMicros() + 2300;
+	TimerAlarmSet(alarm_y, 2300);
+}
+
+int fail(const char* what) {
+	fprintf(stderr, "clock check failed: %s\n", what);
+	return 1;
+}
+
+} // namespace
+
+void TimerFast() {
+	++fast_calls;
+}
+
+int main() {
+	firmware([] {
+		TimerSet(1);
+		TimerOn();
+	});
+
+	/* The clock: every step of 20 ms, holding interrupts off for the 6 steps
+	   before and after every third compare match */
+	unsigned long reads = 0, pending = 0, last = 0;
+	for(int s = 0; s < 20 * TIMER_STEPS; ++s) {
+		int u = s + 1 + 6; /* steps after this one, plus 6 */
+		held = (u / TIMER_STEPS) % 3 == 1 && u % TIMER_STEPS < 12;
+		step();
+		unsigned long us = micros();
+		if(us != now_us()) {
+			fprintf(stderr, "at %lu us the clock reads %lu\n", now_us(), us);
+			return fail("clock is not the time the timer has run");
+		}
+		if(us < last) {
+			return fail("clock went backwards");
+		}
+		pending += (flags & (1 << OCF1A)) && TCNT1L < TIMER_STEPS - 1;
+		last = us;
+		++reads;
+	}
+	held = false;
+	step();
+	if(TimerMillis() != now_us() / 1000 || fast_calls != now_us() / 1000) {
+		return fail("TimerMillis() or TimerFast() calls are not the ms the timer has run");
+	}
+
+	/* The alarms */
+	if(set_alarm('a', alarm_a, 2500) == TIMER_NO_ALARM || set_alarm('b', alarm_b, 700) == TIMER_NO_ALARM ||
+	   set_alarm('c', alarm_c, 1300) == TIMER_NO_ALARM || set_alarm('d', alarm_d, 4000) == TIMER_NO_ALARM) {
+		return fail("an alarm could not be set with slots free");
+	}
+	if(set_alarm('z', alarm_z, 0) != TIMER_NO_ALARM) {
+		return fail("a fifth alarm was set");
+	}
+	for(unsigned char i = 0; i < TIMER_ALARMS; ++i) {
+		if(TimerAlarms[i].fct == alarm_c) {
+			firmware([i] { TimerAlarmCancel(i); });
+		}
+	}
+	unsigned long start = now_us();
+	if(set_alarm('z', alarm_z, 0) == TIMER_NO_ALARM) {
+		return fail("no slot after the cancel");
+	}
+
+	/* Interrupts held off from 2950 to 3150 us, when y falls due */
+	unsigned long held_from = start + 2950, held_to = start + 3150;
+	while(now_us() < start + 6000) {
+		held = now_us() >= held_from && now_us() < held_to;
+		step();
+	}
+
+	const char* order = "zrbrrayd";
+	int n = (int)strlen(order);
+	unsigned long latest = 0, after_held = 0;
+	if(fired_count != n) {
+		fprintf(stderr, "%d alarms went off, %d expected\n", fired_count, n);
+		return fail("wrong number of alarms");
+	}
+	for(int i = 0; i < n; ++i) {
+		const Fired& f = fired[i];
+		if(f.id != order[i]) {
+			fprintf(stderr, "alarm %d is '%c', '%c' expected\n", i, f.id, order[i]);
+			return fail("alarms out of order");
+		}
+		/* y waits for interrupts, then for the compare A interrupt to point
+		   OCR1B at it, a step clear of TCNT1 */
+		unsigned long from = f.id == 'y' ? held_to : f.at;
+		unsigned long slack = (f.id == 'y' ? 5 : 3) * TIMER_STEP_US;
+		if(f.when < f.at || f.when > from + slack) {
+			fprintf(stderr, "alarm '%c' for %lu us went off at %lu us\n", f.id, f.at, f.when);
+			return fail("alarm early or late");
+		}
+		if(f.id == 'y') {
+			after_held = f.when - held_to;
+		}
+		else if(f.when - from > latest) {
+			latest = f.when - from;
+		}
+	}
+	if(TIMSK1 & (1 << OCIE1B)) {
+		return fail("compare B still on with no alarm set");
+	}
+
+	printf("clock: %lu reads over %lu ms exact and monotonic, %lu with a compare match pending\n",
+		reads, reads / TIMER_STEPS, pending);
+	printf("alarms: %d went off in order, at most %lu us late, %lu us after interrupts came back on "
+		"for the one due while they were off; the canceled one did not\n", n, latest, after_held);
+	return 0;
+}
@@ -0,0 +1,83 @@
+// Refresh rates of the chained panel display driver (../display.h) for a
+// number of panels and a CPU clock, from its cycle counts per clocked bit and
+// per scan step. The defaults are DISPLAY_CYCLES_BIT and DISPLAY_CYCLES_STEP;
+// pass the cycles escalade_simprof measured for shift() to check them.
+//
+//   escalade_display [-f cpu_hz] [-b cycles_per_bit] [-s cycles_per_step] [panels...]
+//
+// "max" scans back to back; "in game" is TimerFast()'s one scan step per
+// 1 ms tick, with the share of each tick the scan takes.
+
+////////////////////////////////////////////////////////////////////////////////
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <vector>
+
+static const double kCpuHz = 8000000.0;
+static const double kCyclesBit = 50.0;   /* DISPLAY_CYCLES_BIT */
+static const double kCyclesStep = 60.0;  /* DISPLAY_CYCLES_STEP */
+static const double kTickHz = 1000.0;    /* one shift() per timer interrupt */
+static const int kStepsPerFrame = 8;     /* every panel shows one of its rows per step */
+
+static int usage() {
+	fprintf(stderr, "usage: escalade_display [-f cpu_hz] [-b cycles_per_bit] [-s cycles_per_step] [panels...]\n");
+	return 2;
+}
+
+int main(int argc, char** argv) {
+	double cpu_hz = kCpuHz;
+	double per_bit = kCyclesBit;
+	double per_step = kCyclesStep;
+	std::vector<unsigned> panels;
+
+	for(int a = 1; a < argc; ++a) {
+		if(strcmp(argv[a], "-f") == 0 && a + 1 < argc) {
+			cpu_hz = strtod(argv[++a], NULL);
+		}
+
+		else if(strcmp(argv[a], "-b") == 0 && a + 1 < argc) {
+			per_bit = strtod(argv[++a], NULL);
+		}
+
+		else if(strcmp(argv[a], "-s") == 0 && a + 1 < argc) {
+			per_step = strtod(argv[++a], NULL);
+		}
+
+		else if(argv[a][0] != '-' && strtoul(argv[a], NULL, 0) > 0) {
+			panels.push_back((unsigned)strtoul(argv[a], NULL, 0));
+		}
+
+		else {
+			return usage();
+		}
+	}
+
+	if(cpu_hz <= 0 || per_bit <= 0 || per_step < 0) {
+		return usage();
+	}
+
+	if(panels.empty()) {
+		for(unsigned p = 1; p <= 64; p *= 2) {
+			panels.push_back(p);
+		}
+	}
+
+	printf("%.0f Hz CPU, %.1f cycles per bit, %.1f per step\n", cpu_hz, per_bit, per_step);
+	printf("%6s %8s %10s %10s %10s %12s %10s\n", "panels", "bits", "cycles", "us/step",
+		"max Hz", "in game Hz", "tick use");
+	for(unsigned p : panels) {
+		unsigned bits = 8 * p;
+		double cycles = bits * per_bit + per_step;
+		double step_s = cycles / cpu_hz;
+		double max_hz = 1.0 / (kStepsPerFrame * step_s);
+		double use = step_s * kTickHz;
+		/* A step longer than a tick makes the main loop late and the frame slower */
+		double game_hz = (use <= 1.0) ? kTickHz / kStepsPerFrame : max_hz;
+		printf("%6u %8u %10.0f %10.1f %10.0f %12.0f %9.0f%%\n", p, bits, cycles, step_s * 1e6,
+			max_hz, game_hz, use * 100.0);
+	}
+	return 0;
+}
@@ -0,0 +1,140 @@
+// Runs the firmware under the lockstep register shim for a number of games and
+// checks the high score log it keeps in EEPROM (../highscore.h): the stats it
+// finds at boot, the stats after the games, and how the writes spread over
+// the cells. The EEPROM image can be saved and fed to the next run, which is
+// then a power cycle.
+//
+//   escalade_eeprom [-s seed] [-g games] [-i image] [-o image] [-c]
+//
+// -c cuts the power right after the last game is logged, while its record is
+// still being written; the next run has to fall back to the record before it.
+
+////////////////////////////////////////////////////////////////////////////////
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+
+#include "../lockstep/driver.h"
+#include "../lockstep/legacy.h"
+
+using namespace escalade;
+
+/* Longest a record may take to reach EEPROM: 8 byte writes of 4 ticks */
+static const uint64_t kDrainTicks = 1000;
+
+static int usage() {
+	fprintf(stderr, "usage: escalade_eeprom [-s seed] [-g games] [-i image] [-o image] [-c]\n");
+	return 2;
+}
+
+int main(int argc, char** argv) {
+	unsigned seed = 0;
+	unsigned games = 100;
+	const char* in = NULL;
+	const char* out = NULL;
+	bool cut = false;
+
+	for(int a = 1; a < argc; ++a) {
+		if(strcmp(argv[a], "-s") == 0 && a + 1 < argc) {
+			seed = (unsigned)strtoul(argv[++a], NULL, 0);
+		}
+
+		else if(strcmp(argv[a], "-g") == 0 && a + 1 < argc) {
+			games = (unsigned)strtoul(argv[++a], NULL, 0);
+		}
+
+		else if(strcmp(argv[a], "-i") == 0 && a + 1 < argc) {
+			in = argv[++a];
+		}
+
+		else if(strcmp(argv[a], "-o") == 0 && a + 1 < argc) {
+			out = argv[++a];
+		}
+
+		else if(strcmp(argv[a], "-c") == 0) {
+			cut = true;
+		}
+
+		else {
+			return usage();
+		}
+	}
+
+	if(in) {
+		FILE* f = fopen(in, "rb");
+		if(!f || fread(legacy::eeprom(), 1, legacy::kEepromSize, f) != legacy::kEepromSize) {
+			fprintf(stderr, "cannot read a %zu byte image from %s\n", legacy::kEepromSize, in);
+			return 2;
+		}
+		fclose(f);
+	}
+
+	Driver driver((uint16_t)seed);
+	Game g;
+	legacy::boot((uint16_t)seed);
+	g.reset((uint16_t)seed);
+
+	legacy::HighScores expect = legacy::high_scores();
+	printf("boot: %u games, %u wins, best %u, found in %llu EEPROM reads\n", expect.games,
+		expect.wins, expect.best, (unsigned long long)legacy::eeprom_read_count());
+
+	/* The host engine says when a game is logged: a win as its screen comes
+	   up, a loss as the restart leaves the game over screen, since a rewind
+	   could still take it back until then */
+	uint64_t ticks = 0;
+	for(unsigned played = 0; played < games; ++ticks) {
+		Mode was = g.mode;
+		unsigned score = g.score;
+		Input in = driver.next(g);
+		legacy::tick(in);
+		g.tick(in);
+
+		bool won = was != kWinScreen && g.mode == kWinScreen;
+		bool lost = was == kLoseScreen && g.mode != kLoseScreen;
+		if(won || lost) {
+			++played;
+			++expect.games;
+			expect.wins += won;
+			expect.best = std::max(expect.best, won ? (unsigned)g.score : score);
+		}
+	}
+
+	uint64_t drain = 0;
+	for(; !cut && !legacy::eeprom_idle() && drain < kDrainTicks; ++drain) {
+		legacy::tick(driver.next(g));
+	}
+
+	legacy::HighScores got = legacy::high_scores();
+	bool same = got.games == expect.games && got.wins == expect.wins && got.best == expect.best;
+	printf("after %u games (%llu ticks): %u games, %u wins, best %u%s\n", games,
+		(unsigned long long)ticks, got.games, got.wins, got.best, same ? "" : " - WRONG");
+
+	if(!cut) {
+		printf("last record written %llu ticks after the game was logged\n", (unsigned long long)drain);
+	}
+
+	const uint32_t* writes = legacy::eeprom_write_counts();
+	uint64_t total = 0;
+	uint32_t most = 0;
+	size_t cells = 0;
+	for(size_t k = 0; k < legacy::kEepromSize; ++k) {
+		total += writes[k];
+		most = std::max(most, writes[k]);
+		cells += (writes[k] != 0);
+	}
+	printf("EEPROM: %llu byte writes over %zu cells, at most %u to one cell\n",
+		(unsigned long long)total, cells, most);
+
+	if(out) {
+		FILE* f = fopen(out, "wb");
+		if(!f || fwrite(legacy::eeprom(), 1, legacy::kEepromSize, f) != legacy::kEepromSize ||
+			fclose(f) != 0) {
+			fprintf(stderr, "cannot write %s\n", out);
+			return 2;
+		}
+	}
+	return same ? 0 : 1;
+}
@@ -0,0 +1,344 @@
+// Compiles authored levels into ../levels.h and plays them on the host.
+//
+//   escalade_level [-o levels.h] level.txt...
+//   escalade_level -v [-n games] [-s first_seed]
+//
+// A level is a text file, one statement per line, # to the end of a line is a
+// comment:
+//
+//   speed ms             moveWalls period from the next wall on (1 to 255)
+//   wall XXX..XXX [xN]   a wall, N times; a character per block of columns,
+//                        left to right (bit 7 first), X closed and . open,
+//                        P open with a powerup in it (first wall only)
+//
+// Walls in a row that are the same are run-length encoded, up to 128 to a
+// run. Every wall has to be passable from the gaps of the one before, the
+// first from the start column, in the moves there are at its speed on the
+// board the tools are built for; a level that is not is not written. Without
+// -o the levels are only checked. -v plays every level built into the tools
+// with the bot, -n games each from seed -s on, and fails if one is lost.
+
+////////////////////////////////////////////////////////////////////////////////
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <string>
+#include <vector>
+
+#include "../bot/bot.h"
+
+using namespace escalade;
+
+static int usage() {
+	fprintf(stderr,
+		"usage: escalade_level [-o levels.h] level.txt...\n"
+		"       escalade_level -v [-n games] [-s first_seed]\n");
+	return 2;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//One compiled level: its bytes in the format of level.h
+struct Level {
+	std::string name;
+	std::vector<uint8_t> bytes;
+	size_t walls = 0;
+};
+
+/* Pattern of a wall statement, bit 7 first; false if it is not 8 blocks */
+static bool parse_wall(const char* text, uint8_t& pattern, int& powerup) {
+	pattern = 0;
+	powerup = -1;
+	int n = 0;
+	for(; text[n] && text[n] != ' ' && text[n] != '\t'; ++n) {
+		if(n == 8) {
+			return false;
+		}
+
+		int b = 7 - n;
+		if(text[n] == 'X') {
+			pattern |= (uint8_t)(1 << b);
+		}
+
+		else if(text[n] == 'P' && powerup < 0) {
+			powerup = b;
+		}
+
+		else if(text[n] != '.') {
+			return false;
+		}
+	}
+	return n == 8;
+}
+
+/* Moves a player has between two walls at period, as walls_moves() */
+static unsigned moves_at(unsigned period) {
+	int moves = ((int)(Game::kTop * period) - kWallReactMs) / kWallMoveMs - 1;
+	if(moves < 0) {
+		return 0;
+	}
+	return moves < Game::kCols / 2 ? (unsigned)moves : Game::kCols / 2;
+}
+
+static bool compile(const char* path, Level& level) {
+	FILE* f = fopen(path, "r");
+	if(!f) {
+		perror(path);
+		return false;
+	}
+
+	std::string name = path;
+	name = name.substr(name.find_last_of('/') + 1);
+	level.name = name.substr(0, name.find('.'));
+
+	/* The run being built, flushed when anything else comes */
+	uint8_t run_pattern = 0;
+	unsigned run = 0;
+	auto flush = [&]() {
+		if(run) {
+			level.bytes.push_back((uint8_t)(kLevelWalls | (run - 1)));
+			level.bytes.push_back(run_pattern);
+			run = 0;
+		}
+	};
+
+	unsigned period = kTaskPeriods[kMoveWalls];
+	Game::Row from = Game::bit(Game::kStartCol);
+	bool ok = true;
+	char line[256];
+	for(int number = 1; fgets(line, sizeof(line), f); ++number) {
+		char* comment = strchr(line, '#');
+		if(comment) {
+			*comment = '\0';
+		}
+
+		char word[16], arg[16] = "";
+		unsigned count = 1;
+		int fields = sscanf(line, "%15s %15s x%u", word, arg, &count);
+		if(fields <= 0) {
+			continue;
+		}
+
+		if(strcmp(word, "speed") == 0 && fields == 2) {
+			period = (unsigned)strtoul(arg, NULL, 0);
+			if(period == 0 || period > 255) {
+				fprintf(stderr, "%s:%d: speed %s is not 1 to 255 ms\n", path, number, arg);
+				ok = false;
+				continue;
+			}
+			flush();
+			level.bytes.push_back(kLevelSpeed);
+			level.bytes.push_back((uint8_t)period);
+			continue;
+		}
+
+		uint8_t pattern;
+		int powerup;
+		if(strcmp(word, "wall") != 0 || fields < 2 || !parse_wall(arg, pattern, powerup) ||
+		   count == 0) {
+			fprintf(stderr, "%s:%d: bad statement\n", path, number);
+			ok = false;
+			continue;
+		}
+
+		if(pattern == 0xFF) {
+			fprintf(stderr, "%s:%d: wall has no opening\n", path, number);
+			ok = false;
+			continue;
+		}
+
+		Game::Row mask = stretch<Game::kCols>(pattern);
+		if(!Game::walls_passable(from, mask, (unsigned char)moves_at(period))) {
+			fprintf(stderr, "%s:%d: wall %zu cannot be reached from the one before in %u moves\n",
+				path, number, level.walls + 1, moves_at(period));
+			ok = false;
+		}
+		from = (Game::Row)~mask;
+
+		if(powerup >= 0) {
+			flush();
+			level.bytes.push_back(kLevelPowerup);
+			level.bytes.push_back((uint8_t)powerup);
+		}
+
+		for(unsigned c = 0; c < count; ++c) {
+			if(run && (run_pattern != pattern || run == 128)) {
+				flush();
+			}
+			run_pattern = pattern;
+			++run;
+		}
+		level.walls += count;
+	}
+	flush();
+	level.bytes.push_back(kLevelEnd);
+	fclose(f);
+
+	if(level.walls == 0) {
+		fprintf(stderr, "%s: no walls\n", path);
+		ok = false;
+	}
+
+	else if(level.walls < kWinScore) {
+		fprintf(stderr, "%s: warning: %zu walls, random ones follow until the win at %u\n",
+			path, level.walls, kWinScore);
+	}
+	return ok;
+}
+
+/* levels.h, with the CRLF line ends of the firmware sources */
+static bool write_header(const char* path, const std::vector<Level>& levels) {
+	FILE* f = fopen(path, "wb");
+	if(!f) {
+		perror(path);
+		return false;
+	}
+
+	fprintf(f, "// Levels for level.h, compiled by escalade_level from host/levels/*.txt.\r\n"
+		"// Do not edit; change the text and run make -C host levels.\r\n\r\n"
+		"////////////////////////////////////////////////////////////////////////////////\r\n\r\n"
+		"#ifndef LEVELS_H\r\n#define LEVELS_H\r\n\r\n");
+	fprintf(f, "#define LEVEL_COUNT\t%zu\r\n", levels.size());
+
+	size_t pos = 0;
+	std::string starts;
+	for(size_t n = 0; n < levels.size(); ++n) {
+		fprintf(f, "#define LEVEL_POS_%zu\t%zu\t// %s: %zu walls in %zu bytes\r\n",
+			n + 1, pos, levels[n].name.c_str(), levels[n].walls, levels[n].bytes.size());
+		pos += levels[n].bytes.size();
+		starts += (n ? ", LEVEL_POS_" : "LEVEL_POS_") + std::to_string(n + 1);
+	}
+	fprintf(f, "#define LEVEL_STARTS\t%s\r\n\r\n", starts.c_str());
+
+	fprintf(f, "const unsigned char level_data[] PROGMEM = {\r\n");
+	for(const Level& level : levels) {
+		fprintf(f, "\t/* %s */\r\n", level.name.c_str());
+		const std::vector<uint8_t>& b = level.bytes;
+		for(size_t at = 0; at < b.size(); at += 2) {
+			if(b[at] == kLevelEnd) {
+				fprintf(f, "\t0x00,\r\n");
+			}
+
+			else if(b[at] == kLevelSpeed) {
+				fprintf(f, "\t0x01, %u,\t\t/* speed %u ms */\r\n", b[at + 1], b[at + 1]);
+			}
+
+			else if(b[at] == kLevelPowerup) {
+				fprintf(f, "\t0x02, %u,\t\t/* powerup in block %u */\r\n", b[at + 1], b[at + 1]);
+			}
+
+			else {
+				char blocks[17];
+				for(int k = 0; k < 8; ++k) {
+					blocks[2 * k] = (b[at + 1] >> (7 - k)) & 0x01 ? 'X' : 'O';
+					blocks[2 * k + 1] = ' ';
+				}
+				blocks[15] = '\0';
+				fprintf(f, "\t0x%02X, 0x%02X,\t/* %3u x %s */\r\n", b[at], b[at + 1],
+					(b[at] & ~kLevelWalls) + 1, blocks);
+			}
+		}
+	}
+	if(levels.empty()) {
+		fprintf(f, "\t0x00,\r\n");
+	}
+	fprintf(f, "};\r\n\r\n#endif //LEVELS_H\r\n");
+	return fclose(f) == 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//Plays level n with the bot from each seed until the game ends
+static bool validate(int n, unsigned games, unsigned seed) {
+	Bot bot;
+	unsigned wins = 0;
+	for(unsigned s = seed; s < seed + games; ++s) {
+		Game g;
+		g.reset((uint16_t)s);
+		g.play_level(n);
+		Input in;
+		while(g.playing()) {
+			if(ticks_until_sample(g) == 0) {
+				in.stick_x = stick_for(bot.decide(g));
+			}
+			g.tick(in);
+		}
+
+		if(g.game_over == 0x00) {
+			++wins;
+		}
+
+		else {
+			printf("level %d seed %u: died at score %u\n", n, s, g.score);
+		}
+	}
+
+	printf("level %d: won %u of %u\n", n, wins, games);
+	return wins == games;
+}
+
+int main(int argc, char** argv) {
+	const char* out = NULL;
+	bool play = false;
+	unsigned games = 10;
+	unsigned seed = 0;
+	std::vector<const char*> sources;
+
+	for(int a = 1; a < argc; ++a) {
+		if(strcmp(argv[a], "-o") == 0 && a + 1 < argc) {
+			out = argv[++a];
+		}
+
+		else if(strcmp(argv[a], "-v") == 0) {
+			play = true;
+		}
+
+		else if(strcmp(argv[a], "-n") == 0 && a + 1 < argc) {
+			games = (unsigned)strtoul(argv[++a], NULL, 0);
+		}
+
+		else if(strcmp(argv[a], "-s") == 0 && a + 1 < argc) {
+			seed = (unsigned)strtoul(argv[++a], NULL, 0);
+		}
+
+		else if(argv[a][0] != '-') {
+			sources.push_back(argv[a]);
+		}
+
+		else {
+			return usage();
+		}
+	}
+
+	if(play) {
+		bool ok = true;
+		for(int n = 1; n <= kLevelCount; ++n) {
+			ok = validate(n, games, seed) && ok;
+		}
+		return ok ? 0 : 1;
+	}
+
+	if(sources.empty()) {
+		return usage();
+	}
+
+	std::vector<Level> levels(sources.size());
+	bool ok = true;
+	size_t bytes = 0;
+	for(size_t n = 0; n < sources.size(); ++n) {
+		ok = compile(sources[n], levels[n]) && ok;
+		bytes += levels[n].bytes.size();
+		printf("level %zu %s: %zu walls in %zu bytes\n", n + 1, levels[n].name.c_str(),
+			levels[n].walls, levels[n].bytes.size());
+	}
+
+	if(bytes > 0xFFFF) {
+		fprintf(stderr, "levels take %zu bytes, more than level_pos reaches\n", bytes);
+		ok = false;
+	}
+
+	if(!ok) {
+		return 1;
+	}
+	return out && !write_header(out, levels) ? 1 : 0;
+}
@@ -0,0 +1,483 @@
+// Runs the firmware (main.c) and the host engine side by side and stops at the
+// first tick where they disagree.
+//
+//   escalade_lockstep [-n seeds] [-s first_seed] [-t ticks] [-j jobs] [-o repro]
+//   escalade_lockstep -r repro
+//
+// Every seed gets its own process: main.c lives in globals, so each run forks
+// before booting it. Inputs come from the lookahead bot with random slips and
+// button presses mixed in, so runs cover wins, deaths, restarts and all three
+// speeds. On a divergence the input trace is shrunk to the fewest changes that
+// still diverge and written to the repro file; -r replays it and prints both
+// boards at the divergent tick.
+
+////////////////////////////////////////////////////////////////////////////////
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <vector>
+
+#include "../lockstep/driver.h"
+#include "../lockstep/legacy.h"
+
+using namespace escalade;
+
+namespace {
+
+/* Input from this tick on */
+struct Change {
+	uint32_t tick;
+	uint16_t stick_x;
+	bool button;
+};
+
+typedef std::vector<Change> Trace;
+
+/* What a child reports back */
+struct Result {
+	int64_t diverged;   /* tick, or -1 */
+	uint64_t ticks;
+	uint32_t games;
+	uint32_t wins;
+	uint32_t max_score;
+	uint32_t changes;   /* Change records that follow when diverged */
+};
+
+/* Steps both engines until they differ or max_ticks pass; returns the tick */
+template <typename NextInput>
+int64_t run_lockstep(uint16_t seed, uint64_t max_ticks, Game& g, NextInput next) {
+	legacy::boot(seed);
+	g.reset(seed);
+
+	for(uint64_t t = 0; t < max_ticks; ++t) {
+		Input in = next(g, t);
+		legacy::tick(in);
+		g.tick(in);
+		if(legacy::snapshot() != snapshot_of(g)) {
+			return (int64_t)t;
+		}
+	}
+	return -1;
+}
+
+/* Replays trace, holding each change until the next */
+int64_t replay(uint16_t seed, const Trace& trace, uint64_t max_ticks, Game& g) {
+	size_t k = 0;
+	Input in;
+	return run_lockstep(seed, max_ticks, g, [&](const Game&, uint64_t t) {
+		while(k < trace.size() && trace[k].tick <= t) {
+			in.stick_x = trace[k].stick_x;
+			in.button = trace[k].button;
+			++k;
+		}
+		return in;
+	});
+}
+
+/* Runs fn in a fresh process and reads back what it writes to out */
+template <typename Fn>
+pid_t spawn(FILE* out, Fn fn) {
+	fflush(NULL);
+	pid_t pid = fork();
+	if(pid == 0) {
+		fn(out);
+		fflush(out);
+		_exit(0);
+	}
+	return pid;
+}
+
+bool read_result(FILE* f, Result& r, Trace* trace) {
+	rewind(f);
+	if(fread(&r, sizeof(r), 1, f) != 1) {
+		return false;
+	}
+
+	if(trace) {
+		trace->resize(r.changes);
+		if(r.changes && fread(trace->data(), sizeof(Change), r.changes, f) != r.changes) {
+			return false;
+		}
+	}
+	return true;
+}
+
+void play_seed(uint16_t seed, uint64_t max_ticks, FILE* out) {
+	Driver driver(seed);
+	Trace trace;
+	Input last;
+	last.stick_x = 0xFFFF;
+
+	Result r = {-1, 0, 0, 0, 0, 0};
+	bool was_playing = true;
+	Game g;
+	r.diverged = run_lockstep(seed, max_ticks, g, [&](const Game& cur, uint64_t t) {
+		Input in = driver.next(cur);
+		if(in.stick_x != last.stick_x || in.button != last.button) {
+			trace.push_back(Change{(uint32_t)t, in.stick_x, in.button});
+			last = in;
+		}
+
+		/* Game results at the first tick of each end screen */
+		if(was_playing && cur.finished()) {
+			++r.games;
+			if(cur.game_over == 0x00) {
+				++r.wins;
+			}
+		}
+		was_playing = !cur.finished();
+		if(cur.score > r.max_score) {
+			r.max_score = cur.score;
+		}
+
+		r.ticks = t + 1;
+		return in;
+	});
+
+	if(r.diverged >= 0) {
+		r.changes = (uint32_t)trace.size();
+	}
+	fwrite(&r, sizeof(r), 1, out);
+	if(r.changes) {
+		fwrite(trace.data(), sizeof(Change), trace.size(), out);
+	}
+}
+
+/* Divergent tick of trace in a fresh process, -1 if none */
+int64_t try_trace(uint16_t seed, const Trace& trace, uint64_t max_ticks) {
+	FILE* f = tmpfile();
+	pid_t pid = spawn(f, [&](FILE* out) {
+		Game g;
+		Result r = {replay(seed, trace, max_ticks, g), 0, 0, 0, 0, 0};
+		fwrite(&r, sizeof(r), 1, out);
+	});
+
+	int status = 0;
+	waitpid(pid, &status, 0);
+	Result r;
+	bool ok = read_result(f, r, NULL);
+	fclose(f);
+	return ok ? r.diverged : -1;
+}
+
+//Drops chunks of input changes (the previous input is then held longer) while
+//the engines still diverge, halving the chunk size down to single changes.
+//Returns the divergent tick of the shrunk trace.
+int64_t minimize(uint16_t seed, Trace& trace, int64_t diverged, unsigned max_trials) {
+	unsigned trials = 0;
+	size_t chunk = trace.size() / 2;
+
+	while(chunk > 0 && trials < max_trials) {
+		bool shrunk = false;
+		for(size_t at = 0; at < trace.size() && trials < max_trials; ) {
+			Trace candidate(trace.begin(), trace.begin() + at);
+			size_t end = (at + chunk < trace.size()) ? at + chunk : trace.size();
+			candidate.insert(candidate.end(), trace.begin() + end, trace.end());
+
+			int64_t t = try_trace(seed, candidate, (uint64_t)diverged + 1);
+			++trials;
+			if(t >= 0) {
+				trace.swap(candidate);
+				diverged = t;
+				shrunk = true;
+				while(!trace.empty() && trace.back().tick > (uint64_t)diverged) {
+					trace.pop_back();
+				}
+			}
+
+			else {
+				at += chunk;
+			}
+		}
+
+		if(!shrunk) {
+			chunk /= 2;
+		}
+
+		else if(chunk > trace.size() / 2) {
+			chunk = (trace.size() > 1) ? trace.size() / 2 : trace.size();
+		}
+	}
+
+	printf("minimized in %u trials\n", trials);
+	return diverged;
+}
+
+bool write_repro(const char* path, uint16_t seed, int64_t diverged, const Trace& trace) {
+	FILE* f = fopen(path, "w");
+	if(!f) {
+		return false;
+	}
+
+	fprintf(f, "# escalade_lockstep repro: input from the given tick on\n");
+	fprintf(f, "seed %u\ndiverge %lld\n", seed, (long long)diverged);
+	Input last;
+	for(const Change& c : trace) {
+		if(c.stick_x != last.stick_x) {
+			fprintf(f, "%u stick %u\n", c.tick, c.stick_x);
+		}
+		if(c.button != last.button) {
+			fprintf(f, "%u button %s\n", c.tick, c.button ? "down" : "up");
+		}
+		last.stick_x = c.stick_x;
+		last.button = c.button;
+	}
+	return fclose(f) == 0;
+}
+
+bool read_repro(const char* path, uint16_t& seed, int64_t& diverged, Trace& trace) {
+	FILE* f = fopen(path, "r");
+	if(!f) {
+		return false;
+	}
+
+	char line[128];
+	Input in;
+	seed = 0;
+	diverged = -1;
+	trace.clear();
+	while(fgets(line, sizeof(line), f)) {
+		unsigned tick, v;
+		char what[16];
+		long long d;
+		if(sscanf(line, "seed %u", &v) == 1) {
+			seed = (uint16_t)v;
+			continue;
+		}
+
+		else if(sscanf(line, "diverge %lld", &d) == 1) {
+			diverged = d;
+			continue;
+		}
+
+		else if(sscanf(line, "%u stick %u", &tick, &v) == 2) {
+			in.stick_x = (uint16_t)v;
+		}
+
+		else if(sscanf(line, "%u button %15s", &tick, what) == 2) {
+			in.button = strcmp(what, "down") == 0;
+		}
+
+		else {
+			continue;
+		}
+
+		/* Stick and button lines of the same tick make one change */
+		if(!trace.empty() && trace.back().tick == tick) {
+			trace.back().stick_x = in.stick_x;
+			trace.back().button = in.button;
+		}
+
+		else {
+			trace.push_back(Change{tick, in.stick_x, in.button});
+		}
+	}
+	fclose(f);
+	return diverged >= 0;
+}
+
+/* Cell values of the layers at row r, column c; a digit per layer set */
+void print_cell(const Snapshot& s, int r, int c) {
+	int cell = 0;
+	int layers = 0;
+	if((s.powerup_rows[r] >> c) & 0x01) { cell = cell * 10 + kPowerup; ++layers; }
+	if((s.wall_rows[r] >> c) & 0x01) { cell = cell * 10 + kWall; ++layers; }
+	if((s.player_rows[r] >> c) & 0x01) { cell = cell * 10 + kPlayer; ++layers; }
+	printf(layers > 1 ? "(%d)" : "%d", cell);
+}
+
+void print_snapshots(const Snapshot& a, const Snapshot& b) {
+	printf("%-*s%s\n", Game::kCols + 16, "main.c", "host engine");
+	for(int r = Game::kTop; r >= 0; --r) {
+		for(int c = 0; c < Game::kCols; ++c) {
+			print_cell(a, r, c);
+		}
+		printf("%16s", "");
+		for(int c = 0; c < Game::kCols; ++c) {
+			print_cell(b, r, c);
+		}
+		bool differ = a.wall_rows[r] != b.wall_rows[r] || a.powerup_rows[r] != b.powerup_rows[r] ||
+			a.player_rows[r] != b.player_rows[r];
+		printf("%s\n", differ ? "   <" : "");
+	}
+
+#define FIELD(name) printf("%-22s %6d %6d%s\n", #name, (int)a.name, (int)b.name, \
+		a.name != b.name ? "   <" : "")
+	FIELD(score);
+	FIELD(game_over);
+	FIELD(powerup_activated);
+	FIELD(counter);
+	FIELD(wall_count);
+	FIELD(level_pos);
+	FIELD(powerup_remainingTime);
+	FIELD(seeder);
+	FIELD(width);
+	FIELD(screen_step);
+	FIELD(screen_ms);
+#undef FIELD
+}
+
+int show_repro(const char* path) {
+	uint16_t seed;
+	int64_t diverged;
+	Trace trace;
+	if(!read_repro(path, seed, diverged, trace)) {
+		fprintf(stderr, "cannot read repro %s\n", path);
+		return 2;
+	}
+
+	Game g;
+	int64_t t = replay(seed, trace, (uint64_t)diverged + 1, g);
+	if(t < 0) {
+		printf("seed %u: no divergence within %lld ticks\n", seed, (long long)diverged + 1);
+		return 0;
+	}
+
+	printf("seed %u: diverged at tick %lld (%zu input changes)\n", seed, (long long)t, trace.size());
+	print_snapshots(legacy::snapshot(), snapshot_of(g));
+	return 1;
+}
+
+int usage() {
+	fprintf(stderr,
+		"usage: escalade_lockstep [-n seeds] [-s first_seed] [-t ticks] [-j jobs] [-o repro]\n"
+		"       escalade_lockstep -r repro\n");
+	return 2;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+	unsigned seeds = 64;
+	unsigned first = 0;
+	uint64_t max_ticks = 1000000;
+	long jobs = sysconf(_SC_NPROCESSORS_ONLN);
+	unsigned max_trials = 2000;
+	const char* repro = "lockstep_repro.txt";
+
+	for(int a = 1; a < argc; ++a) {
+		if(strcmp(argv[a], "-r") == 0 && a + 1 < argc) {
+			return show_repro(argv[a + 1]);
+		}
+
+		else if(strcmp(argv[a], "-n") == 0 && a + 1 < argc) {
+			seeds = (unsigned)strtoul(argv[++a], NULL, 0);
+		}
+
+		else if(strcmp(argv[a], "-s") == 0 && a + 1 < argc) {
+			first = (unsigned)strtoul(argv[++a], NULL, 0);
+		}
+
+		else if(strcmp(argv[a], "-t") == 0 && a + 1 < argc) {
+			max_ticks = strtoull(argv[++a], NULL, 0);
+		}
+
+		else if(strcmp(argv[a], "-j") == 0 && a + 1 < argc) {
+			jobs = strtol(argv[++a], NULL, 0);
+		}
+
+		else if(strcmp(argv[a], "-o") == 0 && a + 1 < argc) {
+			repro = argv[++a];
+		}
+
+		else {
+			return usage();
+		}
+	}
+
+	if(jobs < 1) {
+		jobs = 1;
+	}
+
+	struct Job {
+		pid_t pid;
+		uint16_t seed;
+		FILE* out;
+	};
+	std::vector<Job> running;
+
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	unsigned next = 0, done = 0;
+	uint64_t ticks = 0;
+	uint32_t games = 0, wins = 0, max_score = 0;
+	bool failed = false;
+	uint16_t bad_seed = 0;
+	int64_t bad_tick = -1;
+	Trace bad_trace;
+
+	while((next < seeds && !failed) || !running.empty()) {
+		while(next < seeds && !failed && running.size() < (size_t)jobs) {
+			uint16_t seed = (uint16_t)(first + next++);
+			FILE* f = tmpfile();
+			pid_t pid = spawn(f, [&](FILE* out) { play_seed(seed, max_ticks, out); });
+			running.push_back(Job{pid, seed, f});
+		}
+
+		int status = 0;
+		pid_t pid = ::wait(&status);
+		for(size_t k = 0; k < running.size(); ++k) {
+			if(running[k].pid != pid) {
+				continue;
+			}
+
+			Job job = running[k];
+			running.erase(running.begin() + k);
+			++done;
+
+			Result r;
+			Trace trace;
+			if(!WIFEXITED(status) || WEXITSTATUS(status) != 0 || !read_result(job.out, r, &trace)) {
+				printf("seed %u: worker crashed\n", job.seed);
+				failed = true;
+			}
+
+			else {
+				ticks += r.ticks;
+				games += r.games;
+				wins += r.wins;
+				if(r.max_score > max_score) {
+					max_score = r.max_score;
+				}
+
+				if(r.diverged >= 0 && (bad_tick < 0 || r.diverged < bad_tick)) {
+					printf("seed %u: diverged at tick %lld\n", job.seed, (long long)r.diverged);
+					failed = true;
+					bad_seed = job.seed;
+					bad_tick = r.diverged;
+					bad_trace.swap(trace);
+				}
+			}
+			fclose(job.out);
+			break;
+		}
+	}
+
+	double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	printf("seeds %u  ticks %llu (%.1f M/s)  games %u  won %u  max score %u\n",
+		done, (unsigned long long)ticks, ticks / seconds / 1e6, games, wins, max_score);
+
+	if(bad_tick < 0) {
+		return failed ? 1 : 0;
+	}
+
+	while(!bad_trace.empty() && bad_trace.back().tick > (uint64_t)bad_tick) {
+		bad_trace.pop_back();
+	}
+	printf("minimizing %zu input changes\n", bad_trace.size());
+	bad_tick = minimize(bad_seed, bad_trace, bad_tick, max_trials);
+
+	if(!write_repro(repro, bad_seed, bad_tick, bad_trace)) {
+		fprintf(stderr, "cannot write %s\n", repro);
+	}
+
+	else {
+		printf("repro: %s (%zu input changes, tick %lld)\n", repro, bad_trace.size(),
+			(long long)bad_tick);
+	}
+	return 1;
+}
@@ -0,0 +1,281 @@
+// Replays an input recording in the host engine at full speed, or rebuilds one
+// from a hardware telemetry capture.
+//
+//   escalade_replay [-b] [-n repeat] [-k interval [-o out]] [-S tick] recording
+//   escalade_replay -T capture.bin [-k interval] [-o recording] [-b]
+//
+// The replay is checked against the recording's final line when it has one.
+// -b prints the board at the end, -n replays that many times for profiling.
+// -k (re)writes keyframes every interval ticks; -S seeks to a tick from the
+// nearest keyframe, checks the state against a replay from tick 0 and times
+// both. -R runs a rewind buffer of the given size along the replay, checks
+// restores against the snapshots it took and reports how far back it reaches.
+
+////////////////////////////////////////////////////////////////////////////////
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+#include <chrono>
+#include <string>
+#include <vector>
+
+#include "../replay/replay.h"
+#include "../sim/rewind.h"
+
+using namespace escalade;
+
+static const char* const kModeNames[] = { "playing", "win screen", "game over screen" };
+
+static void print_board(const Game& g) {
+	int8_t board[Game::kRows][Game::kCols];
+	g.compose(board);
+	for(int r = Game::kTop; r >= 0; --r) {
+		for(int c = 0; c < Game::kCols; ++c) {
+			printf("%d", board[r][c]);
+		}
+		printf("\n");
+	}
+}
+
+static bool load_capture(const char* path, std::vector<TelemetryEvent>& events) {
+	FILE* f = fopen(path, "rb");
+	if(!f) {
+		return false;
+	}
+
+	TelemetryDecoder decoder;
+	uint8_t buf[4096];
+	size_t n;
+	while((n = fread(buf, 1, sizeof(buf), f)) > 0) {
+		decoder.feed(buf, n, [&](const TelemetryEvent& ev) { events.push_back(ev); });
+	}
+	fclose(f);
+
+	const TelemetryStats& st = decoder.stats();
+	printf("capture: %" PRIu64 " records, %" PRIu64 " resyncs, %" PRIu64 " skipped bytes\n",
+		st.records, st.resyncs, st.skipped);
+	return true;
+}
+
+/* Restores checked per snapshot taken */
+static const uint32_t kRewindCheckEvery = 16;
+
+static int check_rewind(const Recording& rec, size_t bytes) {
+	Rewind rewind(bytes);
+	std::vector<Game> snapshots;
+	InputCursor cursor(rec.changes);
+	Game g;
+	g.reset(rec.seed);
+
+	uint64_t pushes = 0, checks = 0, failed = 0, entry_bytes = 0, held = 0, full = 0;
+	size_t max_entry = 0, min_held = SIZE_MAX;
+	double max_us = 0;
+
+	for(uint64_t t = 0; t < rec.ticks; ++t) {
+		Input in = cursor.at(t);
+		if(in.button) {
+			rewind.clear();
+			snapshots.clear();
+		}
+		g.tick(in);
+
+		if(!rewind.tick(g)) {
+			continue;
+		}
+		snapshots.push_back(g);
+		if(snapshots.size() < 2) {
+			continue;
+		}
+
+		++pushes;
+		entry_bytes += rewind.last_entry();
+		max_entry = std::max(max_entry, rewind.last_entry());
+		/* Only count a full ring */
+		if(rewind.used() + Rewind::kMaxEntry + 2 > bytes) {
+			++full;
+			held += rewind.entries();
+			min_held = std::min(min_held, rewind.entries());
+		}
+
+		if(pushes % kRewindCheckEvery == 0) {
+			Rewind copy = rewind;
+			Game back;
+			std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+			uint32_t steps = copy.restore(back, UINT32_MAX);
+			max_us = std::max(max_us, std::chrono::duration<double, std::micro>(
+				std::chrono::steady_clock::now() - start).count());
+
+			++checks;
+			if(steps >= snapshots.size() ||
+				memcmp((const void*)&back, &snapshots[snapshots.size() - 1 - steps], sizeof(Game)) != 0) {
+				++failed;
+			}
+		}
+	}
+
+	if(pushes == 0) {
+		printf("rewind: no snapshots taken\n");
+		return 0;
+	}
+
+	printf("rewind: %zu byte ring, snapshot every %u ticks, entries %.1f bytes on average, %zu at most\n",
+		bytes, Rewind::kDefaultPeriod, (double)entry_bytes / pushes, max_entry);
+	if(full) {
+		printf("rewind: a full ring goes back %.1f snapshots on average, %zu at least (%.1f s)\n",
+			(double)held / full, min_held, min_held * Rewind::kDefaultPeriod / 1000.0);
+	}
+	printf("rewind: %" PRIu64 " restores to the oldest snapshot checked, %" PRIu64 " wrong, "
+		"slowest %.1f us\n", checks, failed, max_us);
+	return failed ? 1 : 0;
+}
+
+static int usage() {
+	fprintf(stderr,
+		"usage: escalade_replay [-b] [-n repeat] [-k interval [-o out]] [-S tick] [-R bytes] recording\n"
+		"       escalade_replay -T capture.bin [-k interval] [-o recording] [-b]\n");
+	return 2;
+}
+
+int main(int argc, char** argv) {
+	const char* path = NULL;
+	const char* capture = NULL;
+	const char* out = NULL;
+	bool board = false;
+	unsigned repeat = 1;
+	long interval = -1;
+	long long seek_tick = -1;
+	long rewind_bytes = 0;
+
+	for(int a = 1; a < argc; ++a) {
+		if(strcmp(argv[a], "-T") == 0 && a + 1 < argc) {
+			capture = argv[++a];
+		}
+
+		else if(strcmp(argv[a], "-o") == 0 && a + 1 < argc) {
+			out = argv[++a];
+		}
+
+		else if(strcmp(argv[a], "-n") == 0 && a + 1 < argc) {
+			repeat = (unsigned)strtoul(argv[++a], NULL, 0);
+		}
+
+		else if(strcmp(argv[a], "-k") == 0 && a + 1 < argc) {
+			interval = strtol(argv[++a], NULL, 0);
+		}
+
+		else if(strcmp(argv[a], "-S") == 0 && a + 1 < argc) {
+			seek_tick = strtoll(argv[++a], NULL, 0);
+		}
+
+		else if(strcmp(argv[a], "-R") == 0 && a + 1 < argc) {
+			rewind_bytes = strtol(argv[++a], NULL, 0);
+		}
+
+		else if(strcmp(argv[a], "-b") == 0) {
+			board = true;
+		}
+
+		else if(!path && argv[a][0] != '-') {
+			path = argv[a];
+		}
+
+		else {
+			return usage();
+		}
+	}
+
+	Recording rec;
+	std::string error;
+
+	if(capture) {
+		std::vector<TelemetryEvent> events;
+		if(!load_capture(capture, events)) {
+			fprintf(stderr, "cannot read %s\n", capture);
+			return 2;
+		}
+
+		if(!recording_from_telemetry(events, rec, error)) {
+			fprintf(stderr, "%s: %s\n", capture, error.c_str());
+			return 1;
+		}
+	}
+
+	else if(!path) {
+		return usage();
+	}
+
+	else if(!read_recording(path, rec, error)) {
+		fprintf(stderr, "%s\n", error.c_str());
+		return 2;
+	}
+
+	if(interval >= 0) {
+		add_keyframes(rec, (uint32_t)interval);
+	}
+
+	if(out && (capture || interval >= 0) && !write_recording(out, rec, capture ? capture : path)) {
+		fprintf(stderr, "cannot write %s\n", out);
+		return 2;
+	}
+
+	if(!rec.keyframes.empty()) {
+		printf("%zu keyframes every %u ticks, %zu bytes each\n", rec.keyframes.size(),
+			rec.keyframe_interval, kKeyframeBytes);
+	}
+
+	if(rewind_bytes > 0) {
+		if(rewind_bytes & (rewind_bytes - 1)) {
+			fprintf(stderr, "rewind buffer size must be a power of two\n");
+			return 2;
+		}
+		return check_rewind(rec, (size_t)rewind_bytes);
+	}
+
+	if(seek_tick >= 0) {
+		Game from_start, sought;
+		std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now();
+		replay(rec, from_start, (uint64_t)seek_tick);
+		std::chrono::steady_clock::time_point t1 = std::chrono::steady_clock::now();
+		uint64_t simulated = seek(rec, (uint64_t)seek_tick, sought);
+		std::chrono::steady_clock::time_point t2 = std::chrono::steady_clock::now();
+
+		bool same = state_hash(sought) == state_hash(from_start);
+		printf("seek to %lld: %" PRIu64 " ticks simulated in %.1f us, from tick 0 %.1f us, state %s\n",
+			seek_tick, simulated, std::chrono::duration<double, std::micro>(t2 - t1).count(),
+			std::chrono::duration<double, std::micro>(t1 - t0).count(),
+			same ? "matches" : "DOES NOT MATCH");
+		if(board) {
+			print_board(sought);
+		}
+		return same ? 0 : 1;
+	}
+
+	Game g;
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	for(unsigned n = 0; n < repeat; ++n) {
+		replay(rec, g);
+	}
+	double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+	printf("seed %u: %" PRIu64 " ticks, %zu input changes, score %u, %s\n", rec.seed, rec.ticks,
+		rec.changes.size(), g.score, kModeNames[g.mode]);
+	printf("replayed %u times in %.3f s (%.1f M ticks/s)\n", repeat, seconds,
+		repeat * (double)rec.ticks / seconds / 1e6);
+	if(board) {
+		print_board(g);
+	}
+
+	if(!rec.has_final) {
+		return 0;
+	}
+
+	FinalState f = final_state_of(g);
+	bool same = f.score == rec.final_state.score && f.game_over == rec.final_state.game_over &&
+		f.mode == rec.final_state.mode && f.hash == rec.final_state.hash;
+	printf("final state %s the recording\n", same ? "matches" : "DOES NOT MATCH");
+	return same ? 0 : 1;
+}
@@ -0,0 +1,332 @@
+// Response time analysis of the firmware's two level scheduler (../timer.h),
+// from the worst case execution times escalade_simprof measured.
+//
+//   escalade_rta [-f cpu_hz] [-w job=cycles]... [-p job=ms]... [simprof_report]
+//
+// The jobs, highest priority first:
+//   interrupts  TIMER1_COMPA up to its sei(), TIMER1_COMPB (the alarms of
+//               timer.h and their callbacks), USART0_UDRE and EE_READY. They
+//               run with interrupts masked, so they do not preempt each other;
+//               pending ones are taken in vector order.
+//   fast        TimerFast(), the display scan step and the stick sample, with
+//               interrupts back on: the other three interrupts preempt it.
+//   tasks       the game tasks, run cooperatively in game_init order by the
+//               main loop and preempted by everything above. walls_fill(), the
+//               idle work after them, only blocks them.
+//
+// WCETs are the "max" column of the report, or -w, in cycles. TIMER1_COMPA's
+// masked part is __vector_13 less TimerFast, which leaves the ms count and the
+// TimerAlarmArm() scan it does every ms, and fast is __vector_13 whole, so an
+// interrupt that nested into a measured TimerFast() is counted twice, which
+// errs on the safe side. The alarm interrupt only runs if something sets an
+// alarm; with no __vector_14 in the report it counts as 0 cycles, and its
+// period, one alarm a ms by default, depends on the callers (see -w, -p).
+// Periods are the shortest the firmware uses (moveWalls after a score of 40;
+// a level can set it lower, see -p) and, for interrupts, the shortest time
+// between two of them.
+//
+// The response time R of a job is from its release to its end:
+//   preemptive      R = B + C + sum over preemptors h of ceil(R / T_h) * C_h
+//   non-preemptive  s = B + sum over higher peers j and preemptors h of
+//                       (floor(s / T) + 1) * C, then
+//                   R = s + C + sum over h of (ceil(R / T_h) - floor(s / T_h) - 1) * C_h
+// with B the longest job of a lower priority that cannot be preempted. The
+// deadline is the period; exits with 1 if a job can miss it. The main loop's
+// own bookkeeping between tasks is in no function and is not counted.
+
+////////////////////////////////////////////////////////////////////////////////
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <string>
+#include <vector>
+
+static const double kCpuHz = 8000000.0;
+
+enum Level { kInterrupt, kFast, kTask, kIdle };
+
+static const char* const kLevelNames[] = {"interrupt", "fast", "task", "idle"};
+
+struct Job {
+	const char* name;
+	Level level;
+	const char* symbol;  /* function whose max cycles are the WCET */
+	const char* minus;   /* a callee to take off it, or NULL */
+	double period_ms;
+	bool optional;       /* 0 cycles if the report does not have it */
+};
+
+static const Job kJobs[] = {
+	{"timer", kInterrupt, "__vector_13", "TimerFast", 1.0, false},      /* TIMER1_COMPA */
+	{"alarm", kInterrupt, "__vector_14", NULL, 1.0, true},              /* TIMER1_COMPB */
+	{"usart", kInterrupt, "__vector_21", NULL, 10.0 / 38.4, false},     /* USART0_UDRE, a byte at 38400 baud */
+	{"eeprom", kInterrupt, "__vector_25", NULL, 3.3, false},            /* EE_READY, an EEPROM byte write */
+	{"fast", kFast, "__vector_13", NULL, 1.0, false},
+	{"getMovement", kTask, "getMovement", NULL, 45.0, false},
+	{"moveObject", kTask, "moveObject", NULL, 45.0, false},
+	{"moveWalls", kTask, "moveWalls", NULL, 100.0, false},
+	{"powerupShooting", kTask, "powerupShooting", NULL, 75.0, false},
+	{"playMusic", kTask, "playMusic", NULL, 250.0, false},
+	{"walls_fill", kIdle, "walls_fill", NULL, 1.0, false},
+};
+static const int kNumJobs = sizeof(kJobs) / sizeof(kJobs[0]);
+
+struct Function {
+	std::string name;
+	double max;
+};
+
+static int usage() {
+	fprintf(stderr, "usage: escalade_rta [-f cpu_hz] [-w job=cycles]... [-p job=ms]... [simprof_report]\n");
+	return 2;
+}
+
+static int find_job(const char* name, size_t len) {
+	for(int j = 0; j < kNumJobs; ++j) {
+		if(strlen(kJobs[j].name) == len && strncmp(kJobs[j].name, name, len) == 0) {
+			return j;
+		}
+	}
+	return -1;
+}
+
+/* "job=value" into values[job] */
+static bool parse_override(const char* arg, std::vector<double>& values) {
+	const char* eq = strchr(arg, '=');
+	int j = eq ? find_job(arg, (size_t)(eq - arg)) : -1;
+	if(j < 0) {
+		fprintf(stderr, "unknown job in %s\n", arg);
+		return false;
+	}
+	values[j] = strtod(eq + 1, NULL);
+	return true;
+}
+
+/* The function table of an escalade_simprof report */
+static bool read_report(const char* path, std::vector<Function>& out) {
+	FILE* f = fopen(path, "r");
+	if(!f) {
+		return false;
+	}
+	char line[256];
+	while(fgets(line, sizeof(line), f)) {
+		char name[64];
+		unsigned long long calls, cycles, max;
+		double mean;
+		if(sscanf(line, "%63s %llu %llu %lf %llu", name, &calls, &cycles, &mean, &max) == 5) {
+			out.push_back({name, (double)max});
+		}
+	}
+	fclose(f);
+	return true;
+}
+
+static double lookup(const std::vector<Function>& functions, const char* name) {
+	for(const Function& f : functions) {
+		if(f.name == name) {
+			return f.max;
+		}
+	}
+	return -1.0;
+}
+
+/* Who can preempt job i while it runs. The timer's masked part does not
+   count on its own: it comes before every TimerFast() and fast has it */
+static bool preempts(int h, int i) {
+	bool timer = kJobs[h].minus != NULL;
+	if(kJobs[i].level == kFast) {
+		return kJobs[h].level == kInterrupt && !timer;
+	}
+	if(kJobs[i].level == kTask) {
+		return kJobs[h].level == kFast || (kJobs[h].level == kInterrupt && !timer);
+	}
+	return false;
+}
+
+/* Same level, not preemptive among themselves */
+static bool peer(int j, int i) {
+	Level a = kJobs[j].level == kIdle ? kTask : kJobs[j].level;
+	Level b = kJobs[i].level == kIdle ? kTask : kJobs[i].level;
+	return j != i && a == b && a != kFast;
+}
+
+static double blocking(int i, const std::vector<double>& c) {
+	double b = 0;
+	for(int j = 0; j < kNumJobs; ++j) {
+		/* The fast level starts when the timer's interrupt is taken, behind
+		   whichever interrupt is running */
+		bool lower = kJobs[i].level == kFast ? preempts(j, i) : j > i && peer(j, i);
+		if(lower && c[j] > b) {
+			b = c[j];
+		}
+	}
+	return b;
+}
+
+/* Response time in cycles, or -1 if it grows past limit */
+static double response(int i, const std::vector<double>& c, const std::vector<double>& t, double limit) {
+	double b = blocking(i, c);
+
+	if(kJobs[i].level == kFast) {
+		double r = b + c[i];
+		for(;;) {
+			double next = b + c[i];
+			for(int h = 0; h < kNumJobs; ++h) {
+				if(preempts(h, i)) {
+					next += ceil(r / t[h]) * c[h];
+				}
+			}
+			if(next > limit) {
+				return -1.0;
+			}
+			if(next == r) {
+				return r;
+			}
+			r = next;
+		}
+	}
+
+	double s = b;
+	for(;;) {
+		double next = b;
+		for(int h = 0; h < i; ++h) {
+			if(peer(h, i) || preempts(h, i)) {
+				next += (floor(s / t[h]) + 1) * c[h];
+			}
+		}
+		if(next > limit) {
+			return -1.0;
+		}
+		if(next == s) {
+			break;
+		}
+		s = next;
+	}
+
+	double r = s + c[i];
+	for(;;) {
+		double next = s + c[i];
+		for(int h = 0; h < kNumJobs; ++h) {
+			if(preempts(h, i)) {
+				double more = ceil(r / t[h]) - floor(s / t[h]) - 1;
+				if(more > 0) {
+					next += more * c[h];
+				}
+			}
+		}
+		if(next > limit) {
+			return -1.0;
+		}
+		if(next == r) {
+			return r;
+		}
+		r = next;
+	}
+}
+
+int main(int argc, char** argv) {
+	double cpu_hz = kCpuHz;
+	std::vector<double> wcet(kNumJobs, -1.0);
+	std::vector<double> period_ms(kNumJobs, -1.0);
+	const char* report = NULL;
+
+	for(int a = 1; a < argc; ++a) {
+		if(strcmp(argv[a], "-f") == 0 && a + 1 < argc) {
+			cpu_hz = strtod(argv[++a], NULL);
+		}
+
+		else if(strcmp(argv[a], "-w") == 0 && a + 1 < argc) {
+			if(!parse_override(argv[++a], wcet)) {
+				return 2;
+			}
+		}
+
+		else if(strcmp(argv[a], "-p") == 0 && a + 1 < argc) {
+			if(!parse_override(argv[++a], period_ms)) {
+				return 2;
+			}
+		}
+
+		else if(argv[a][0] != '-' && !report) {
+			report = argv[a];
+		}
+
+		else {
+			return usage();
+		}
+	}
+
+	if(cpu_hz <= 0) {
+		return usage();
+	}
+
+	std::vector<Function> functions;
+	if(report && !read_report(report, functions)) {
+		fprintf(stderr, "cannot read %s\n", report);
+		return 2;
+	}
+
+	std::vector<double> c(kNumJobs), t(kNumJobs);
+	bool missing = false;
+	for(int j = 0; j < kNumJobs; ++j) {
+		c[j] = wcet[j];
+		if(c[j] < 0) {
+			c[j] = lookup(functions, kJobs[j].symbol);
+			if(c[j] >= 0 && kJobs[j].minus) {
+				double callee = lookup(functions, kJobs[j].minus);
+				c[j] = callee >= 0 ? fmax(c[j] - callee, 0.0) : -1.0;
+			}
+		}
+		if(c[j] < 0 && kJobs[j].optional) {
+			fprintf(stderr, "%s: %s is not in the report, counted as 0 cycles\n", kJobs[j].name,
+				kJobs[j].symbol);
+			c[j] = 0;
+		}
+		if(c[j] < 0) {
+			fprintf(stderr, "no WCET for %s: %s%s%s is not in the report, give -w %s=cycles\n",
+				kJobs[j].name, kJobs[j].symbol, kJobs[j].minus ? " or " : "",
+				kJobs[j].minus ? kJobs[j].minus : "", kJobs[j].name);
+			missing = true;
+		}
+		t[j] = (period_ms[j] > 0 ? period_ms[j] : kJobs[j].period_ms) * cpu_hz / 1000.0;
+	}
+	if(missing) {
+		return 2;
+	}
+
+	const double us = 1e6 / cpu_hz;
+	double worst[kIdle] = {0, 0, 0};
+	bool fail = false;
+
+	printf("%.0f Hz CPU, times in us\n", cpu_hz);
+	printf("%-16s %-10s %8s %8s %8s %8s %8s %8s\n", "job", "level", "cycles", "C", "B", "R", "T",
+		"slack");
+	for(int i = 0; i < kNumJobs; ++i) {
+		if(kJobs[i].level == kIdle) {
+			printf("%-16s %-10s %8.0f %8.1f %8s %8s %8s %8s  blocks the tasks\n", kJobs[i].name,
+				kLevelNames[kJobs[i].level], c[i], c[i] * us, "-", "-", "-", "-");
+			continue;
+		}
+
+		double r = response(i, c, t, 100 * t[i]);
+		bool ok = r >= 0 && r <= t[i];
+		fail |= !ok;
+		if(r < 0) {
+			printf("%-16s %-10s %8.0f %8.1f %8.1f %8s %8.1f %8s  unbounded\n", kJobs[i].name,
+				kLevelNames[kJobs[i].level], c[i], c[i] * us, blocking(i, c) * us, "-", t[i] * us, "-");
+			worst[kJobs[i].level] = INFINITY;
+			continue;
+		}
+		printf("%-16s %-10s %8.0f %8.1f %8.1f %8.1f %8.1f %8.1f  %s\n", kJobs[i].name,
+			kLevelNames[kJobs[i].level], c[i], c[i] * us, blocking(i, c) * us, r * us, t[i] * us,
+			(t[i] - r) * us, ok ? "ok" : "MISSED");
+		worst[kJobs[i].level] = fmax(worst[kJobs[i].level], r * us);
+	}
+
+	printf("\nworst latency: interrupts %.1f us, fast %.1f us, tasks %.1f us\n", worst[kInterrupt],
+		worst[kFast], worst[kTask]);
+	return fail ? 1 : 0;
+}
@@ -0,0 +1,458 @@
+// Decodes firmware telemetry into a Chrome trace-event / Perfetto JSON file and
+// prints task utilization, tick jitter, display refresh rate and SRAM use.
+//
+//   escalade_trace [-o trace.json] [-t] input
+//
+// input is a capture file, a serial device or pty (set to raw 38400 baud and
+// read until interrupted), or - for stdin. -t adds an instant event for every
+// tick to the trace, which makes it much larger.
+
+////////////////////////////////////////////////////////////////////////////////
+
+#include <errno.h>
+#include <fcntl.h>
+#include <math.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <termios.h>
+#include <unistd.h>
+
+#include "../sim/game.h"
+#include "../telemetry/decoder.h"
+
+using namespace escalade;
+
+namespace {
+
+const char* const kTaskNames[kNumTasks] = {
+	"getMovement", "moveObject", "moveWalls", "powerupShooting", "playMusic",
+};
+
+/* Trace thread ids: the game, then one per task */
+const int kGameTid = 0;
+
+/* ATmega1284p */
+const uint32_t kSramBytes = 16384;
+
+volatile sig_atomic_t stop = 0;
+
+void on_signal(int) {
+	stop = 1;
+}
+
+double us_of(uint64_t t) {
+	return t * (1000.0 / kTelemetryTicksPerMs);
+}
+
+struct TaskStats {
+	uint64_t runs;
+	uint64_t busy;
+	uint64_t max;
+	bool open;
+	uint64_t start;
+};
+
+struct Summary {
+	bool any;
+	uint64_t first, last;
+
+	TaskStats tasks[kNumTasks];
+
+	uint64_t ticks;
+	bool have_tick;
+	uint64_t last_tick;
+	uint64_t intervals;
+	double interval_sum, interval_sq;
+	uint64_t interval_min, interval_max;
+	uint64_t late; /* intervals more than 10% off 1 ms */
+
+	bool have_frames;
+	uint64_t frames;
+	uint64_t frame_time;     /* span of the reports in frames */
+	uint64_t frames_dropped; /* dropped at the last frames report */
+	double refresh_min, refresh_max;
+	uint64_t last_frames;
+
+	uint64_t dropped;
+	uint64_t games, wins;
+
+	/* Latest memstat.h report */
+	bool have_ram;
+	uint32_t ram_data, ram_bss, ram_heap, stack_peak;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+//Streams trace events as they are decoded, so a capture cut short by ^C still
+//gives a usable file.
+class TraceWriter {
+public:
+	explicit TraceWriter(FILE* f) : f_(f) {
+		if(!f_) {
+			return;
+		}
+
+		fprintf(f_, "[\n");
+		event("{\"ph\":\"M\",\"pid\":1,\"name\":\"process_name\",\"args\":{\"name\":\"Escalade\"}}");
+		thread_name(kGameTid, "game");
+		for(int t = 0; t < kNumTasks; ++t) {
+			thread_name(t + 1, kTaskNames[t]);
+		}
+	}
+
+	~TraceWriter() {
+		if(f_) {
+			fprintf(f_, "\n]\n");
+		}
+	}
+
+	void slice(char ph, int task, uint64_t time) {
+		if(f_) {
+			begin();
+			fprintf(f_, "{\"ph\":\"%c\",\"pid\":1,\"tid\":%d,\"ts\":%.3f,\"name\":\"%s\",\"cat\":\"task\"}",
+				ph, task + 1, us_of(time), kTaskNames[task]);
+		}
+	}
+
+	void instant(const char* name, uint64_t time, const char* arg_name, long arg) {
+		if(!f_) {
+			return;
+		}
+
+		begin();
+		fprintf(f_, "{\"ph\":\"i\",\"s\":\"t\",\"pid\":1,\"tid\":%d,\"ts\":%.3f,\"name\":\"%s\"",
+			kGameTid, us_of(time), name);
+		if(arg_name) {
+			fprintf(f_, ",\"args\":{\"%s\":%ld}", arg_name, arg);
+		}
+		fprintf(f_, "}");
+	}
+
+	void counter(const char* name, uint64_t time, double value) {
+		if(f_) {
+			begin();
+			fprintf(f_, "{\"ph\":\"C\",\"pid\":1,\"ts\":%.3f,\"name\":\"%s\",\"args\":{\"%s\":%.2f}}",
+				us_of(time), name, name, value);
+		}
+	}
+
+private:
+	void begin() {
+		fprintf(f_, first_ ? "" : ",\n");
+		first_ = false;
+	}
+
+	void event(const char* json) {
+		begin();
+		fputs(json, f_);
+	}
+
+	void thread_name(int tid, const char* name) {
+		begin();
+		fprintf(f_, "{\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"name\":\"thread_name\",\"args\":{\"name\":\"%s\"}}",
+			tid, name);
+	}
+
+	FILE* f_;
+	bool first_ = true;
+};
+
+void account(const TelemetryEvent& ev, Summary& s, TraceWriter& trace, bool trace_ticks) {
+	if(!s.any) {
+		s.any = true;
+		s.first = ev.time;
+	}
+	s.last = ev.time;
+
+	if(ev.type >= TELEMETRY_TASK_START && ev.type < TELEMETRY_TASK_START + kNumTasks) {
+		TaskStats& t = s.tasks[ev.type - TELEMETRY_TASK_START];
+		t.open = true;
+		t.start = ev.time;
+		trace.slice('B', ev.type - TELEMETRY_TASK_START, ev.time);
+		return;
+	}
+
+	if(ev.type >= TELEMETRY_TASK_END && ev.type < TELEMETRY_TASK_END + kNumTasks) {
+		TaskStats& t = s.tasks[ev.type - TELEMETRY_TASK_END];
+		if(t.open) {
+			uint64_t d = ev.time - t.start;
+			++t.runs;
+			t.busy += d;
+			if(d > t.max) {
+				t.max = d;
+			}
+			t.open = false;
+			trace.slice('E', ev.type - TELEMETRY_TASK_END, ev.time);
+		}
+		return;
+	}
+
+	switch(ev.type) {
+		case TELEMETRY_TICK_START:
+			++s.ticks;
+			if(s.have_tick) {
+				uint64_t d = ev.time - s.last_tick;
+				++s.intervals;
+				s.interval_sum += d;
+				s.interval_sq += (double)d * d;
+				if(s.intervals == 1 || d < s.interval_min) {
+					s.interval_min = d;
+				}
+				if(d > s.interval_max) {
+					s.interval_max = d;
+				}
+				if(d * 10 < kTelemetryTicksPerMs * 9 || d * 10 > kTelemetryTicksPerMs * 11) {
+					++s.late;
+				}
+			}
+			s.have_tick = true;
+			s.last_tick = ev.time;
+			if(trace_ticks) {
+				trace.instant("tick", ev.time, NULL, 0);
+			}
+			break;
+
+		case TELEMETRY_FRAMES:
+			/* A report after dropped records may follow a lost one whose
+			   frames it does not have */
+			if(s.have_frames && ev.time > s.last_frames && s.dropped == s.frames_dropped) {
+				uint64_t span = ev.time - s.last_frames;
+				double hz = ev.arg / (span / (1000.0 * kTelemetryTicksPerMs));
+				s.frames += ev.arg;
+				s.frame_time += span;
+				/* The report an end screen cuts short has too few frames
+				   for a rate; it still counts toward the mean */
+				bool whole = span >= (uint64_t)(TELEMETRY_FRAMES_MS - 1) * kTelemetryTicksPerMs;
+				if(whole && (s.refresh_max == 0 || hz < s.refresh_min)) {
+					s.refresh_min = hz;
+				}
+				if(whole && hz > s.refresh_max) {
+					s.refresh_max = hz;
+				}
+				trace.counter("refresh_hz", ev.time, hz);
+			}
+
+			s.have_frames = true;
+			s.last_frames = ev.time;
+			s.frames_dropped = s.dropped;
+			break;
+
+		case TELEMETRY_SCORE:
+			trace.counter("score", ev.time, ev.arg);
+			break;
+
+		case TELEMETRY_RAM_DATA:
+			s.ram_data = ev.arg;
+			break;
+
+		case TELEMETRY_RAM_BSS:
+			s.ram_bss = ev.arg;
+			break;
+
+		case TELEMETRY_RAM_HEAP:
+			s.ram_heap = ev.arg;
+			break;
+
+		case TELEMETRY_STACK_PEAK:
+			s.have_ram = true;
+			s.stack_peak = ev.arg;
+			trace.counter("stack_peak", ev.time, ev.arg);
+			break;
+
+		case TELEMETRY_RESTART:
+			/* Tick intervals across an end screen mean nothing */
+			s.have_tick = false;
+			trace.instant("restart", ev.time, NULL, 0);
+			break;
+
+		case TELEMETRY_REWIND:
+			/* The game over before it was taken back */
+			--s.games;
+			trace.instant("rewind", ev.time, NULL, 0);
+			break;
+
+		case TELEMETRY_GAME_OVER:
+		case TELEMETRY_WIN:
+			++s.games;
+			s.wins += (ev.type == TELEMETRY_WIN);
+			s.have_tick = false;
+			trace.instant(telemetry_name(ev.type), ev.time, "score", ev.arg);
+			break;
+
+		case TELEMETRY_DROPPED:
+			s.dropped += ev.arg;
+			trace.instant("dropped", ev.time, "records", ev.arg);
+			break;
+
+		case TELEMETRY_WALL:
+			trace.instant("wall", ev.time, "columns", ev.arg);
+			break;
+
+		case TELEMETRY_POWERUP_SPAWN:
+			trace.instant("powerup_spawn", ev.time, "powerup_spawn", ev.arg);
+			break;
+
+		case TELEMETRY_MOVE:
+		case TELEMETRY_POWERUP_PICKUP:
+			trace.instant(telemetry_name(ev.type), ev.time, "width", ev.arg);
+			break;
+
+		default:
+			trace.instant(telemetry_name(ev.type), ev.time, NULL, 0);
+			break;
+	}
+}
+
+void print_summary(const Summary& s, const TelemetryStats& d) {
+	double span = s.any ? (double)(s.last - s.first) : 0.0;
+	double seconds = span / (1000.0 * kTelemetryTicksPerMs);
+
+	printf("%llu bytes, %llu records over %.3f s (%.0f B/s)\n",
+		(unsigned long long)d.bytes, (unsigned long long)d.records, seconds,
+		seconds > 0 ? d.bytes / seconds : 0.0);
+	printf("syncs %llu  skipped bytes %llu  resyncs %llu  other versions %llu  dropped records %llu\n",
+		(unsigned long long)d.syncs, (unsigned long long)d.skipped,
+		(unsigned long long)d.resyncs, (unsigned long long)d.bad_version,
+		(unsigned long long)s.dropped);
+	printf("games %llu  won %llu\n\n", (unsigned long long)s.games, (unsigned long long)s.wins);
+
+	printf("%-16s %8s %10s %10s %8s\n", "task", "runs", "mean us", "max us", "busy");
+	for(int t = 0; t < kNumTasks; ++t) {
+		const TaskStats& ts = s.tasks[t];
+		printf("%-16s %8llu %10.1f %10.1f %7.2f%%\n", kTaskNames[t], (unsigned long long)ts.runs,
+			ts.runs ? us_of(ts.busy) / ts.runs : 0.0, us_of(ts.max),
+			span > 0 ? 100.0 * ts.busy / span : 0.0);
+	}
+
+	printf("\nticks %llu", (unsigned long long)s.ticks);
+	if(s.intervals) {
+		double mean = s.interval_sum / s.intervals;
+		double var = s.interval_sq / s.intervals - mean * mean;
+		printf(": interval mean %.1f us  stddev %.1f us  min %.1f us  max %.1f us  >10%% off %llu",
+			us_of(1) * mean, us_of(1) * sqrt(var > 0 ? var : 0), us_of(s.interval_min),
+			us_of(s.interval_max), (unsigned long long)s.late);
+	}
+	printf("\n");
+
+	if(s.frames && s.frame_time) {
+		double frame_seconds = s.frame_time / (1000.0 * kTelemetryTicksPerMs);
+		printf("display refresh %.1f Hz mean, %.1f to %.1f Hz per report\n",
+			s.frames / frame_seconds, s.refresh_min, s.refresh_max);
+	}
+
+	else {
+		printf("display refresh: no frame reports\n");
+	}
+
+	if(s.have_ram) {
+		uint32_t used = s.ram_data + s.ram_bss + s.ram_heap + s.stack_peak;
+		printf("SRAM: .data %u  .bss %u  heap %u  stack peak %u  free %d of %u bytes\n",
+			s.ram_data, s.ram_bss, s.ram_heap, s.stack_peak, (int)(kSramBytes - used), kSramBytes);
+	}
+}
+
+int open_input(const char* path) {
+	if(strcmp(path, "-") == 0) {
+		return 0;
+	}
+
+	int fd = open(path, O_RDONLY | O_NOCTTY);
+	if(fd < 0 || !isatty(fd)) {
+		return fd;
+	}
+
+	struct termios tio;
+	if(tcgetattr(fd, &tio) == 0) {
+		cfmakeraw(&tio);
+		cfsetispeed(&tio, B38400);
+		cfsetospeed(&tio, B38400);
+		tcsetattr(fd, TCSANOW, &tio);
+	}
+	return fd;
+}
+
+int usage() {
+	fprintf(stderr, "usage: escalade_trace [-o trace.json] [-t] input\n");
+	return 2;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+	const char* out = NULL;
+	const char* in = NULL;
+	bool trace_ticks = false;
+
+	for(int a = 1; a < argc; ++a) {
+		if(strcmp(argv[a], "-o") == 0 && a + 1 < argc) {
+			out = argv[++a];
+		}
+
+		else if(strcmp(argv[a], "-t") == 0) {
+			trace_ticks = true;
+		}
+
+		else if(!in) {
+			in = argv[a];
+		}
+
+		else {
+			return usage();
+		}
+	}
+
+	if(!in) {
+		return usage();
+	}
+
+	int fd = open_input(in);
+	if(fd < 0) {
+		fprintf(stderr, "cannot open %s: %s\n", in, strerror(errno));
+		return 2;
+	}
+
+	FILE* json = NULL;
+	if(out && !(json = fopen(out, "w"))) {
+		fprintf(stderr, "cannot write %s\n", out);
+		return 2;
+	}
+
+	struct sigaction sa;
+	memset(&sa, 0, sizeof(sa));
+	sa.sa_handler = on_signal;
+	sigaction(SIGINT, &sa, NULL);
+	sigaction(SIGTERM, &sa, NULL);
+
+	TelemetryDecoder decoder;
+	Summary summary;
+	memset(&summary, 0, sizeof(summary));
+	{
+		TraceWriter trace(json);
+		uint8_t buf[4096];
+		while(!stop) {
+			ssize_t n = read(fd, buf, sizeof(buf));
+			if(n < 0 && errno == EINTR) {
+				continue;
+			}
+
+			else if(n <= 0) {
+				break;
+			}
+
+			decoder.feed(buf, (size_t)n, [&](const TelemetryEvent& ev) {
+				account(ev, summary, trace, trace_ticks);
+			});
+		}
+	}
+
+	if(json) {
+		fclose(json);
+	}
+	if(fd != 0) {
+		close(fd);
+	}
+
+	print_summary(summary, decoder.stats());
+	return 0;
+}
@@ -0,0 +1,117 @@
+// Checks the passability test of the random walls (../walls.h, walls_moves()
+// and walls_passable()) on the board the tools are built for.
+//
+//   escalade_walls
+//
+// For the moves of each score band, every pair of walls with one or two
+// openings is tested against the distance worked out column by column: the
+// farthest column of the old openings from the nearest column of the new ones,
+// around the wrap. They have to agree, and on the 8x8 board a one-block gap
+// four columns from the last one has to be turned down from a score of 40,
+// where the moves fall short of half the columns. Exits with 1 on the first
+// thing wrong.
+
+////////////////////////////////////////////////////////////////////////////////
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <vector>
+
+#include "../sim/game.h"
+
+using namespace escalade;
+
+namespace {
+
+typedef Game::Row Row;
+
+/* Columns from c to the nearest open one of wall, around the wrap */
+int distance(int c, uint8_t wall) {
+	Row open = (Row)~stretch<Game::kCols>(wall);
+	for(int d = 0; d <= Game::kCols / 2; ++d) {
+		int left = (c + Game::kCols - d) % Game::kCols;
+		int right = (c + d) % Game::kCols;
+		if(((open >> left) & 1) || ((open >> right) & 1)) {
+			return d;
+		}
+	}
+	return Game::kCols;
+}
+
+/* Moves a player anywhere in the openings of from needs to reach one of to */
+int needed(uint8_t from, uint8_t to) {
+	Row open = (Row)~stretch<Game::kCols>(from);
+	int most = 0;
+	for(int c = 0; c < Game::kCols; ++c) {
+		if(((open >> c) & 1) && distance(c, to) > most) {
+			most = distance(c, to);
+		}
+	}
+	return most;
+}
+
+/* Walls with one opening of 1 to 3 blocks or two of 1 */
+std::vector<uint8_t> walls() {
+	std::vector<uint8_t> out;
+	for(int p = 0; p < 0xFF; ++p) {
+		int open = 0, runs = 0;
+		for(int b = 0; b < 8; ++b) {
+			bool hole = !((p >> b) & 1);
+			open += hole;
+			runs += hole && ((p >> ((b + 7) % 8)) & 1);
+		}
+		if((runs == 1 && open <= 3) || (runs == 2 && open == 2)) {
+			out.push_back((uint8_t)p);
+		}
+	}
+	return out;
+}
+
+int fail(const char* what) {
+	fprintf(stderr, "walls check failed: %s\n", what);
+	return 1;
+}
+
+} // namespace
+
+int main() {
+	const unsigned char scores[] = {0, 20, 40};
+	std::vector<uint8_t> all = walls();
+
+	printf("%dx%d board, %zu walls\n", Game::kRows, Game::kCols, all.size());
+	for(unsigned char score : scores) {
+		unsigned char moves = Game::walls_moves(score);
+		unsigned long pairs = 0, refused = 0;
+		for(uint8_t from : all) {
+			for(uint8_t to : all) {
+				bool passable = Game::walls_passable((Row)~stretch<Game::kCols>(from),
+					stretch<Game::kCols>(to), moves);
+				if(passable != (needed(from, to) <= moves)) {
+					fprintf(stderr, "score %u, %u moves: 0x%02X after 0x%02X needs %d and is %s\n",
+						score, moves, to, from, needed(from, to), passable ? "passed" : "refused");
+					return fail("walls_passable() does not agree with the distance");
+				}
+				++pairs;
+				refused += !passable;
+			}
+		}
+		printf("score %2u+: %u moves, %lu of %lu pairs refused\n", score, moves, refused, pairs);
+	}
+
+	if(Game::kRows == 8 && Game::kCols == 8) {
+		/* The gap at column 0, then one at column 4: 4 moves either way */
+		Row from = (Row)~stretch<Game::kCols>(0xFE);
+		Row far = stretch<Game::kCols>(0xEF);
+		Row near = stretch<Game::kCols>(0xF7);
+		if(Game::walls_passable(from, far, Game::walls_moves(45))) {
+			return fail("a gap 4 columns away passed at a score of 45");
+		}
+		if(!Game::walls_passable(from, far, Game::walls_moves(39)) ||
+		   !Game::walls_passable(from, near, Game::walls_moves(45))) {
+			return fail("a reachable gap was refused");
+		}
+		printf("a gap 4 columns from the last one is refused from a score of 40\n");
+	}
+	return 0;
+}
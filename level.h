@@ -0,0 +1,77 @@
+// Authored levels, streamed out of flash. A level is a run of bytes in
+// level_data (levels.h, compiled from host/levels/*.txt by escalade_level)
+// read one wall at a time by level_next(), with a cursor of three bytes in
+// GameState whatever the length of the level:
+//
+//   LEVEL_WALLS | (n - 1), p	n walls (1 to 128) of pattern p, bit n closing
+//								block n as in walls.h
+//   LEVEL_SPEED, ms			moveWalls period from the next wall on
+//   LEVEL_POWERUP, b			a powerup in block b of the next wall
+//   LEVEL_END					the level is over
+//
+// Building with -DLEVEL=n plays level n from power on and every restart in
+// place of the random walls; the score speed-ups of main() are left to the
+// level. Once it is over, walls_fill() goes back to drawing walls. The level
+// is trusted: escalade_level checks every wall is passable from the one before
+// at its speed and plays the levels on the host before they are written out.
+
+////////////////////////////////////////////////////////////////////////////////
+
+#ifndef LEVEL_H
+#define LEVEL_H
+
+#include <avr/pgmspace.h>
+#include "game_state.h"
+#include "levels.h"
+
+#define LEVEL_END		0x00
+#define LEVEL_SPEED		0x01
+#define LEVEL_POWERUP	0x02
+#define LEVEL_WALLS		0x80
+
+#ifndef LEVEL
+#define LEVEL 0
+#endif
+#if LEVEL > LEVEL_COUNT
+#error "LEVEL is not in levels.h"
+#endif
+
+/* Offset of level n in level_data, for game_init; no level plays from 0 */
+#define LEVEL_POS_0		0
+#define LEVEL_POS_(n)	LEVEL_POS_##n
+#define LEVEL_POS(n)	LEVEL_POS_(n)
+
+////////////////////////////////////////////////////////////////////////////////
+//Functionality - reads the level's next wall, and what comes with it
+//Parameter: where to put the pattern, the powerup column or WALL_NO_POWERUP
+//           and the new moveWalls period or 0
+//Returns: 1, or 0 with nothing read once the level is over
+static unsigned char level_next(unsigned char* pattern, unsigned char* spawn, unsigned char* period) {
+	*spawn = WALL_NO_POWERUP;
+	*period = 0;
+	
+	while(game.level_run == 0) {
+		unsigned char op = pgm_read_byte(&level_data[game.level_pos]);
+		if(op == LEVEL_END) {
+			return 0;
+		}
+		
+		unsigned char arg = pgm_read_byte(&level_data[game.level_pos + 1]);
+		game.level_pos += 2;
+		if(op & LEVEL_WALLS) {
+			game.level_run = (op & ~LEVEL_WALLS) + 1;
+		}
+		else if(op == LEVEL_SPEED) {
+			*period = arg;
+		}
+		else {
+			*spawn = arg * (BOARD_COLS / 8);
+		}
+	}
+	
+	--game.level_run;
+	*pattern = pgm_read_byte(&level_data[game.level_pos - 1]);
+	return 1;
+}
+
+#endif //LEVEL_H
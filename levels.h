@@ -0,0 +1,87 @@
+// Levels for level.h, compiled by escalade_level from host/levels/*.txt.
+// Do not edit; change the text and run make -C host levels.
+
+////////////////////////////////////////////////////////////////////////////////
+
+#ifndef LEVELS_H
+#define LEVELS_H
+
+#define LEVEL_COUNT	2
+#define LEVEL_POS_1	0	// 01_warmup: 60 walls in 67 bytes
+#define LEVEL_POS_2	67	// 02_zigzag: 60 walls in 67 bytes
+#define LEVEL_STARTS	LEVEL_POS_1, LEVEL_POS_2
+
+const unsigned char level_data[] PROGMEM = {
+	/* 01_warmup */
+	0x01, 200,		/* speed 200 ms */
+	0x81, 0xE3,	/*   2 x X X X O O O X X */
+	0x82, 0xF1,	/*   3 x X X X X O O O X */
+	0x81, 0xE3,	/*   2 x X X X O O O X X */
+	0x82, 0xC7,	/*   3 x X X O O O X X X */
+	0x81, 0x8F,	/*   2 x X O O O X X X X */
+	0x02, 4,		/* powerup in block 4 */
+	0x80, 0x8F,	/*   1 x X O O O X X X X */
+	0x81, 0xC7,	/*   2 x X X O O O X X X */
+	0x81, 0xE3,	/*   2 x X X X O O O X X */
+	0x82, 0xF1,	/*   3 x X X X X O O O X */
+	0x01, 150,		/* speed 150 ms */
+	0x82, 0xF3,	/*   3 x X X X X O O X X */
+	0x81, 0xE7,	/*   2 x X X X O O X X X */
+	0x81, 0xCF,	/*   2 x X X O O X X X X */
+	0x80, 0xE7,	/*   1 x X X X O O X X X */
+	0x81, 0xF3,	/*   2 x X X X X O O X X */
+	0x81, 0xF9,	/*   2 x X X X X X O O X */
+	0x02, 3,		/* powerup in block 3 */
+	0x81, 0xF3,	/*   2 x X X X X O O X X */
+	0x82, 0xE7,	/*   3 x X X X O O X X X */
+	0x82, 0xCF,	/*   3 x X X O O X X X X */
+	0x01, 100,		/* speed 100 ms */
+	0x82, 0xDF,	/*   3 x X X O X X X X X */
+	0x81, 0xEF,	/*   2 x X X X O X X X X */
+	0x81, 0xDF,	/*   2 x X X O X X X X X */
+	0x81, 0xEF,	/*   2 x X X X O X X X X */
+	0x81, 0xF7,	/*   2 x X X X X O X X X */
+	0x02, 4,		/* powerup in block 4 */
+	0x82, 0xE7,	/*   3 x X X X O O X X X */
+	0x81, 0xEF,	/*   2 x X X X O X X X X */
+	0x81, 0xDF,	/*   2 x X X O X X X X X */
+	0x81, 0xEF,	/*   2 x X X X O X X X X */
+	0x00,
+	/* 02_zigzag */
+	0x01, 180,		/* speed 180 ms */
+	0x81, 0xEF,	/*   2 x X X X O X X X X */
+	0x81, 0xDF,	/*   2 x X X O X X X X X */
+	0x81, 0xBF,	/*   2 x X O X X X X X X */
+	0x81, 0xDF,	/*   2 x X X O X X X X X */
+	0x81, 0xEF,	/*   2 x X X X O X X X X */
+	0x81, 0xF7,	/*   2 x X X X X O X X X */
+	0x81, 0xFB,	/*   2 x X X X X X O X X */
+	0x81, 0xFD,	/*   2 x X X X X X X O X */
+	0x02, 2,		/* powerup in block 2 */
+	0x80, 0xF9,	/*   1 x X X X X X O O X */
+	0x81, 0xFB,	/*   2 x X X X X X O X X */
+	0x01, 140,		/* speed 140 ms */
+	0x81, 0xF7,	/*   2 x X X X X O X X X */
+	0x82, 0xEB,	/*   3 x X X X O X O X X */
+	0x82, 0xDB,	/*   3 x X X O X X O X X */
+	0x81, 0xEB,	/*   2 x X X X O X O X X */
+	0x82, 0xE7,	/*   3 x X X X O O X X X */
+	0x02, 4,		/* powerup in block 4 */
+	0x80, 0xE7,	/*   1 x X X X O O X X X */
+	0x01, 110,		/* speed 110 ms */
+	0x81, 0xEF,	/*   2 x X X X O X X X X */
+	0x81, 0xDF,	/*   2 x X X O X X X X X */
+	0x81, 0xEF,	/*   2 x X X X O X X X X */
+	0x81, 0xF7,	/*   2 x X X X X O X X X */
+	0x81, 0xFB,	/*   2 x X X X X X O X X */
+	0x81, 0xF7,	/*   2 x X X X X O X X X */
+	0x01, 90,		/* speed 90 ms */
+	0x82, 0xEB,	/*   3 x X X X O X O X X */
+	0x82, 0xD7,	/*   3 x X X O X O X X X */
+	0x82, 0xEF,	/*   3 x X X X O X X X X */
+	0x81, 0xDF,	/*   2 x X X O X X X X X */
+	0x83, 0xEF,	/*   4 x X X X O X X X X */
+	0x00,
+};
+
+#endif //LEVELS_H
@@ -1,25 +1,38 @@
 #include <avr/io.h>
 #include <avr/interrupt.h>
+#include <avr/pgmspace.h>
 #include <stdlib.h>
+#include <string.h>
 #include <time.h>
 #include <stdio.h>
 #include "scheduler.h"
 #include "timer.h"
+#include "simprof.h"
+#include "telemetry.h"
+#include "game_state.h"
+#include "bus.h"
+#include "shots.h"
+#include "display.h"
+#include "sprite.h"
+#include "walls.h"
+#include "rewind.h"
+#include "highscore.h"
+#include "memstat.h"
 
-unsigned char GND = 0x01; 
-unsigned char B; 
-unsigned char G; 
-unsigned char R;
-
-int led_arr[8][8]; 
-int row = 0;
-int seeder = 0;
-unsigned char score = 0;
-int height, width = 0;
-unsigned char game_over = 0x00;
+GameState game;
 double frqs[58];
-unsigned char powerup_activated = 0x00;
 unsigned char B2;
+volatile unsigned short stick_x = 512; // Last thumbstick sample, see TimerFast()
+
+/* stick_x for the tasks, read with interrupts off: TimerFast() can write it
+between the two byte loads and leave half of each sample */
+unsigned short stick_read() {
+	unsigned char sreg = SREG;
+	cli();
+	unsigned short x = stick_x;
+	SREG = sreg;
+	return x;
+}
 
 /* set_PWM code for Music */
 void set_PWM(double frequency) {
@@ -65,74 +78,23 @@ void PWM_off() {
 }
 
 /* Shift Register Code */
+/* Shows the next scan step: the same row of every panel, see display.h.
+Only TimerFast() calls it, so the display gets a step every 1 ms tick
+however long the game tasks take */
 void shift() {
-	if(row == 7) {
-		GND = 0x01;
-		row = 0;
+	if(display_row == 7) {
+		display_gnd = 0x01;
+		display_row = 0;
+		TELEMETRY_FRAME();
 	}
 	
 	else {
-		GND = (GND << 1);
-		row++;
-	}
-	
-	B = 0x00;
-	R = 0x00;
-	G = 0x00;
-	
-	// select a bit for a color and right shift if less than 7
-	for(int col = 0; col < 8; col++) {
-		if(led_arr[row][col] == 1) {
-			G |= 0x80;
-		}
-		
-		if(led_arr[row][col] == 2){
-			B |= 0x80;
-		}
-		
-		if(led_arr[row][col] == 3){
-			R |= 0x80;
-		}
-		
-		if(led_arr[row][col] == 4){
-			G |= 0x80;  R |= 0x80;  B |= 0x80;
-		} // WHITE
-		
-		if(col < 7) {
-			G = G >> 1;
-			B = B >> 1;
-			R = R >> 1;
-		}
-	}
-	
-	/* Invert due to Common Anode LED Matrix */
-	G = ~G;
-	B = ~B;
-	R = ~R;
-	
-	for(int i = 7; i >= 0; --i) {
-		// Sets SRCLR to 1 allowing data to be set
-		// Also clears SRCLK in preparation of sending data
-		PORTD = 0x88;
-		PORTC = 0x88;
-		// set SER = next bit of data to be sent.
-		PORTD |= ((R >> i) & 0x01);
-		PORTD |= (((B >> i) << 4) & 0x10);
-		PORTC |= (((G >> i) << 4) & 0x10);
-		PORTC |= ((GND >> i) & 0x01);
-		
-		// set SRCLK = 1. Rising edge shifts next bit of data into the shift register
-		PORTD |= 0x44;
-		PORTC |= 0x44;
+		display_gnd = (display_gnd << 1);
+		display_row++;
 	}
 	
-	// set RCLK = 1. Rising edge copies data from “Shift” register to “Storage” register
-	PORTD |= 0x22;
-	PORTC |= 0x22;
-	
-	// clears all lines in preparation of a new transmission
-	PORTD = 0x00;
-	PORTC = 0x00;
+	display_prepare();
+	display_scan();
 }
 
 void InitADC() {
@@ -140,29 +102,30 @@ void InitADC() {
 	ADCSRA=(1<<ADEN)|(1<<ADPS2)|(1<<ADPS1)|(1<<ADPS0);
 	// ADEN: Set to turn on ADC , by default it is turned off
 	//ADPS2: ADPS2 and ADPS0 set to make division factor 32
-
+	
+	ADCSRA |= (1<<ADSC); // First conversion, TimerFast() reads it and starts the next
 }
 
-void convert_to_digital() {
-	ADCSRA |=(1<<ADSC);
-	while ( !(ADCSRA & (1<<ADIF))); // Wait for conversion
+/* The high priority level of the scheduler, see timer.h: runs every 1 ms tick
+from the timer interrupt, ahead of whatever the tasks are doing. A scan step
+of the display and the thumbstick sample; a conversion takes 208 us of the
+1 ms, so the one started last tick is always done and nothing waits on it */
+void TimerFast() {
+	shift();
+	
+	stick_x = ADC;
+	ADCSRA |= (1<<ADSC);
 }
 
-/* GLOBAL VARIABLES FOR GETMOVEMENT SM */
-/* 0x01 = Right */
-/* 0x02 = Left */
-unsigned char movement_bit_val;
-int x_val;
 
 /* GETMOVEMENT SM */
 
-/* Will detect the movement of the thumb stick using ADC to
-digital conversion. Checks threshold values to assign global
-variable, movement_bit_val, to upwards, downwards, left or right */
+/* Will detect the movement of the thumb stick from the
+sample TimerFast() takes. Checks threshold values and publishes a
+move, right or left, for moveObject on the bus (bus.h) */
 enum getMovement_States {init, wait, x_axis};
 int getMovement(int state) {
 	
-	ADMUX = 0x40;
 	switch(state) {
 		case init:
 			state = wait;
@@ -185,19 +148,17 @@ int getMovement(int state) {
 			break;
 		
 		case wait:
-			movement_bit_val = 0x00;
 			break;
 		
 		case x_axis:
-			convert_to_digital();
-			x_val = ADC;	
+			game.x_val = stick_read();
 			
-			if(x_val > 900) {
-				movement_bit_val = 0x01; /* Right */
+			if(game.x_val > 900) {
+				bus_publish(BUS_MOVE, 0x01); /* Right */
 			}
 			
-			else if(x_val < 100) {
-				movement_bit_val = 0x02; /* Left */
+			else if(game.x_val < 100) {
+				bus_publish(BUS_MOVE, 0x02); /* Left */
 			}
 			
 			break;
@@ -210,24 +171,36 @@ int getMovement(int state) {
 	return state;
 } 
 
+/* The player takes a powerup in column col. powerupShooting hears of it on
+the bus and starts in the same tick */
+void powerup_pickup(unsigned char col) {
+	TELEMETRY_EVENT(TELEMETRY_POWERUP_PICKUP, col);
+	if(game.powerup_activated == 0x00) {
+		game.powerup_activated = 0x01;
+		bus_publish(BUS_POWERUP, col);
+	}
+}
+
 enum moveObject_States {mO_init, mO_wait, mO_right, mO_left};
 int moveObject(int state) {
+	unsigned char move;
+	
 	switch(state) {
 		case mO_init:
 			state = mO_wait;
 			break;
 			
 		case mO_wait:
-			if(movement_bit_val == 0x01) {
-				state = mO_right;
+			if(bus_take(BUS_SUB_MOVE, &move) == BUS_EMPTY) {
+				state = mO_wait;
 			}
 			
-			else if(movement_bit_val == 0x02) {
-				state = mO_left;
+			else if(move == 0x01) {
+				state = mO_right;
 			}
 			
 			else {
-				state = mO_wait;
+				state = mO_left;
 			}
 			
 			break;
@@ -253,62 +226,68 @@ int moveObject(int state) {
 			
 		case mO_right:
 			/* Decrease width in the array */
-			led_arr[height][width] = 0;
+			game.player_rows[game.height] = 0;
 			
-			if(width == 0) {
-				width = 7;
+			if(game.width == 0) {
+				game.width = BOARD_LAST_COL;
 			}
 			
 			else {
-				--width;
+				--game.width;
 			}
 			
-			if(led_arr[height][width] == 2) {
-				game_over = 0x01;
+			TELEMETRY_EVENT(TELEMETRY_MOVE, game.width);
+			
+			if(game.wall_rows[game.height] & BOARD_BIT(game.width)) {
+				game.game_over = 0x01;
 			}
 			
-			else if(led_arr[height][width] == 1) {
-				powerup_activated = 0x01;
-				led_arr[height][width] = 3;
+			else if(game.powerup_rows[game.height] & BOARD_BIT(game.width)) {
+				powerup_pickup(game.width);
+				game.powerup_rows[game.height] &= ~BOARD_BIT(game.width);
+				game.player_rows[game.height] = BOARD_BIT(game.width);
 			}
 			
 			else {
-				led_arr[height][width] = 3;
+				game.player_rows[game.height] = BOARD_BIT(game.width);
 			}
 			
 			/* Creates new seed for randomness for walls */
-			++seeder;
+			++game.seeder;
 			
 			break;
 			
 		case mO_left:
 			/* Increase width in the array */
 			/* Check boundary conditions */
-			led_arr[height][width] = 0;
+			game.player_rows[game.height] = 0;
 			
-			if(width == 7) {
-				width = 0;
+			if(game.width == BOARD_LAST_COL) {
+				game.width = 0;
 			}
 			
 			else {
-				++width;
+				++game.width;
 			}
 			
-			if(led_arr[height][width] == 2) {
-				game_over = 0x01;
+			TELEMETRY_EVENT(TELEMETRY_MOVE, game.width);
+			
+			if(game.wall_rows[game.height] & BOARD_BIT(game.width)) {
+				game.game_over = 0x01;
 			}
 			
-			else if(led_arr[height][width] == 1) {
-				powerup_activated = 0x01;
-				led_arr[height][width] = 3;
+			else if(game.powerup_rows[game.height] & BOARD_BIT(game.width)) {
+				powerup_pickup(game.width);
+				game.powerup_rows[game.height] &= ~BOARD_BIT(game.width);
+				game.player_rows[game.height] = BOARD_BIT(game.width);
 			}
 			
 			else {
-				led_arr[height][width] = 3;
+				game.player_rows[game.height] = BOARD_BIT(game.width);
 			}
 			
 			/* Creates new seed for randomness for walls */
-			++seeder;
+			++game.seeder;
 			
 			break;
 			
@@ -320,10 +299,9 @@ int moveObject(int state) {
 }
 
 enum moveWalls_States {mW_init, mW_wait, mW_generate, mW_move};
-int randomNum, powerup_randomNum, powerup_spawn;
-unsigned char counter = 7;
-unsigned pos_0, pos_1, pos_2, pos_3, pos_4, pos_5, pos_6, pos_7 = 0;
 int moveWalls(int state) {
+	board_row_t mask;
+	
 	switch(state) {
 		case mW_init:
 			state = mW_wait;
@@ -338,12 +316,13 @@ int moveWalls(int state) {
 			break;
 		
 		case mW_move:
-			if(counter == 0) {
-				score = score + 1;
+			if(game.counter == 0) {
+				game.score = game.score + 1;
+				TELEMETRY_EVENT(TELEMETRY_SCORE, game.score);
 				state = mW_generate;
 				/* Fixes the issue of having a powerup spawn immedietely after previous powerup
 				is finished */
-				powerup_randomNum = 0;
+				game.powerup_randomNum = 0;
 			}
 			
 			else {
@@ -367,12 +346,11 @@ int moveWalls(int state) {
 		/* Generates Random Walls */	
 		case mW_generate:
 			/* Reset move counter */
-			counter = 7;
+			game.counter = BOARD_TOP;
 			
-			/* New seeder & random number generated */
-			++seeder;
-			srand(seeder);
-			randomNum = rand() % 10 + 1;
+			/* The next wall and its powerup, made ahead in walls.h */
+			walls_take();
+			TELEMETRY_EVENT(TELEMETRY_WALL, game.wall);
 			
 			/* Disables LED walls that were left over from previous
 			wall iterations */
@@ -381,1402 +359,148 @@ int moveWalls(int state) {
 				. . . . . . . .
 				X X X X X O O O 
 			*/	
-			for(int e = 0; e < 8; ++e) {
-				if(led_arr[0][e] == 2 || led_arr[0][e] == 1) {
-					led_arr[0][e] = 0;
-				}	
-			}
-			
-			for(int q = 0; q < 8; ++q) {
-				led_arr[7][q] = 0;	
-			}
-			
-			pos_0 = pos_1 = pos_2 = pos_3 = pos_4 = pos_5 = pos_6 = pos_7 = 0;
-			
-			if(randomNum == 1) {
-				led_arr[7][0] = 2;
-				led_arr[7][1] = 2;
-				led_arr[7][2] = 2;
-				led_arr[7][3] = 2;
-				led_arr[7][4] = 2;
-				
-			}
+			game.wall_rows[0] = 0;
+			game.powerup_rows[0] = 0;
+			game.wall_rows[BOARD_TOP] = 0;
+			game.powerup_rows[BOARD_TOP] = 0;
+			game.pos = 0;
 			
-			if(randomNum == 2) {
-				led_arr[7][7] = 2;
-				led_arr[7][6] = 2;
-				led_arr[7][5] = 2;
-				led_arr[7][4] = 2;
-				led_arr[7][3] = 2;
-			}
+			game.wall_rows[BOARD_TOP] = game.wall;
 			
-			if(randomNum == 3) {
-				led_arr[7][0] = 2;
-				led_arr[7][1] = 2;
-				led_arr[7][2] = 2;
-				led_arr[7][5] = 2;
-				led_arr[7][6] = 2;
-				led_arr[7][7] = 2;
-				
+			/* Makes sure there is not a powerup already activated */
+			if(game.powerup_activated == 0x00) {
+				/* Display the powerup in its opening of the wall */
+				if(game.powerup_randomNum == 1 || game.powerup_randomNum == 5) {
+					game.powerup_rows[BOARD_TOP] = BOARD_BIT(game.powerup_spawn);
+					TELEMETRY_EVENT(TELEMETRY_POWERUP_SPAWN, game.powerup_spawn);
+				}
 			}
 			
-			if(randomNum == 4) {
-				led_arr[7][7] = 2;
-				led_arr[7][6] = 2;
-				led_arr[7][5] = 2;
-				led_arr[7][4] = 2;
-				led_arr[7][3] = 2;
-				led_arr[7][2] = 2;
-			}
+			shots_hit_row(BOARD_TOP);
 			
-			if(randomNum == 5) {
-				led_arr[7][0] = 2;
-				led_arr[7][1] = 2;
-				led_arr[7][2] = 2;
-				led_arr[7][3] = 2;
-				led_arr[7][4] = 2;
-				led_arr[7][5] = 2;
-			}
+			break;
 			
-			if(randomNum == 6) {
-				led_arr[7][0] = 2;
-				led_arr[7][1] = 2;
-				led_arr[7][3] = 2;
-				led_arr[7][4] = 2;
-				led_arr[7][6] = 2;
-				led_arr[7][7] = 2;
-			}
+		/* Moves the wall down a row */
+		case mW_move:
+			mask = game.wall;
 			
-			if(randomNum == 7) {
-				led_arr[7][1] = 2;
-				led_arr[7][2] = 2;
-				led_arr[7][3] = 2;
-				led_arr[7][4] = 2;
-				led_arr[7][5] = 2;
-				led_arr[7][6] = 2;
-			}
+			/* Columns already broken, e.g. by a shot, stay open */
+			game.pos |= mask & ~game.wall_rows[game.counter];
+			game.wall_rows[game.counter] &= ~mask;
 			
-			if(randomNum == 8) {
-				led_arr[7][0] = 2;
-				led_arr[7][1] = 2;
-				led_arr[7][2] = 2;
-				led_arr[7][4] = 2;
-				led_arr[7][5] = 2;
-				led_arr[7][6] = 2;
+			/* Powerup */
+			if(game.powerup_randomNum == 1 || game.powerup_randomNum == 5) {
+				game.powerup_rows[game.counter] &= ~BOARD_BIT(game.powerup_spawn);
 			}
 			
-			if(randomNum == 9) {
-				led_arr[7][1] = 2;
-				led_arr[7][2] = 2;
-				led_arr[7][3] = 2;
-				led_arr[7][5] = 2;
-				led_arr[7][6] = 2;
-				led_arr[7][7] = 2;
-			}
+			game.counter = game.counter - 1;
 			
-			if(randomNum == 10) {
-				led_arr[7][0] = 2;
-				led_arr[7][2] = 2;
-				led_arr[7][4] = 2;
-				led_arr[7][6] = 2;
+			/* The wall lands on the player */
+			if(mask & ~game.pos & game.player_rows[game.counter]) {
+				game.game_over = 0x01;
 			}
 			
-			/* Makes sure there is not a powerup already activated */
-			if(powerup_activated == 0x00) {
-				/* Generate powerup with a 20% 
-				chance everytime a wall is generated */
-				powerup_randomNum = rand() % 10 + 1;
+			else {
+				game.wall_rows[game.counter] = (game.wall_rows[game.counter] & ~mask) | (mask & ~game.pos);
+				game.powerup_rows[game.counter] &= ~mask;
 				
-				/* 1 is arbitrary */
-				if(powerup_randomNum == 1 || powerup_randomNum == 5) {
-					while(1) {
-						/* Tries to determine where the open spot is for
-						the power up */
+				/* Powerup */
+				if(game.powerup_activated == 0x00) {
+					if(game.powerup_randomNum == 1 || game.powerup_randomNum == 5) {
+						
+						/* If the powerup interacts with the player,
+						the player takes it */
+						if(game.player_rows[game.counter] & BOARD_BIT(game.powerup_spawn)) {
+							powerup_pickup(game.width);
+						}
 						
-						/* New seeder & random number generated */
-						++seeder;
-						srand(seeder);
-					
-						/* Generates random number n, 0 <= n <= 7 */
-						powerup_spawn = rand() % 8;
-						/* If there is an opening in the wall, display
-						the powerup in the opening */
-						if(led_arr[7][powerup_spawn] == 0) {
-							led_arr[7][powerup_spawn] = 1;
-							break;
+						/* Else, move the powerup down the grid */
+						else {
+							game.powerup_rows[game.counter] |= BOARD_BIT(game.powerup_spawn);
 						}
 					}
 				}
 			}
 			
-			shift();
+			shots_hit_row(game.counter);
 			
 			break;
-			
-		case mW_move:
-			if(randomNum == 1) {
-				
-				if(led_arr[counter][0] == 0) {
-					pos_0 = 1;
-				}
-				
-				if(led_arr[counter][1] == 0) {
-					pos_1 = 1;
-				}
-				
-				if(led_arr[counter][2] == 0) {
-					pos_2 = 1;
-				}
-				
-				if(led_arr[counter][3] == 0) {
-					pos_3 = 1;
-				}
-				
-				if(led_arr[counter][4] == 0) {
-					pos_4 = 1;
-				}
-				
-				
-				led_arr[counter][0] = 0;
-				led_arr[counter][1] = 0;
-				led_arr[counter][2] = 0;
-				led_arr[counter][3] = 0;
-				led_arr[counter][4] = 0;
-				
-				/* Powerup */
-				if(powerup_randomNum == 1 || powerup_randomNum == 5) {
-					led_arr[counter][powerup_spawn] = 0;
-				}
-				
-				counter = counter - 1;
-				
-				if((pos_0 == 0 && led_arr[counter][0] == 3) ||
-					(pos_1 == 0 && led_arr[counter][1] == 3) ||
-					(pos_2 == 0 && led_arr[counter][2] == 3) || 
-					(pos_3 == 0 && led_arr[counter][3] == 3) ||
-					(pos_4 == 0 && led_arr[counter][4] == 3)) {
-						game_over = 0x01;
-					}
-					
-				else {
-					if(pos_0 == 1) {
-						led_arr[counter][0] = 0;
-					}
-					
-					else {
-						led_arr[counter][0] = 2;
-					}
-					
-					if(pos_1 == 1) {
-						led_arr[counter][1] = 0;
-					}
-					
-					else {
-						led_arr[counter][1] = 2;
-					}
-					
-					if(pos_2 == 1) {
-						led_arr[counter][2] = 0;
-					}
-					
-					else {
-						led_arr[counter][2] = 2;
-					}
-					
-					if(pos_3 == 1) {
-						led_arr[counter][3] = 0;
-					}
-					
-					else {
-						led_arr[counter][3] = 2;
-					}
-					
-					if(pos_4 == 1) {
-						led_arr[counter][4] = 0;
-					}
-					
-					else {
-						led_arr[counter][4] = 2;
-					}
-					
-					led_arr[height][width] = 3;
-					
-					/* Powerup */
-					if(powerup_activated == 0x00) {
-						if(powerup_randomNum == 1 || powerup_randomNum == 5) {
-						
-							/* If the powerup interacts with the player,
-							activate global variable powerup_activated */
-							if(led_arr[counter][powerup_spawn] == 3) {
-								powerup_activated = 0x01;
-							}
-						
-							/* Else, move the powerup down the grid */
-							else {
-								led_arr[counter][powerup_spawn] = 1;
-							}
-						}
+	}
+	
+	return state;
+}
+
+/* POWERUPSHOOTING PT */
+
+/* While a powerup lasts, fires a volley from the player's column every
+SHOT_INTERVAL steps, SHOT_STEPS steps in all, and moves the shots up a
+row every step. A protothread (pt.h): the state is where it stopped */
+int powerupShooting(int state) {
+	unsigned char col;
+	
+	PT_BEGIN(state);
+	PT_YIELD();
+	
+	while(1) {
+		/* Woken by the bus when the player takes a powerup */
+		PT_AWAIT(bus_take(BUS_SUB_POWERUP, &col) != BUS_EMPTY);
+		game.powerup_remainingTime = SHOT_STEPS;
+		game.shot_cooldown = 0;
+		
+		while(1) {
+			/* A volley from the player's column, SHOT_SPREAD wide each side */
+			shots_advance();
+			if(game.powerup_remainingTime > 0) {
+				for(int c = game.width - SHOT_SPREAD; c <= game.width + SHOT_SPREAD; ++c) {
+					if(c >= 0 && c < BOARD_COLS) {
+						shots_fire(c);
 					}
 				}
-				
+				game.shot_cooldown = SHOT_INTERVAL - 1;
+				game.powerup_remainingTime = game.powerup_remainingTime - 1;
 			}
+			shots_hit_row(game.counter);
+			PT_YIELD();
 			
-			if(randomNum == 2) {
-				
-				if(led_arr[counter][7] == 0) {
-					pos_7 = 1;
-				}
-				
-				if(led_arr[counter][6] == 0) {
-					pos_6 = 1;
-				}
-				
-				if(led_arr[counter][5] == 0) {
-					pos_5 = 1;
-				}
-				
-				if(led_arr[counter][4] == 0) {
-					pos_4 = 1;
-				}
-				
-				if(led_arr[counter][3] == 0) {
-					pos_3 = 1;
-				}
-				
-				led_arr[counter][7] = 0;
-				led_arr[counter][6] = 0;
-				led_arr[counter][5] = 0;
-				led_arr[counter][4] = 0;
-				led_arr[counter][3] = 0;
-				
-				if(powerup_randomNum == 1 || powerup_randomNum == 5) {
-					led_arr[counter][powerup_spawn] = 0;
-				}
-				
-				counter = counter - 1;
-				
-				if((pos_7 == 0 && led_arr[counter][7] == 3)||
-					(pos_6 == 0 && led_arr[counter][6] == 3) || 
-					(pos_5 == 0 && led_arr[counter][5] == 3) ||
-					(pos_4 == 0 && led_arr[counter][4] == 3) ||
-					(pos_3 == 0 && led_arr[counter][3] == 3)) {
-						game_over = 0x01;
-					}
-					
-				else {
-					
-					if(pos_7 == 1) {
-						led_arr[counter][7] = 0;
-					}
-					
-					else {
-						led_arr[counter][7] = 2;
-					}
-					
-					if(pos_6 == 1) {
-						led_arr[counter][6] = 0;
-					}
-					
-					else {
-						led_arr[counter][6] = 2;
-					}
-					
-					if(pos_5 == 1) {
-						led_arr[counter][5] = 0;
-					}
-					
-					else {
-						led_arr[counter][5] = 2;
-					}
-					
-					if(pos_4 == 1) {
-						led_arr[counter][4] = 0;
-					}
-					
-					else {
-						led_arr[counter][4] = 2;
-					}
-					
-					if(pos_3 == 1) {
-						led_arr[counter][3] = 0;
-					}
-					
-					else {
-						led_arr[counter][3] = 2;
-					}
-					
-					led_arr[height][width] = 3;
-					
-					/* Powerup */
-					if(powerup_activated == 0x00) {
-						if(powerup_randomNum == 1 || powerup_randomNum == 5) {
-						
-							/* If the powerup interacts with the player,
-							activate global variable powerup_activated */
-							if(led_arr[counter][powerup_spawn] == 3) {
-								powerup_activated = 0x01;
-							}
-						
-							/* Else, move the powerup down the grid */
-							else {
-								led_arr[counter][powerup_spawn] = 1;
-							}
-						}
-					}
-				}
-				
+			if(game.powerup_remainingTime == 0) {
+				break;
 			}
 			
-			if(randomNum == 3) {
-				if(led_arr[counter][0] == 0) {
-					pos_0 = 1;
-				}
-				
-				if(led_arr[counter][1] == 0) {
-					pos_1 = 1;
-				}
-				
-				if(led_arr[counter][2] == 0) {
-					pos_2 = 1;
-				}
-				
-				if(led_arr[counter][5] == 0) {
-					pos_5 = 1;
-				}
-				
-				if(led_arr[counter][6] == 0) {
-					pos_6 = 1;
-				}
-				
-				if(led_arr[counter][7] == 0) {
-					pos_7 = 1;
-				}
-				
-				led_arr[counter][0] = 0;
-				led_arr[counter][1] = 0;
-				led_arr[counter][2] = 0;
-				led_arr[counter][5] = 0;
-				led_arr[counter][6] = 0;
-				led_arr[counter][7] = 0;
-				
-				if(powerup_randomNum == 1 || powerup_randomNum == 5) {
-					led_arr[counter][powerup_spawn] = 0;
-				}
-				
-				counter = counter - 1;
-				
-				if((pos_0 == 0 && led_arr[counter][0] == 3) ||
-					(pos_1 == 0 && led_arr[counter][1] == 3) ||
-					(pos_2 == 0 && led_arr[counter][2] == 3) ||
-					(pos_5 == 0 && led_arr[counter][5] == 3) ||
-					(pos_6 == 0 && led_arr[counter][6] == 3) ||
-					(pos_7 == 0 && led_arr[counter][7] == 3)) {
-						game_over = 0x01;
-					}
-				
-				else {
-					
-					if(pos_0 == 1) {
-						led_arr[counter][0] = 0;
-					}
-					
-					else {
-						led_arr[counter][0] = 2;
-					}
-					
-					if(pos_1 == 1) {
-						led_arr[counter][1] = 0;
-					}
-					
-					else {
-						led_arr[counter][1] = 2;
-					}
-					
-					if(pos_2 == 1) {
-						led_arr[counter][2] = 0;
-					}
-					
-					else {
-						led_arr[counter][2] = 2;
-					}
-					
-					if(pos_5 == 1) {
-						led_arr[counter][5] = 0;
-					}
-					
-					else {
-						led_arr[counter][5] = 2;
-					}
-					
-					if(pos_6 == 1) {
-						led_arr[counter][6] = 0;
-					}
-					
-					else {
-						led_arr[counter][6] = 2;
-					}
-					
-					if(pos_7 == 1) {
-						led_arr[counter][7] = 0;
-					}
-					
-					else {
-						led_arr[counter][7] = 2;
-					}
-					
-					led_arr[height][width] = 3;
-					
-					/* Powerup */
-					if(powerup_activated == 0x00) {
-						if(powerup_randomNum == 1 || powerup_randomNum == 5) {
-						
-							/* If the powerup interacts with the player,
-							activate global variable powerup_activated */
-							if(led_arr[counter][powerup_spawn] == 3) {
-								powerup_activated = 0x01;
-							}
-						
-							/* Else, move the powerup down the grid */
-							else {
-								led_arr[counter][powerup_spawn] = 1;
-							}
-						}
-					}
-				}
+			/* The shots fly on until the next volley */
+			while(game.shot_cooldown != 0 && game.powerup_remainingTime != 0) {
+				shots_advance();
+				shots_hit_row(game.counter);
+				game.shot_cooldown = game.shot_cooldown - 1;
+				game.powerup_remainingTime = game.powerup_remainingTime - 1;
+				PT_YIELD();
+			}
+		}
+		
+		game.powerup_activated = 0x00;
+		shots_clear();
+		TELEMETRY_EVENT(TELEMETRY_POWERUP_EXPIRE, 0);
+		PT_YIELD();
+	}
+	
+	PT_END();
+}
+
+enum playMusic_States {pM_wait, pM_play};
+int playMusic(int state) {
+	
+	switch(state) {
+		case pM_wait:
+			state = pM_play;
+		break;
+		
+		case pM_play:
+			state = pM_play;
+			if(game.i <= 16) {
+				++game.i;
 			}
 			
-			if(randomNum == 4) {
-				
-				if(led_arr[counter][7] == 0) {
-					pos_7 = 1;
-				}
-				
-				if(led_arr[counter][6] == 0) {
-					pos_6 = 1;
-				}
-				
-				if(led_arr[counter][5] == 0) {
-					pos_5 = 1;
-				}
-				
-				if(led_arr[counter][4] == 0) {
-					pos_4 = 1;
-				}
-				
-				if(led_arr[counter][3] == 0) {
-					pos_3 = 1;
-				}
-				
-				if(led_arr[counter][2] == 0) {
-					pos_2 = 1;
-				}
-				
-				led_arr[counter][7] = 0;
-				led_arr[counter][6] = 0;
-				led_arr[counter][5] = 0;
-				led_arr[counter][4] = 0;
-				led_arr[counter][3] = 0;
-				led_arr[counter][2] = 0;
-				
-				if(powerup_randomNum == 1 || powerup_randomNum == 5) {
-					led_arr[counter][powerup_spawn] = 0;
-				}
-				
-				counter = counter - 1;
-				
-				if((pos_7 == 0 && led_arr[counter][7] == 3) ||
-					(pos_6 == 0 && led_arr[counter][6] == 3) ||
-					(pos_5 == 0 && led_arr[counter][5] == 3) ||
-					(pos_4 == 0 && led_arr[counter][4] == 3) ||
-					(pos_3 == 0 && led_arr[counter][3] == 3) ||
-					(pos_2 == 0 && led_arr[counter][2] == 3)) {
-						game_over = 0x01;
-					}
-					
-				else {
-					
-					if(pos_7 == 1) {
-						led_arr[counter][7] = 0;
-					}
-					
-					else {
-						led_arr[counter][7] = 2;
-					}
-					
-					if(pos_6 == 1) {
-						led_arr[counter][6] = 0;
-					}
-					
-					else {
-						led_arr[counter][6] = 2;
-					}
-					
-					if(pos_5 == 1) {
-						led_arr[counter][5] = 0;
-					}
-					
-					else {
-						led_arr[counter][5] = 2;
-					}
-					
-					if(pos_4 == 1) {
-						led_arr[counter][4] = 0;
-					}
-					
-					else {
-						led_arr[counter][4] = 2;
-					}
-					
-					if(pos_3 == 1) {
-						led_arr[counter][3] = 0;
-					}
-					
-					else {
-						led_arr[counter][3] = 2;
-					}
-					
-					if(pos_2 == 1) {
-						led_arr[counter][2] = 0;
-					}
-					
-					else {
-						led_arr[counter][2] = 2;
-					}
-					
-					led_arr[height][width] = 3;
-					
-					/* Powerup */
-					if(powerup_activated == 0x00) {
-						if(powerup_randomNum == 1 || powerup_randomNum == 5) {
-						
-							/* If the powerup interacts with the player,
-							activate global variable powerup_activated */
-							if(led_arr[counter][powerup_spawn] == 3) {
-								powerup_activated = 0x01;
-							}
-						
-							/* Else, move the powerup down the grid */
-							else {
-								led_arr[counter][powerup_spawn] = 1;
-							}
-						}
-					}
-				}
-			}
-			
-			if(randomNum == 5) {
-				
-				if(led_arr[counter][0] == 0) {
-					pos_0 = 1;
-				}
-				
-				if(led_arr[counter][1] == 0) {
-					pos_1 = 1;
-				}
-				
-				if(led_arr[counter][2] == 0) {
-					pos_2 = 1;
-				}
-				
-				if(led_arr[counter][3] == 0) {
-					pos_3 = 1;
-				}
-				
-				if(led_arr[counter][4] == 0) {
-					pos_4 = 1;
-				}
-				
-				if(led_arr[counter][5] == 0) {
-					pos_5 = 1;
-				}
-				
-				led_arr[counter][0] = 0;
-				led_arr[counter][1] = 0;
-				led_arr[counter][2] = 0;
-				led_arr[counter][3] = 0;
-				led_arr[counter][4] = 0;
-				led_arr[counter][5] = 0;
-				
-				if(powerup_randomNum == 1 || powerup_randomNum == 5) {
-					led_arr[counter][powerup_spawn] = 0;
-				}
-				
-				counter = counter - 1;
-				
-				if((pos_0 == 0 && led_arr[counter][0] == 3) ||
-					(pos_1 == 0 && led_arr[counter][1] == 3) ||
-					(pos_2 == 0 && led_arr[counter][2] == 3) ||
-					(pos_3 == 0 && led_arr[counter][3] == 3) ||
-					(pos_4 == 0 && led_arr[counter][4] == 3) ||
-					(pos_5 == 0 && led_arr[counter][5] == 3)) {
-						game_over = 0x01;
-					}	
-					
-				else {
-					
-					if(pos_0 == 1) {
-						led_arr[counter][0] = 0;
-					}
-					
-					else {
-						led_arr[counter][0] = 2;
-					}
-					
-					if(pos_1 == 1) {
-						led_arr[counter][1] = 0;
-					}
-					
-					else {
-						led_arr[counter][1] = 2;
-					}
-					
-					if(pos_2 == 1) {
-						led_arr[counter][2] = 0;
-					}
-					
-					else {
-						led_arr[counter][2] = 2;
-					}
-					
-					if(pos_3 == 1) {
-						led_arr[counter][3] = 0;
-					}
-					
-					else {
-						led_arr[counter][3] = 2;
-					}
-					
-					if(pos_4 == 1) {
-						led_arr[counter][4] = 0;
-					}
-					
-					else {
-						led_arr[counter][4] = 2;
-					}
-					
-					if(pos_5 == 1) {
-						led_arr[counter][5] = 0;
-					}
-					
-					else {
-						led_arr[counter][5] = 2;
-					}
-					
-					led_arr[height][width] = 3;
-				
-					/* Powerup */
-					if(powerup_activated == 0x00) {
-						if(powerup_randomNum == 1 || powerup_randomNum == 5) {
-						
-							/* If the powerup interacts with the player,
-							activate global variable powerup_activated */
-							if(led_arr[counter][powerup_spawn] == 3) {
-								powerup_activated = 0x01;
-							}
-						
-							/* Else, move the powerup down the grid */
-							else {
-								led_arr[counter][powerup_spawn] = 1;
-							}
-						}
-					}
-				}
-			}
-			
-			if(randomNum == 6) {
-				
-				if(led_arr[counter][0] == 0) {
-					pos_0 = 1;
-				}
-				
-				if(led_arr[counter][1] == 0) {
-					pos_1 = 1;
-				}
-				
-				if(led_arr[counter][3] == 0) {
-					pos_3 = 1;
-				}
-				
-				if(led_arr[counter][4] == 0) {
-					pos_4 = 1;
-				}
-				
-				if(led_arr[counter][6] == 0) {
-					pos_6 = 1;
-				}
-				
-				if(led_arr[counter][7] == 0) {
-					pos_7 = 1;
-				}
-				
-				led_arr[counter][0] = 0;
-				led_arr[counter][1] = 0;
-				led_arr[counter][3] = 0;
-				led_arr[counter][4] = 0;
-				led_arr[counter][6] = 0;
-				led_arr[counter][7] = 0;
-				
-				if(powerup_randomNum == 1 || powerup_randomNum == 5) {
-					led_arr[counter][powerup_spawn] = 0;
-				}
-				
-				counter = counter - 1;
-				
-				if((pos_0 == 0 && led_arr[counter][0] == 3) ||
-					(pos_1 == 0 && led_arr[counter][1] == 3) ||
-					(pos_3 == 0 && led_arr[counter][3] == 3) ||
-					(pos_4 == 0 && led_arr[counter][4] == 3) ||
-					(pos_6 == 0 && led_arr[counter][6] == 3) ||
-					(pos_7 == 0 && led_arr[counter][7] == 3)) {
-						game_over = 0x01;
-					}
-					
-				else {
-					
-					if(pos_0 == 1) {
-						led_arr[counter][0] = 0;
-					}
-					
-					else {
-						led_arr[counter][0] = 2;
-					}
-					
-					if(pos_1 == 1) {
-						led_arr[counter][1] = 0;
-					}
-					
-					else {
-						led_arr[counter][1] = 2;
-					}
-					
-					if(pos_3 == 1) {
-						led_arr[counter][3] = 0;
-					}
-					
-					else {
-						led_arr[counter][3] = 2;
-					}
-					
-					if(pos_4 == 1) {
-						led_arr[counter][4] = 0;
-					}
-					
-					else {
-						led_arr[counter][4] = 2;
-					}
-					
-					if(pos_6 == 1) {
-						led_arr[counter][6] = 0;
-					}
-					
-					else {
-						led_arr[counter][6] = 2;
-					}
-					
-					if(pos_7 == 1) {
-						led_arr[counter][7] = 0;
-					}
-					
-					else {
-						led_arr[counter][7] = 2;
-					}
-					
-					led_arr[height][width] = 3;
-					
-					/* Powerup */
-					if(powerup_activated == 0x00) {
-						if(powerup_randomNum == 1 || powerup_randomNum == 5) {
-						
-							/* If the powerup interacts with the player,
-							activate global variable powerup_activated */
-							if(led_arr[counter][powerup_spawn] == 3) {
-								powerup_activated = 0x01;
-							}
-						
-							/* Else, move the powerup down the grid */
-							else {
-								led_arr[counter][powerup_spawn] = 1;
-							}
-						}
-					}
-				}
-			}
-			
-			if(randomNum == 7) {
-				if(led_arr[counter][1] == 0) {
-					pos_1 = 1;
-				}
-				
-				if(led_arr[counter][2] == 0) {
-					pos_2 = 1;
-				}
-				
-				if(led_arr[counter][3] == 0) {
-					pos_3 = 1;
-				}
-				
-				if(led_arr[counter][4] == 0) {
-					pos_4 = 1;
-				}
-				
-				if(led_arr[counter][5] == 0) {
-					pos_5 = 1;
-				}
-				
-				if(led_arr[counter][6] == 0) {
-					pos_6 = 1;
-				}
-				
-				led_arr[counter][1] = 0;
-				led_arr[counter][2] = 0;
-				led_arr[counter][3] = 0;
-				led_arr[counter][4] = 0;
-				led_arr[counter][5] = 0;
-				led_arr[counter][6] = 0;
-				
-				if(powerup_randomNum == 1 || powerup_randomNum == 5) {
-					led_arr[counter][powerup_spawn] = 0;
-				}
-				
-				counter = counter - 1;
-				
-				if((pos_1 == 0 && led_arr[counter][1] == 3) ||
-					(pos_2 == 0 && led_arr[counter][2] == 3) ||
-					(pos_3 == 0 && led_arr[counter][3] == 3) ||
-					(pos_4 == 0 && led_arr[counter][4] == 3) ||
-					(pos_5 == 0 && led_arr[counter][5] == 3) ||
-					(pos_6 == 0 && led_arr[counter][6] == 3)) {
-						game_over = 0x01;
-					}
-					
-				else {	
-					
-					if(pos_1 == 1) {
-						led_arr[counter][1] = 0;
-					}
-					
-					else {
-						led_arr[counter][1] = 2;
-					}
-					
-					if(pos_2 == 1) {
-						led_arr[counter][2] = 0;
-					}
-					
-					else {
-						led_arr[counter][2] = 2;
-					}
-					
-					if(pos_3 == 1) {
-						led_arr[counter][3] = 0;
-					}
-					
-					else {
-						led_arr[counter][3] = 2;
-					}
-					
-					if(pos_4 == 1) {
-						led_arr[counter][4] = 0;
-					}
-					
-					else {
-						led_arr[counter][4] = 2;
-					}
-					
-					if(pos_5 == 1) {
-						led_arr[counter][5] = 0;
-					}
-					
-					else {
-						led_arr[counter][5] = 2;
-					}
-					
-					if(pos_6 == 1) {
-						led_arr[counter][6] = 0;
-					}
-					
-					else {
-						led_arr[counter][6] = 2;
-					}
-					
-					led_arr[height][width] = 3;
-					
-					/* Powerup */
-					if(powerup_activated == 0x00) {
-						if(powerup_randomNum == 1 || powerup_randomNum == 5) {
-						
-							/* If the powerup interacts with the player,
-							activate global variable powerup_activated */
-							if(led_arr[counter][powerup_spawn] == 3) {
-								powerup_activated = 0x01;
-							}
-						
-							/* Else, move the powerup down the grid */
-							else {
-								led_arr[counter][powerup_spawn] = 1;
-							}
-						}
-					}
-				}
-			}
-			
-			if(randomNum == 8) {
-				if(led_arr[counter][0] == 0) {
-					pos_0 = 1;
-				}
-				
-				if(led_arr[counter][1] == 0) {
-					pos_1 = 1;
-				}
-				
-				if(led_arr[counter][2] == 0) {
-					pos_2 = 1;
-				}
-				
-				if(led_arr[counter][4] == 0) {
-					pos_4 = 1;
-				}
-				
-				if(led_arr[counter][5] == 0) {
-					pos_5 = 1;
-				}
-				
-				if(led_arr[counter][6] == 0) {
-					pos_6 = 1;
-				}
-				
-				led_arr[counter][0] = 0;
-				led_arr[counter][1] = 0;
-				led_arr[counter][2] = 0;
-				led_arr[counter][4] = 0;
-				led_arr[counter][5] = 0;
-				led_arr[counter][6] = 0;
-				
-				if(powerup_randomNum == 1 || powerup_randomNum == 5) {
-					led_arr[counter][powerup_spawn] = 0;
-				}
-				
-				counter = counter - 1;
-				
-				if((pos_0 == 0 && led_arr[counter][0] == 3) ||
-					(pos_1 == 0 && led_arr[counter][1] == 3) ||
-					(pos_2 == 0 && led_arr[counter][2] == 3) ||
-					(pos_4 == 0 && led_arr[counter][4] == 3) ||
-					(pos_5 == 0 && led_arr[counter][5] == 3) ||
-					(pos_6 == 0 && led_arr[counter][6] == 3)) {
-						game_over = 0x01;
-					}
-				
-				else {
-					
-					if(pos_0 == 1) {
-						led_arr[counter][0] = 0;
-					}
-					
-					else {
-						led_arr[counter][0] = 2;
-					}
-					
-					if(pos_1 == 1) {
-						led_arr[counter][1] = 0;
-					}
-					
-					else {
-						led_arr[counter][1] = 2;
-					}
-					
-					if(pos_2 == 1) {
-						led_arr[counter][2] = 0;
-					}
-					
-					else {
-						led_arr[counter][2] = 2;
-					}
-					
-					if(pos_4 == 1) {
-						led_arr[counter][4] = 0;
-					}
-					
-					else {
-						led_arr[counter][4] = 2;
-					}
-					
-					if(pos_5 == 1) {
-						led_arr[counter][5] = 0;
-					}
-					
-					else {
-						led_arr[counter][5] = 2;
-					}
-					
-					if(pos_6 == 1) {
-						led_arr[counter][6] = 0;
-					}
-					
-					else {
-						led_arr[counter][6] = 2;
-					}
-					
-					led_arr[height][width] = 3;
-					
-					/* Powerup */
-					if(powerup_activated == 0x00) {
-						if(powerup_randomNum == 1 || powerup_randomNum == 5) {
-						
-							/* If the powerup interacts with the player,
-							activate global variable powerup_activated */
-							if(led_arr[counter][powerup_spawn] == 3) {
-								powerup_activated = 0x01;
-							}
-						
-							/* Else, move the powerup down the grid */
-							else {
-								led_arr[counter][powerup_spawn] = 1;
-							}
-						}
-					}
-				}
-			}
-			
-			if(randomNum == 9) {
-				
-				if(led_arr[counter][1] == 0) {
-					pos_1 = 1;
-				}
-				
-				if(led_arr[counter][2] == 0) {
-					pos_2 = 1;
-				}
-				
-				if(led_arr[counter][3] == 0) {
-					pos_3 = 1;
-				}
-				
-				if(led_arr[counter][5] == 0) {
-					pos_5 = 1;
-				}
-				
-				if(led_arr[counter][6] == 0) {
-					pos_6 = 1;
-				}
-				
-				if(led_arr[counter][7] == 0) {
-					pos_7 = 1;
-				}
-				
-				led_arr[counter][1] = 0;
-				led_arr[counter][2] = 0;
-				led_arr[counter][3] = 0;
-				led_arr[counter][5] = 0;
-				led_arr[counter][6] = 0;
-				led_arr[counter][7] = 0;
-				
-				if(powerup_randomNum == 1 || powerup_randomNum == 5) {
-					led_arr[counter][powerup_spawn] = 0;
-				}
-				
-				counter = counter - 1;
-				
-				if((pos_1 == 0 && led_arr[counter][1] == 3) ||
-					(pos_2 == 0 && led_arr[counter][2] == 3) ||
-					(pos_3 == 0 && led_arr[counter][3] == 3) ||
-					(pos_5 == 0 && led_arr[counter][5] == 3) ||
-					(pos_6 == 0 && led_arr[counter][6] == 3) ||
-					(pos_7 == 0 && led_arr[counter][7] == 3)) {
-						game_over = 0x01;
-					}
-					
-				else {
-					
-					if(pos_1 == 1) {
-						led_arr[counter][1] = 0;
-					}
-					
-					else {
-						led_arr[counter][1] = 2;
-					}
-					
-					if(pos_2 == 1) {
-						led_arr[counter][2] = 0;
-					}
-					
-					else {
-						led_arr[counter][2] = 2;
-					}
-					
-					if(pos_3 == 1) {
-						led_arr[counter][3] = 0;
-					}
-					
-					else {
-						led_arr[counter][3] = 2;
-					}
-					
-					if(pos_5 == 1) {
-						led_arr[counter][5] = 0;
-					}
-					
-					else {
-						led_arr[counter][5] = 2;
-					}
-					
-					if(pos_6 == 1) {
-						led_arr[counter][6] = 0;
-					}
-					
-					else {
-						led_arr[counter][6] = 2;
-					}
-					
-					if(pos_7 == 1) {
-						led_arr[counter][7] = 0;
-					}
-					
-					else {
-						led_arr[counter][7] = 2;
-					}
-					
-					led_arr[height][width] = 3;
-					
-					/* Powerup */
-					if(powerup_activated == 0x00) {
-						if(powerup_randomNum == 1 || powerup_randomNum == 5) {
-						
-							/* If the powerup interacts with the player,
-							activate global variable powerup_activated */
-							if(led_arr[counter][powerup_spawn] == 3) {
-								powerup_activated = 0x01;
-							}
-						
-							/* Else, move the powerup down the grid */
-							else {
-								led_arr[counter][powerup_spawn] = 1;
-							}
-						}
-					}
-				}
-			}
-			
-			if(randomNum == 10) {
-				if(led_arr[counter][0] == 0) {
-					pos_0 = 1;
-				}
-				
-				if(led_arr[counter][2] == 0) {
-					pos_2 = 1;
-				}
-				
-				if(led_arr[counter][4] == 0) {
-					pos_4 = 1;
-				}
-				
-				if(led_arr[counter][6] == 0) {
-					pos_6 = 1;
-				}
-				
-				if(powerup_randomNum == 1 || powerup_randomNum == 5) {
-					led_arr[counter][powerup_spawn] = 0;
-				}
-				
-				led_arr[counter][0] = 0;
-				led_arr[counter][2] = 0;
-				led_arr[counter][4] = 0;
-				led_arr[counter][6] = 0;
-				
-				counter = counter - 1;
-				
-				if((pos_0 == 0 && led_arr[counter][0] == 3) ||
-					(pos_2 == 0 && led_arr[counter][2] == 3) ||
-					(pos_4 == 0 && led_arr[counter][4] == 3) ||
-					(pos_6 == 0 && led_arr[counter][6] == 3)) {
-						game_over = 0x01;
-					}
-				
-				else {
-					
-					if(pos_0 == 1) {
-						led_arr[counter][0] = 0;
-					}
-					
-					else {
-						led_arr[counter][0] = 2;
-					}
-					
-					if(pos_2 == 1) {
-						led_arr[counter][2] = 0;
-					}
-					
-					else {
-						led_arr[counter][2] = 2;
-					}
-					
-					if(pos_4 == 1) {
-						led_arr[counter][4] = 0;
-					}
-					
-					else {
-						led_arr[counter][4] = 2;
-					}
-					
-					if(pos_6 == 1) {
-						led_arr[counter][6] = 0;
-					}
-					
-					else {
-						led_arr[counter][6] = 2;
-					}
-					
-					led_arr[height][width] = 3;
-					
-					/* Powerup */
-					if(powerup_activated == 0x00) {
-						if(powerup_randomNum == 1 || powerup_randomNum == 5) {
-						
-							/* If the powerup interacts with the player,
-							activate global variable powerup_activated */
-							if(led_arr[counter][powerup_spawn] == 3) {
-								powerup_activated = 0x01;
-							}
-						
-							/* Else, move the powerup down the grid */
-							else {
-								led_arr[counter][powerup_spawn] = 1;
-							}
-						}
-					}
-				}
-			}
-			
-			shift();
-			
-			break;
-	}
-	
-	return state;
-}
-
-enum powerupShooting_States {pS_init, pS_wait, pS_generate, pS_shoot};
-unsigned char powerup_remainingTime = 0x00;
-unsigned char powerup_heightCounter = 0x01;
-unsigned char temp_width;
-int powerupShooting(int state) {
-	switch(state) {
-		case pS_init:
-			state = pS_wait;
-			break;
-		
-		case pS_wait:
-			if(powerup_activated == 0x01) {
-				state = pS_generate;
-				/*powerup_remainingTime = 0*/
-				powerup_remainingTime = 96;
-			}
-			
-			else {
-				state = pS_wait;
-			}
-			
-			break;
-			
-		case pS_generate:
-			/* if(powerup_remainingTime < 100 */
-			if(powerup_remainingTime > 0) {
-				state = pS_shoot;
-			}
-			
-			/* if(powerup_remainingTime >= 100) */
-			if(powerup_remainingTime == 0) {
-				state = pS_wait;
-				powerup_activated = 0x00;
-			}
-			
-			break;
-		
-		case pS_shoot:
-			/* if(powerup_heightCounter == 7 && powerup_remainingTime >= 100) */
-			if(powerup_heightCounter == 7 || powerup_remainingTime == 0) {
-				state = pS_generate;
-			}
-			
-			else {
-				state = pS_shoot;
-			}
-			
-			break;
-			
-		default:
-			break;
-	}
-	
-	switch(state) {
-		case pS_init:
-			break;
-			
-		case pS_wait:
-			break;
-			
-		case pS_generate:
-			temp_width = width;
-			for(int i = 0; i < 8; ++i) {
-				if(led_arr[7][i] == 4) {
-					led_arr[7][i] = 0;
-				}
-			}
-			
-			if(powerup_remainingTime > 0) {	
-				powerup_heightCounter = 1;
-				if(led_arr[powerup_heightCounter][temp_width] == 2) {
-					led_arr[powerup_heightCounter][temp_width] = 0;
-
-				}
-				
-				else {
-					led_arr[powerup_heightCounter][temp_width] = 4;
-				}
-			}
-			shift();
-			
-			break;
-			
-		case pS_shoot:
-			led_arr[powerup_heightCounter][temp_width] = 0;
-			powerup_heightCounter = powerup_heightCounter + 1;
-			if(led_arr[powerup_heightCounter][temp_width] == 2) {
-				led_arr[powerup_heightCounter][temp_width] = 0;
-			}
-			else {
-				led_arr[powerup_heightCounter][temp_width] = 4;
-			}
-			/* powerup_remainingTime = powerup_remainingTime + 1; */
-			powerup_remainingTime = powerup_remainingTime - 1;
-			shift();
-			break;
-			
-		default:
-			break;
-	}
-	
-	
-	return state;
-}
-
-enum playMusic_States {pM_wait, pM_play};
-unsigned char i = 0;
-int playMusic(int state) {
-	
-	switch(state) {
-		case pM_wait:
-			state = pM_play;
-		break;
-		
-		case pM_play:
-			state = pM_play;
-			if(i <= 16) {
-				++i;
-			}
-			
-			if(i > 16) {
-				i = 0;
+			if(game.i > 16) {
+				game.i = 0;
 			}
 			
 			break;
@@ -1788,11 +512,11 @@ int playMusic(int state) {
 	switch(state) {
 		case pM_wait:
 			set_PWM(0);
-			i = 0;
+			game.i = 0;
 			break;
 			
 		case pM_play:
-			set_PWM(frqs[i]);
+			set_PWM(frqs[game.i]);
 			break;
 			
 		default:
@@ -1872,6 +596,80 @@ void set_frequencies() {
 	frqs[57] = 261.63; // C
 }
 
+/* Power-on state, and what every restart goes back to */
+const GameState game_init PROGMEM = {
+	.player_rows = { [0] = BOARD_BIT(BOARD_START_COL) },
+	.height = 0,
+	.width = BOARD_START_COL,
+	.counter = BOARD_TOP,
+	.level = LEVEL,
+	.level_pos = LEVEL_POS(LEVEL),
+	
+	// elapsedTime starts at the period so every task ticks when it turns on
+	.tasks = {
+		{ .state = init, .period = 45, .elapsedTime = 45, .TickFct = &getMovement },
+		{ .state = mO_init, .period = 45, .elapsedTime = 45, .TickFct = &moveObject },
+		{ .state = mW_init, .period = 200, .elapsedTime = 200, .TickFct = &moveWalls },
+		{ .state = PT_START, .period = 75, .elapsedTime = 75, .TickFct = &powerupShooting },
+		{ .state = pM_wait, .period = 250, .elapsedTime = 250, .TickFct = &playMusic },
+	},
+};
+
+void game_reset(void) {
+	memcpy_P(&game, &game_init, sizeof(game));
+}
+
+void game_snapshot(GameState* out) {
+	memcpy(out, &game, sizeof(game));
+}
+
+void game_restore(const GameState* in) {
+	memcpy(&game, in, sizeof(game));
+}
+
+/* Restart block of main(), run when the button is pressed */
+void restart_game() {
+	TELEMETRY_EVENT(TELEMETRY_RESTART, 0);
+	game_reset();
+	REWIND_CLEAR();
+	B2 = 0x01;
+	PWM_on();
+}
+
+/* End screens: the face for END_FACE_MS, then the score scrolling through in
+   green, a column every END_SCROLL_MS, and again. The end screen loops do not
+   wait for the timer, so they count its ticks in TimerTicks. */
+#define END_FACE_MS		1500
+#define END_SCROLL_MS	100
+
+/* One ms of an end screen, drawing only when the picture changes */
+void end_screen(const unsigned char* face) {
+	unsigned short strip[SPRITE_FONT_ROWS];
+	
+	if(game.screen_ms == 0) {
+		if(game.screen_step == 0) {
+			memset(game.powerup_rows, 0, sizeof(game.powerup_rows));
+			sprite_draw(game.wall_rows, face, (BOARD_COLS - 8) / 2, 0);
+		}
+		
+		else {
+			if(game.screen_step == 1) {
+				memset(game.wall_rows, 0, sizeof(game.wall_rows));
+			}
+			unsigned char width = sprite_text(strip, game.score);
+			sprite_draw_text(game.powerup_rows, strip, width, game.screen_step,
+			                 (BOARD_ROWS - SPRITE_FONT_ROWS) / 2);
+		}
+	}
+	
+	if(++game.screen_ms == (game.screen_step ? END_SCROLL_MS : END_FACE_MS)) {
+		game.screen_ms = 0;
+		if(++game.screen_step == sprite_text(strip, game.score) + BOARD_COLS) {
+			game.screen_step = 0;
+		}
+	}
+}
+
 int main(void)
 {
 	/* (DDR) F = output; 0 = input */
@@ -1884,45 +682,12 @@ int main(void)
 	DDRC = 0xFF; PORTC = 0x00;
 	DDRD = 0xFF; PORTD = 0x00;
 	
-	unsigned long int getMovement_period = 45;
-	unsigned long int moveObject_period = 45;
-	unsigned long int moveWalls_period = 200;
-	unsigned long int powerupShooting_period = 75;
-	unsigned long int playMusic_period = 250;
-	
 	//calculate GCD
 	unsigned long int GCD = 1;
 	
-	//declare tasks and task array
-	static task task1, task2, task3, task4, task5;
-	task *tasks[] = {&task1, &task2, &task3, &task4, &task5};
-	const unsigned short numTasks = 5;
-	 
-	task1.state = init; //initial state of task 1
-	task1.period = getMovement_period;//task 1 period
-	task1.elapsedTime = getMovement_period;//set to period so it ticks when it turns on
-	task1.TickFct = &getMovement;
-	
-	task2.state = mO_init;
-	task2.period = moveObject_period;
-	task2.elapsedTime = moveObject_period;
-	task2.TickFct = &moveObject;
-	
-	task3.state = mW_init;
-	task3.period = moveWalls_period;
-	task3.elapsedTime = moveWalls_period;
-	task3.TickFct = &moveWalls;
-	
-	task4.state = pS_init;
-	task4.period = powerupShooting_period;
-	task4.elapsedTime = powerupShooting_period;
-	task4.TickFct = &powerupShooting;
+	/* Board, tasks and everything else from the power-on image */
+	game_reset();
 	
-	task5.state = pM_wait;
-	task5.period = playMusic_period;
-	task5.elapsedTime = playMusic_period;
-	task5.TickFct = &playMusic;
-		
 	/* Initialize Timer */
 	TimerSet(1);
 	TimerOn();
@@ -1930,201 +695,92 @@ int main(void)
 	/* Initialize ADC */
 	InitADC();
 	
+	/* Initialize telemetry, see telemetry.h */
+	TELEMETRY_INIT();
+	
+	/* Stats of earlier games from EEPROM, see highscore.h */
+	highscore_init();
+	
 	/* Intialize Random Seed */
-	srand(seeder);
+	srand(game.seeder);
 	
 	/* Set music */
 	set_frequencies();
 	PWM_on();
 	
-	/* Initialize height and width for starting position*/
-	height = 0;
-	width = 3;
-	
-	/* Fill led_arr with 0's */
-	for(int i = 0; i < 8; i++) {
-		for(int j = 0; j < 8; j++) {
-			led_arr[i][j] = 0;
-		}
-	}
-	
-	/* Set starting position based on initial height and width */
-	led_arr[height][width] = 3;
-
 	while (1) {
-		shift();
-		
 		B2 = ~PINB & 0x02;
 		if(B2 == 2) {
-			
-			/* Fill led_arr with 0's */
-			for(int i = 0; i < 8; i++) {
-				for(int j = 0; j < 8; j++) {
-					led_arr[i][j] = 0;
-				}
-			}
-			
-			game_over = 0x00;
-			score = 0;
-			
-			height = 0;
-			width = 3;
-			
-			led_arr[height][width] = 3;
-			
-			task1.state = init;
-			task1.period = getMovement_period;
-			task1.elapsedTime = getMovement_period;
-			
-			task2.state = mO_init;
-			task2.period = moveObject_period;
-			task2.elapsedTime = moveObject_period;
-			
-			task3.state = mW_init;
-			task3.period = moveWalls_period;
-			task3.elapsedTime = moveWalls_period;
-			
-			task4.state = pS_init;
-			task4.period = powerupShooting_period;
-			task4.elapsedTime = powerupShooting_period;
-			
-			task5.state = pM_wait;
-			task5.period = playMusic_period;
-			task5.elapsedTime = playMusic_period;
-			
-			GND = 0x01;
-			B2 = 0x01;
-			PWM_on();
-			i = 0;
-			row = 0;
-			seeder = 0;
-			powerup_activated = 0x00;
-			powerup_remainingTime = 0x00;
-			powerup_heightCounter = 0x01;
-			counter = 7;
-			pos_0 = pos_1 = pos_2 = pos_3 = pos_4 = pos_5 = pos_6 = pos_7 = 0;
-			shift();
+			restart_game();
 		}
 		
-		if(game_over == 0x00 && score < 60 && B2 != 2) {
-			for(int i = 0; i < numTasks; ++i) {
-				//check if task is ready to tick
-				if(tasks[i]->elapsedTime == tasks[i]->period) {
+		if(game.game_over == 0x00 && game.score < 60 && B2 != 2) {
+			for(int i = 0; i < GAME_NUM_TASKS; ++i) {
+				task* t = &game.tasks[i];
+				//check if task is ready to tick; one woken by the bus
+				//(bus.h) can be a tick past its period
+				if(t->elapsedTime >= t->period) {
 					//call the tick fct & set the next state
-					tasks[i]->state = tasks[i]->TickFct(tasks[i]->state);
+					TELEMETRY_EVENT(TELEMETRY_TASK_START + i, 0);
+					t->state = t->TickFct(t->state);
+					TELEMETRY_EVENT(TELEMETRY_TASK_END + i, 0);
 					//reset elapsed time to 0
-					tasks[i]->elapsedTime = 0;
-					if(game_over == 0x01) {
+					t->elapsedTime = 0;
+					if(game.game_over == 0x01) {
 						break;
 					}
 				
 					/* Score */
-					PORTA = (score << 2);
+					PORTA = (game.score << 2);
 				
-					if(score == 20) {
-						task3.period = 150;
+					/* Speeds up, unless a level sets the speed */
+					if(game.score == 20 && game.level == 0) {
+						game.tasks[2].period = 150;
 					}
 				
-					else if(score == 40) {
-						task3.period = 100;
+					else if(game.score == 40 && game.level == 0) {
+						game.tasks[2].period = 100;
 					}
 				
 					/* Seeds new random time */
-					srand(seeder);
+					srand(game.seeder);
 				}
 				//increment elapsed time for the task by the master clock period
-				tasks[i]->elapsedTime += GCD;
+				t->elapsedTime += GCD;
 			}
+			
+			/* History for the game over screen, see rewind.h */
+			REWIND_TICK();
 		}
 			
 		
-		else if(score >= 60) {
-			/* Fill led_arr with 0's */
-			for(int i = 0; i < 8; i++) {
-				for(int j = 0; j < 8; j++) {
-					led_arr[i][j] = 0;
-				}
-			}
-			
+		else if(game.score >= 60) {
+			TELEMETRY_END_SCREEN_ON();
+			TELEMETRY_EVENT(TELEMETRY_WIN, game.score);
+			highscore_game_end(game.score, 1);
+			
+			/* Clear the board */
+			memset(game.wall_rows, 0, sizeof(game.wall_rows));
+			memset(game.powerup_rows, 0, sizeof(game.powerup_rows));
+			memset(game.player_rows, 0, sizeof(game.player_rows));
+			shots_clear();
+			game.screen_step = 0;
+			game.screen_ms = 0;
+			
+			unsigned char seen = TimerTicks;
+			
+			SIMPROF_MARK(SIMPROF_END_SCREEN);
 			while(1) {
 				B2 = ~PINB & 0x02;
-				led_arr[6][0] = 2;
-				led_arr[6][1] = 2;
-				led_arr[6][2] = 2;
-				led_arr[6][5] = 2;
-				led_arr[6][6] = 2;
-				led_arr[6][7] = 2;
-				led_arr[5][0] = 2;
-				led_arr[5][2] = 2;
-				led_arr[5][5] = 2;
-				led_arr[5][7] = 2;
-				led_arr[4][0] = 2;
-				led_arr[4][1] = 2;
-				led_arr[4][2] = 2;
-				led_arr[4][5] = 2;
-				led_arr[4][6] = 2;
-				led_arr[4][7] = 2;
-				
-				led_arr[2][7] = 2;
-				led_arr[1][6] = 2;
-				led_arr[0][5] = 2;
-				led_arr[0][4] = 2;
-				led_arr[0][3] = 2;
-				led_arr[0][2] = 2;
-				led_arr[1][1] = 2;
-				led_arr[2][0] = 2;
-				shift();
+				/* Eyes and a smile, then the score */
+				while(seen != TimerTicks) {
+					seen++;
+					end_screen(sprite_win);
+				}
 				PWM_off();
 				
 				if(B2 == 2) {
-					
-					/* Fill led_arr with 0's */
-					for(int i = 0; i < 8; i++) {
-						for(int j = 0; j < 8; j++) {
-							led_arr[i][j] = 0;
-						}
-					}
-					
-					game_over = 0x00;
-					score = 0;
-					
-					height = 0;
-					width = 3;
-					
-					led_arr[height][width] = 3;
-					
-					task1.state = init;
-					task1.period = getMovement_period;
-					task1.elapsedTime = getMovement_period;
-					
-					task2.state = mO_init;
-					task2.period = moveObject_period;
-					task2.elapsedTime = moveObject_period;
-					
-					task3.state = mW_init;
-					task3.period = moveWalls_period;
-					task3.elapsedTime = moveWalls_period;
-					
-					task4.state = pS_init;
-					task4.period = powerupShooting_period;
-					task4.elapsedTime = powerupShooting_period;
-					
-					task5.state = pM_wait;
-					task5.period = playMusic_period;
-					task5.elapsedTime = playMusic_period;
-					
-					GND = 0x01;
-					B2 = 0x01;
-					PWM_on();
-					i = 0;
-					row = 0;
-					seeder = 0;
-					powerup_activated = 0x00;
-					powerup_remainingTime = 0x00;
-					powerup_heightCounter = 0x01;
-					counter = 7;
-					pos_0 = pos_1 = pos_2 = pos_3 = pos_4 = pos_5 = pos_6 = pos_7 = 0;
-					shift();
+					restart_game();
 					break;
 				}
 				
@@ -2132,95 +788,43 @@ int main(void)
 					continue;
 				}
 			}
+			TELEMETRY_END_SCREEN_OFF();
 		}
 		
-		else if(game_over == 0x01) {
-			/* Fill led_arr with 0's */
-			for(int i = 0; i < 8; i++) {
-				for(int j = 0; j < 8; j++) {
-					led_arr[i][j] = 0;
-				}
-			}
+		else if(game.game_over == 0x01) {
+			TELEMETRY_END_SCREEN_ON();
+			TELEMETRY_EVENT(TELEMETRY_GAME_OVER, game.score);
+			
+			/* Clear the board */
+			memset(game.wall_rows, 0, sizeof(game.wall_rows));
+			memset(game.powerup_rows, 0, sizeof(game.powerup_rows));
+			memset(game.player_rows, 0, sizeof(game.player_rows));
+			shots_clear();
+			game.screen_step = 0;
+			game.screen_ms = 0;
 			
+			unsigned char seen = TimerTicks;
+			
+			SIMPROF_MARK(SIMPROF_END_SCREEN);
 			while(1) {
 				B2 = ~PINB & 0x02;
-				led_arr[6][0] = 2;
-				led_arr[6][1] = 2;
-				led_arr[6][2] = 2;
-				led_arr[6][5] = 2;
-				led_arr[6][6] = 2;
-				led_arr[6][7] = 2;
-				led_arr[5][0] = 2;
-				led_arr[5][2] = 2;
-				led_arr[5][5] = 2;
-				led_arr[5][7] = 2;
-				led_arr[4][0] = 2;
-				led_arr[4][1] = 2;
-				led_arr[4][2] = 2;
-				led_arr[4][5] = 2;
-				led_arr[4][6] = 2;
-				led_arr[4][7] = 2;
-				
-				led_arr[0][7] = 2;
-				led_arr[1][6] = 2;
-				led_arr[2][5] = 2;
-				led_arr[2][4] = 2;
-				led_arr[2][3] = 2;
-				led_arr[2][2] = 2;
-				led_arr[1][1] = 2;
-				led_arr[0][0] = 2;
-				shift();
+				/* Eyes and a frown, then the score */
+				while(seen != TimerTicks) {
+					seen++;
+					end_screen(sprite_lose);
+				}
 				PWM_off();
 				
-				if(B2 == 2) {
-					
-					/* Fill led_arr with 0's */
-					for(int i = 0; i < 8; i++) {
-						for(int j = 0; j < 8; j++) {
-							led_arr[i][j] = 0;
-						}
-					}
-					
-					game_over = 0x00;
-					score = 0;
-					
-					height = 0;
-					width = 3;
-					
-					led_arr[height][width] = 3;
-					
-					task1.state = init;
-					task1.period = getMovement_period;
-					task1.elapsedTime = getMovement_period;
-					
-					task2.state = mO_init;
-					task2.period = moveObject_period;
-					task2.elapsedTime = moveObject_period;
-					
-					task3.state = mW_init;
-					task3.period = moveWalls_period;
-					task3.elapsedTime = moveWalls_period;
-					
-					task4.state = pS_init;
-					task4.period = powerupShooting_period;
-					task4.elapsedTime = powerupShooting_period;
-					
-					task5.state = pM_wait;
-					task5.period = playMusic_period;
-					task5.elapsedTime = playMusic_period;
-					
-					GND = 0x01;
-					B2 = 0x01;
+				if(REWIND_GAME_OVER()) {
+					TELEMETRY_EVENT(TELEMETRY_REWIND, 0);
 					PWM_on();
-					i = 0;
-					row = 0;
-					seeder = 0;
-					powerup_activated = 0x00;
-					powerup_remainingTime = 0x00;
-					powerup_heightCounter = 0x01;
-					counter = 7;
-					pos_0 = pos_1 = pos_2 = pos_3 = pos_4 = pos_5 = pos_6 = pos_7 = 0;
-					shift();
+					break;
+				}
+				
+				/* Logged on the way out: a rewind can still take the game back */
+				if(B2 == 2) {
+					highscore_game_end(game.score, 0);
+					restart_game();
 					break;
 				}
 				
@@ -2228,10 +832,17 @@ int main(void)
 					continue;
 				}
 			}
+			TELEMETRY_END_SCREEN_OFF();
 		}
 		
+		MEMSTAT_TICK();
+		/* Slack before the timer: the walls to come, see walls.h */
+		walls_fill();
+		SIMPROF_MARK(SIMPROF_IDLE);
 		while(!TimerFlag);
 		TimerFlag = 0;
+		SIMPROF_MARK(SIMPROF_BUSY);
+		TELEMETRY_TICK();
 	}
 	
 	return 0;
@@ -0,0 +1,102 @@
+// SRAM use of a running unit. Build with -DMEMSTAT to enable it, otherwise
+// MEMSTAT_TICK() compiles to nothing.
+//
+// Before .data and .bss are set up, .init1 paints the RAM from the end of .bss
+// (_end) to the top of the stack with MEMSTAT_PAINT. The stack grows down into
+// the paint, so the lowest byte above the heap that is no longer paint is the
+// deepest the stack has gone since power on. memstat_tick() looks for it
+// MEMSTAT_SCAN bytes per tick, about 60 us, and a pass over 15 KB of free RAM
+// takes a quarter of a second. A local that happens to hold MEMSTAT_PAINT at
+// the deepest point can hide a byte or two.
+//
+// memstat_stack_peak holds the result for a debugger. With TELEMETRY the sizes
+// of .data, .bss and the heap and the stack peak are sent every
+// MEMSTAT_REPORT_MS ticks as TELEMETRY_RAM_ records; escalade_trace prints
+// them. The static part is checked at build time by make -C host ramcheck.
+
+////////////////////////////////////////////////////////////////////////////////
+
+#ifndef MEMSTAT_H
+#define MEMSTAT_H
+
+#ifdef MEMSTAT
+#include <avr/io.h>
+#include "telemetry.h"
+
+#define MEMSTAT_PAINT		0xC5
+#define MEMSTAT_SCAN		64
+#define MEMSTAT_REPORT_MS	1024 // power of two
+
+/* From the avr-libc linker script and malloc */
+extern char __data_start, __data_end, __bss_start, __bss_end, __heap_start;
+extern char* __brkval;
+
+unsigned short memstat_stack_peak = 0; // bytes below RAMEND, deepest so far
+unsigned char* memstat_pos = 0; // next byte of the current pass, 0 between passes
+unsigned short memstat_ms = 0;
+
+void memstat_paint(void) __attribute__((naked, used, section(".init1")));
+
+////////////////////////////////////////////////////////////////////////////////
+//Functionality - fills _end..__stack with MEMSTAT_PAINT; runs before the stack
+//	pointer and r1 are set up, so it is plain asm and falls through to .init2
+//Parameter: none
+//Returns: nothing
+void memstat_paint(void) {
+	__asm__ volatile(
+		"	ldi r30, lo8(_end)\n"
+		"	ldi r31, hi8(_end)\n"
+		"	ldi r24, %0\n"
+		"	ldi r25, hi8(__stack)\n"
+		"	rjmp 2f\n"
+		"1:	st Z+, r24\n"
+		"2:	cpi r30, lo8(__stack)\n"
+		"	cpc r31, r25\n"
+		"	brlo 1b\n"
+		"	breq 1b\n"
+		:: "M" (MEMSTAT_PAINT));
+}
+
+static inline unsigned char* memstat_heap_end() {
+	return __brkval ? (unsigned char*)__brkval : (unsigned char*)&__heap_start;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//Functionality - scans the next MEMSTAT_SCAN bytes of the paint, and at the end
+//	of a pass updates memstat_stack_peak
+//Parameter: none
+//Returns: nothing
+static void memstat_scan() {
+	unsigned char* top = (unsigned char*)RAMEND + 1;
+	unsigned char* p = memstat_pos ? memstat_pos : memstat_heap_end();
+
+	for(unsigned char n = MEMSTAT_SCAN; n; --n) {
+		if(p >= top || *p != MEMSTAT_PAINT) {
+			unsigned short used = top - p;
+			if(used > memstat_stack_peak) {
+				memstat_stack_peak = used;
+			}
+			memstat_pos = 0;
+			return;
+		}
+		++p;
+	}
+	memstat_pos = p;
+}
+
+static inline void memstat_tick() {
+	memstat_scan();
+	if((++memstat_ms & (MEMSTAT_REPORT_MS - 1)) == 0) {
+		TELEMETRY_EVENT(TELEMETRY_RAM_DATA, &__data_end - &__data_start);
+		TELEMETRY_EVENT(TELEMETRY_RAM_BSS, &__bss_end - &__bss_start);
+		TELEMETRY_EVENT(TELEMETRY_RAM_HEAP, memstat_heap_end() - (unsigned char*)&__heap_start);
+		TELEMETRY_EVENT(TELEMETRY_STACK_PEAK, memstat_stack_peak);
+	}
+}
+
+#define MEMSTAT_TICK() memstat_tick()
+#else
+#define MEMSTAT_TICK()
+#endif
+
+#endif //MEMSTAT_H
@@ -0,0 +1,47 @@
+// Protothreads: tasks written as straight-line code instead of a transition
+// switch and an action switch over an enum. A protothread task is an ordinary
+// TickFct; the state it returns, and the scheduler keeps in task.state, is the
+// number of the PT_YIELD() or PT_AWAIT() it stopped at, and its next tick
+// carries on from there:
+//
+//   int blink(int state) {
+//       PT_BEGIN(state);
+//       while(1) {
+//           PT_AWAIT(bus_take(BUS_SUB_..., &arg) != BUS_EMPTY);
+//           ...
+//           PT_YIELD();
+//       }
+//       PT_END();
+//   }
+//
+// Waiting a number of ticks is a loop around PT_YIELD() on a counter, and
+// waiting for another task is a PT_AWAIT() on the bus (bus.h), whose wake
+// makes the task tick as soon as the event is published.
+//
+// A resume point is a case label inside PT_BEGIN()'s switch, so there is no
+// stack per task and a tick costs one switch dispatch, as for the enum tasks.
+// Locals do not keep their values across a yield; whatever has to goes in
+// GameState, as for the other tasks. The task's code cannot have a switch of
+// its own around a yield. Resume points are numbered from 1 by __COUNTER__,
+// up to 127 per task so they fit task.state; 0 is the start, the state the
+// task is given at power on.
+
+////////////////////////////////////////////////////////////////////////////////
+
+#ifndef PT_H
+#define PT_H
+
+#define PT_START	0
+
+#define PT_BEGIN(state)	{ enum { pt_base = __COUNTER__ }; switch(state) { case PT_START:
+
+/* Ends the tick; the next one carries on after it */
+#define PT_YIELD()	do { enum { pt_at = __COUNTER__ - pt_base }; return pt_at; case pt_at:; } while(0)
+
+/* Carries on once cond holds, checking it now and on every tick after */
+#define PT_AWAIT(cond)	do { enum { pt_at = __COUNTER__ - pt_base }; case pt_at: if(!(cond)) { return pt_at; } } while(0)
+
+/* Running off the end starts the task over on its next tick */
+#define PT_END()	default: break; } } return PT_START
+
+#endif //PT_H
@@ -0,0 +1,205 @@
+// Rewind buffer: the last few seconds of GameState, kept as XOR deltas between
+// consecutive snapshots and run-length encoded. Build with -DREWIND to enable
+// it, otherwise every REWIND_ macro compiles to nothing. On the game over
+// screen, pushing the thumbstick left puts the game back to the oldest state
+// still in the buffer and play resumes from there.
+//
+// A snapshot is taken every REWIND_PERIOD_MS ticks of play. rewind_prev holds
+// the newest one, and each ring entry is the delta from the snapshot before it
+// to the next one, so stepping back is XORing entries into rewind_prev from the
+// newest on. The ring drops its oldest entries to make room, and a restore
+// decodes at most REWIND_BYTES bytes.
+//
+// Entry	= length, runs, length		(length of the runs, both ends)
+// run		= skip, count, count bytes	(XOR bytes, after skip unchanged ones)
+// Short stretches of unchanged bytes are kept inside a run, a new run costs
+// more. Trailing unchanged bytes are not stored.
+
+////////////////////////////////////////////////////////////////////////////////
+
+#ifndef REWIND_H
+#define REWIND_H
+
+#ifdef REWIND
+#include <string.h>
+#include "game_state.h"
+
+#define REWIND_BYTES		512 // power of two
+#define REWIND_PERIOD_MS	250
+#define REWIND_MAX_ENTRY	253 // longer deltas restart the history
+
+unsigned char rewind_ring[REWIND_BYTES];
+unsigned short rewind_head = 0; // next byte to write
+unsigned short rewind_used = 0;
+unsigned char rewind_entries = 0;
+unsigned char rewind_ms = 0;
+unsigned char rewind_have_prev = 0;
+GameState rewind_prev;
+
+unsigned short stick_read(void); // main.c, the sample TimerFast() takes
+
+static inline unsigned char rewind_byte(unsigned short at) {
+	return rewind_ring[at & (REWIND_BYTES - 1)];
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//Functionality - run-length encodes game ^ rewind_prev
+//Parameter: whether to write it, and the ring position to write it at
+//Returns: encoded length in bytes
+static unsigned short rewind_encode(unsigned char write, unsigned short at) {
+	const unsigned char* cur = (const unsigned char*)&game;
+	const unsigned char* prev = (const unsigned char*)&rewind_prev;
+	unsigned short len = 0;
+	unsigned short pos = 0;
+
+	while(pos < sizeof(GameState)) {
+		unsigned char skip = 0;
+		while(pos < sizeof(GameState) && skip < 255 && cur[pos] == prev[pos]) {
+			++skip;
+			++pos;
+		}
+		if(pos == sizeof(GameState)) {
+			break;
+		}
+
+		/* The run goes on through gaps of up to two unchanged bytes */
+		unsigned short end = pos;
+		while(end < sizeof(GameState) && end - pos < 255) {
+			if(cur[end] != prev[end]) {
+				++end;
+			}
+
+			else if(end + 2 < sizeof(GameState) && (cur[end + 1] != prev[end + 1] ||
+				cur[end + 2] != prev[end + 2])) {
+				++end;
+			}
+
+			else {
+				break;
+			}
+		}
+
+		if(write) {
+			rewind_ring[(at + len) & (REWIND_BYTES - 1)] = skip;
+			rewind_ring[(at + len + 1) & (REWIND_BYTES - 1)] = end - pos;
+			for(unsigned short k = pos; k < end; ++k) {
+				rewind_ring[(at + len + 2 + k - pos) & (REWIND_BYTES - 1)] = cur[k] ^ prev[k];
+			}
+		}
+		len += 2 + (end - pos);
+		pos = end;
+	}
+
+	return len;
+}
+
+void rewind_clear() {
+	rewind_used = 0;
+	rewind_entries = 0;
+	rewind_ms = 0;
+	rewind_have_prev = 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//Functionality - adds the current game state to the history
+//Parameter: none
+//Returns: nothing
+void rewind_push() {
+	if(rewind_have_prev) {
+		unsigned short len = rewind_encode(0, 0);
+
+		if(len > REWIND_MAX_ENTRY) {
+			rewind_used = 0;
+			rewind_entries = 0;
+		}
+
+		else {
+			/* Drop the oldest entries until it fits */
+			while(rewind_used + len + 2 > REWIND_BYTES) {
+				unsigned short tail = rewind_head - rewind_used;
+				rewind_used -= rewind_byte(tail) + 2;
+				--rewind_entries;
+			}
+
+			rewind_ring[rewind_head & (REWIND_BYTES - 1)] = len;
+			rewind_encode(1, rewind_head + 1);
+			rewind_ring[(rewind_head + 1 + len) & (REWIND_BYTES - 1)] = len;
+			rewind_head += len + 2;
+			rewind_used += len + 2;
+			++rewind_entries;
+		}
+	}
+
+	memcpy(&rewind_prev, &game, sizeof(game));
+	rewind_have_prev = 1;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//Functionality - puts the game back a number of snapshots
+//Parameter: snapshots to go back, 0 for the newest one
+//Returns: how many it went back, fewer if the history is shorter
+unsigned char rewind_restore(unsigned char steps) {
+	unsigned char done = 0;
+
+	if(!rewind_have_prev) {
+		return 0;
+	}
+
+	while(done < steps && rewind_entries > 0) {
+		unsigned char len = rewind_byte(rewind_head - 1);
+		unsigned short at = rewind_head - 1 - len;
+		unsigned short end = rewind_head - 1;
+		unsigned short pos = 0;
+		unsigned char* prev = (unsigned char*)&rewind_prev;
+
+		while(at != end) {
+			pos += rewind_byte(at);
+			unsigned char count = rewind_byte(at + 1);
+			at += 2;
+			while(count--) {
+				prev[pos++] ^= rewind_byte(at++);
+			}
+		}
+
+		rewind_head -= len + 2;
+		rewind_used -= len + 2;
+		--rewind_entries;
+		++done;
+	}
+
+	memcpy(&game, &rewind_prev, sizeof(game));
+	rewind_ms = 0;
+	return done;
+}
+
+/* One tick of play, after the tasks */
+static inline void rewind_tick() {
+	if(++rewind_ms >= REWIND_PERIOD_MS && game.game_over == 0x00) {
+		rewind_ms = 0;
+		rewind_push();
+	}
+}
+
+/* Game over screen: stick left goes back as far as the buffer reaches */
+unsigned char rewind_game_over() {
+	if(stick_read() >= 100 || !rewind_have_prev) {
+		return 0;
+	}
+
+	rewind_restore(255);
+	return 1;
+}
+
+#define REWIND_CLEAR() rewind_clear()
+#define REWIND_TICK() rewind_tick()
+#define REWIND_GAME_OVER() rewind_game_over()
+
+#else
+
+#define REWIND_CLEAR()
+#define REWIND_TICK()
+#define REWIND_GAME_OVER() 0
+
+#endif //REWIND
+
+#endif //REWIND_H
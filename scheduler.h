@@ -7,6 +7,8 @@
 #ifndef SCHEDULER_H
 #define SCHEDULER_H
 
+#include "pt.h" // tasks written as protothreads
+
 ////////////////////////////////////////////////////////////////////////////////
 //Functionality - finds the greatest common divisor of two values
 //Parameter: Two long int's to find their GCD
@@ -30,7 +32,7 @@ typedef struct _task{
 	signed 	 char state; 		//Task's current state
 	unsigned long period; 		//Task period
 	unsigned long elapsedTime; 	//Time elapsed since last task tick
-	int (*TickFct)(int); 		//Task tick function
+	int (*TickFct)(int); 		//Task tick function, given and returning state
 } task;
 
 #endif //SCHEDULER_H
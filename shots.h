@@ -0,0 +1,118 @@
+// Shots of powerupShooting. Each board row has a bitboard of the columns
+// holding a shot (game.shot_rows, bit n = column n), and every shot fired takes
+// a slot of a pool of SHOT_CAPACITY (game.shot_col/shot_fired). All shots move
+// at the same speed, so moving them up a row is a shift of the row bitboards
+// and a tick of shot_clock; no slot is touched. A wall breaks where it meets a
+// shot, whether the shot flies into it (powerupShooting) or it comes down onto
+// the shot (moveWalls). In play the only walls are in row game.counter, so
+// that is the one row either has to check, and the check is an AND with
+// game.wall_rows however many shots are up. shift() draws shots in white over
+// the other layers.
+//
+// A slot is in use while its shot is still on its bitboard: row
+// shot_clock - shot_fired + 1, column shot_col. Slots are taken from the
+// shot_free list (links are slot + 1, 0 ends it), then from those never used
+// (shot_fresh up). Only when both are empty does shots_fire() sweep the pool
+// for slots whose shot has left the board or broken on a wall, so that work
+// comes once per pool full rather than with every step. shots_clear() empties
+// the pool when a powerup ends, which also keeps shot_clock from wrapping.
+//
+// SHOT_INTERVAL, SHOT_SPREAD and SHOT_PIERCE can be set with -D; the host port
+// in host/sim has the same defaults, which play like the original one bullet.
+
+////////////////////////////////////////////////////////////////////////////////
+
+#ifndef SHOTS_H
+#define SHOTS_H
+
+#include <string.h>
+#include "game_state.h"
+
+#ifndef SHOT_INTERVAL
+#define SHOT_INTERVAL	7	// powerupShooting steps between volleys
+#endif
+#ifndef SHOT_SPREAD
+#define SHOT_SPREAD		0	// extra shots each side of the player
+#endif
+#ifndef SHOT_PIERCE
+#define SHOT_PIERCE		1	// shots fly on through the walls they break
+#endif
+#define SHOT_STEPS		112	// powerupShooting steps a powerup lasts
+
+static unsigned char shots_in_use(unsigned char s) {
+	unsigned char r = game.shot_clock - game.shot_fired[s] + 1;
+	return r < BOARD_ROWS && ((game.shot_rows[r] >> game.shot_col[s]) & 0x01);
+}
+
+/* Puts every slot without a shot on the free list; the list is empty here */
+static void shots_sweep(void) {
+	for(unsigned char s = 0; s < game.shot_fresh; ++s) {
+		if(!shots_in_use(s)) {
+			game.shot_next[s] = game.shot_free;
+			game.shot_free = s + 1;
+		}
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//Functionality - puts a shot on row 1, unless the cell has one or the pool is full
+//Parameter: column
+//Returns: nothing
+void shots_fire(int col) {
+	board_row_t bit = BOARD_BIT(col);
+	
+	if(game.shot_rows[1] & bit) {
+		return;
+	}
+	
+	if(!game.shot_free && game.shot_fresh == SHOT_CAPACITY) {
+		shots_sweep();
+	}
+	
+	unsigned char s = game.shot_free;
+	if(s) {
+		game.shot_free = game.shot_next[s - 1];
+	}
+	
+	else if(game.shot_fresh < SHOT_CAPACITY) {
+		s = ++game.shot_fresh;
+	}
+	
+	else {
+		return;
+	}
+	
+	game.shot_fired[s - 1] = game.shot_clock;
+	game.shot_col[s - 1] = col;
+	game.shot_rows[1] |= bit;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//Functionality - breaks the walls in a row that hold a shot
+//Parameter: row
+//Returns: nothing
+void shots_hit_row(unsigned char r) {
+	board_row_t hits = game.shot_rows[r] & game.wall_rows[r];
+	game.wall_rows[r] &= ~hits;
+	if(!SHOT_PIERCE) {
+		game.shot_rows[r] &= ~hits;
+	}
+}
+
+/* Moves every shot up a row; the ones in the top row leave the board */
+void shots_advance(void) {
+	for(unsigned char r = BOARD_TOP; r > 1; --r) {
+		game.shot_rows[r] = game.shot_rows[r - 1];
+	}
+	game.shot_rows[1] = 0;
+	++game.shot_clock;
+}
+
+void shots_clear(void) {
+	memset(game.shot_rows, 0, sizeof(game.shot_rows));
+	game.shot_clock = 0;
+	game.shot_free = 0;
+	game.shot_fresh = 0;
+}
+
+#endif //SHOTS_H
@@ -0,0 +1,20 @@
+// Markers for the simavr cycle profiler in host/simprof.
+// Build with -DSIMPROF to write them to GPIOR0, otherwise they compile to nothing.
+
+////////////////////////////////////////////////////////////////////////////////
+
+#ifndef SIMPROF_H
+#define SIMPROF_H
+
+#define SIMPROF_IDLE		0x01 // main loop starts waiting for TimerFlag
+#define SIMPROF_BUSY		0x02 // main loop resumes after TimerFlag
+#define SIMPROF_END_SCREEN	0x03 // win/game over screen, no timer wait until restart
+
+#ifdef SIMPROF
+#include <avr/io.h>
+#define SIMPROF_MARK(m) (GPIOR0 = (m))
+#else
+#define SIMPROF_MARK(m)
+#endif
+
+#endif //SIMPROF_H
@@ -0,0 +1,123 @@
+// Pictures and text for the board, drawn from flash. A sprite is 8 bytes of
+// PROGMEM, one per row and top row first, bit n = column n of the 8 it covers
+// (bit 7 is on the left; moving right lowers the column). sprite_draw() puts
+// it into a layer as one masked store per row, so an 8x8 picture is 8 byte
+// writes on the one-panel board. Digits come from a 3x5 font: sprite_text() lays a number out as a strip of 5 rows, first digit
+// in the high bits, and sprite_draw_text() shows the part of the strip that a
+// scroll step has moved onto the board, a store per glyph row. The end
+// screens use them for the face and the score.
+
+////////////////////////////////////////////////////////////////////////////////
+
+#ifndef SPRITE_H
+#define SPRITE_H
+
+#include <string.h>
+#include <avr/pgmspace.h>
+#include "board.h"
+
+#define SPRITE_FONT_ROWS	5
+#define SPRITE_FONT_COLS	3
+
+/* Eyes and a smile */
+const unsigned char sprite_win[8] PROGMEM = {
+	0x00, /* O O O O O O O O */
+	0xE7, /* X X X O O X X X */
+	0xA5, /* X O X O O X O X */
+	0xE7, /* X X X O O X X X */
+	0x00, /* O O O O O O O O */
+	0x81, /* X O O O O O O X */
+	0x42, /* O X O O O O X O */
+	0x3C, /* O O X X X X O O */
+};
+
+/* Eyes and a frown */
+const unsigned char sprite_lose[8] PROGMEM = {
+	0x00, /* O O O O O O O O */
+	0xE7, /* X X X O O X X X */
+	0xA5, /* X O X O O X O X */
+	0xE7, /* X X X O O X X X */
+	0x00, /* O O O O O O O O */
+	0x3C, /* O O X X X X O O */
+	0x42, /* O X O O O O X O */
+	0x81, /* X O O O O O O X */
+};
+
+/* 0-9, top row first, bit 2 = the left column */
+const unsigned char sprite_font[10][SPRITE_FONT_ROWS] PROGMEM = {
+	{0x7, 0x5, 0x5, 0x5, 0x7},
+	{0x2, 0x6, 0x2, 0x2, 0x7},
+	{0x7, 0x1, 0x7, 0x4, 0x7},
+	{0x7, 0x1, 0x7, 0x1, 0x7},
+	{0x5, 0x5, 0x7, 0x1, 0x1},
+	{0x7, 0x4, 0x7, 0x1, 0x7},
+	{0x7, 0x4, 0x7, 0x5, 0x7},
+	{0x7, 0x1, 0x1, 0x1, 0x1},
+	{0x7, 0x5, 0x7, 0x5, 0x7},
+	{0x7, 0x5, 0x7, 0x1, 0x7},
+};
+
+////////////////////////////////////////////////////////////////////////////////
+//Functionality - draws an 8x8 sprite with its bottom right corner at row y,
+//                column x, replacing what the layer had under it
+//Parameter: layer, sprite in flash, column x, row y (y + 7 < BOARD_ROWS)
+//Returns: nothing
+static void sprite_draw(board_row_t* layer, const unsigned char* sprite, unsigned char x, unsigned char y) {
+	board_row_t keep = ~((board_row_t)0xFF << x);
+	board_row_t* out = layer + y + 7;
+	
+	for(unsigned char r = 0; r < 8; ++r) {
+		*out = (*out & keep) | ((board_row_t)pgm_read_byte(&sprite[r]) << x);
+		--out;
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//Functionality - lays value out in decimal, a blank column between digits
+//Parameter: strip to fill, top glyph row first; value
+//Returns: width of the text in columns
+static unsigned char sprite_text(unsigned short strip[SPRITE_FONT_ROWS], unsigned char value) {
+	unsigned char digits[3];
+	unsigned char n = 0;
+	
+	do {
+		digits[n++] = value % 10;
+		value /= 10;
+	} while(value);
+	
+	unsigned char width = n * (SPRITE_FONT_COLS + 1) - 1;
+	memset(strip, 0, SPRITE_FONT_ROWS * sizeof(strip[0]));
+	while(n) {
+		const unsigned char* glyph = sprite_font[digits[--n]];
+		for(unsigned char r = 0; r < SPRITE_FONT_ROWS; ++r) {
+			strip[r] = (strip[r] << (SPRITE_FONT_COLS + 1)) | pgm_read_byte(&glyph[r]);
+		}
+	}
+	
+	return width;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//Functionality - shows a text strip scrolled in from the right by step
+//                columns over rows y to y + 4, replacing those rows
+//Parameter: layer, strip and width from sprite_text(), step from 1 (the first
+//           column showing in column 0) to width + BOARD_COLS - 1 (the last
+//           column showing in the last board column), row y
+//Returns: nothing
+static void sprite_draw_text(board_row_t* layer, const unsigned short strip[SPRITE_FONT_ROWS],
+                             unsigned char width, unsigned char step, unsigned char y) {
+	board_row_t* out = layer + y + SPRITE_FONT_ROWS - 1;
+	
+	for(unsigned char r = 0; r < SPRITE_FONT_ROWS; ++r) {
+		if(step >= width) {
+			*out = (board_row_t)((board_row_t)strip[r] << (step - width));
+		}
+		
+		else {
+			*out = (board_row_t)(strip[r] >> (width - step));
+		}
+		--out;
+	}
+}
+
+#endif //SPRITE_H
@@ -0,0 +1,233 @@
+// USART0 telemetry for a running unit. Build with -DTELEMETRY to enable it,
+// otherwise every TELEMETRY_ macro compiles to nothing. host/telemetry decodes
+// the stream.
+//
+// TELEMETRY_EVENT() stores a fixed-size record in a ring and returns; it never
+// waits. With the ring full the record is counted in telemetry_dropped and
+// reported by the next record that fits, as a TELEMETRY_DROPPED record. The
+// UDRE interrupt encodes records one at a time and sends them at 38400 baud,
+// 8N1.
+//
+// Stream format, version 3. Times are in 8 us units (TCNT1 steps, 125 per ms).
+//	record	= type, varint dt [, varint arg]
+//	sync	= 0xA5, 0x5A, version, varint time
+// varint is LEB128: 7 bits per byte, low bits first, top bit set on all but the
+// last byte. dt is the time since the previous record; a sync sets the time of
+// the next record (its dt is 0). A sync comes first and then at least once per
+// TELEMETRY_SYNC_MS ticks, so a decoder can join a stream midway. Types
+// 0x01-0x0F carry an arg, 0x10-0x2F do not. Record time is the main loop tick
+// count plus TCNT1; it only advances while the game runs, not on end screens.
+// The display keeps refreshing on them, so the frames up to an end screen are
+// reported as it comes up and those during it are not counted.
+//
+// Note: TXD0 is PD1, the latch of the red shift register. A telemetry build
+// blanks red rows while a byte is being sent.
+
+////////////////////////////////////////////////////////////////////////////////
+
+#ifndef TELEMETRY_H
+#define TELEMETRY_H
+
+/* Record types with an arg, and what it holds */
+#define TELEMETRY_WALL				0x01 // wall columns, bit n = column n (up to 16)
+#define TELEMETRY_POWERUP_SPAWN		0x02 // powerup_spawn
+#define TELEMETRY_MOVE				0x03 // new width
+#define TELEMETRY_POWERUP_PICKUP	0x04 // width
+#define TELEMETRY_SCORE				0x05 // new score
+#define TELEMETRY_GAME_OVER			0x06 // score
+#define TELEMETRY_WIN				0x07 // score
+#define TELEMETRY_DROPPED			0x08 // records lost since the last report
+#define TELEMETRY_FRAMES			0x09 // full display refreshes since the last report
+#define TELEMETRY_RAM_DATA			0x0A // .data bytes, see memstat.h
+#define TELEMETRY_RAM_BSS			0x0B // .bss bytes
+#define TELEMETRY_RAM_HEAP			0x0C // heap bytes
+#define TELEMETRY_STACK_PEAK		0x0D // deepest stack since power on, bytes below RAMEND
+
+/* Record types without */
+#define TELEMETRY_TICK_START		0x10 // main loop woke up for a new tick
+#define TELEMETRY_POWERUP_EXPIRE	0x11
+#define TELEMETRY_RESTART			0x12
+#define TELEMETRY_REWIND			0x13 // the game over screen went back into the game, see rewind.h
+#define TELEMETRY_TASK_START		0x20 // + index in tasks[]
+#define TELEMETRY_TASK_END			0x28 // + index in tasks[]
+
+#define TELEMETRY_SYNC_0	0xA5
+#define TELEMETRY_SYNC_1	0x5A
+#define TELEMETRY_VERSION	3
+#define TELEMETRY_SYNC_MS	1000
+#define TELEMETRY_FRAMES_MS	256 // power of two
+
+#ifdef TELEMETRY
+#include <avr/io.h>
+#include <avr/interrupt.h>
+
+#define TELEMETRY_RECORDS 32 // power of two
+
+typedef struct _telemetry_record {
+	unsigned char type;
+	unsigned char sub;
+	unsigned short ms;
+	unsigned short arg;
+} telemetry_record;
+
+// The main loop only writes telemetry_head, the ISR only writes telemetry_tail.
+// Both are single bytes and count records modulo 256, so no locking is needed.
+telemetry_record telemetry_ring[TELEMETRY_RECORDS];
+volatile unsigned char telemetry_head = 0;
+volatile unsigned char telemetry_tail = 0;
+
+unsigned short telemetry_ms = 0;
+volatile unsigned short telemetry_frames = 0; // counted by shift() in the timer interrupt
+unsigned short telemetry_dropped = 0; // total since power on
+unsigned short telemetry_unreported = 0;
+
+/* Encoder state, ISR only */
+unsigned char telemetry_out[16];
+unsigned char telemetry_out_len = 0;
+unsigned char telemetry_out_pos = 0;
+unsigned char telemetry_synced = 0;
+unsigned short telemetry_sync_ms;
+unsigned short telemetry_last_ms;
+unsigned char telemetry_last_sub;
+
+static inline void telemetry_put(unsigned char head, unsigned char type, unsigned short arg) {
+	telemetry_record* r = &telemetry_ring[head & (TELEMETRY_RECORDS - 1)];
+	r->type = type;
+	r->sub = TCNT1L;
+	r->ms = telemetry_ms;
+	r->arg = arg;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//Functionality - queues one record for the UDRE interrupt, never blocks
+//Parameter: record type and its argument
+//Returns: nothing
+static inline void telemetry_event(unsigned char type, unsigned short arg) {
+	unsigned char head = telemetry_head;
+	unsigned char used = head - telemetry_tail;
+
+	if(used >= TELEMETRY_RECORDS - (telemetry_unreported ? 1 : 0)) {
+		++telemetry_dropped;
+		++telemetry_unreported;
+		return;
+	}
+
+	if(telemetry_unreported) {
+		telemetry_put(head++, TELEMETRY_DROPPED, telemetry_unreported);
+		telemetry_unreported = 0;
+	}
+
+	telemetry_put(head, type, arg);
+	telemetry_head = head + 1;
+	UCSR0B |= (1 << UDRIE0);
+}
+
+/* Display refreshes since the last call, read and cleared with interrupts off,
+   or a frame counted in between is lost */
+static inline unsigned short telemetry_frames_take() {
+	unsigned char sreg = SREG;
+	cli();
+	unsigned short frames = telemetry_frames;
+	telemetry_frames = 0;
+	SREG = sreg;
+	return frames;
+}
+
+/* Start of a main loop tick, reports display refreshes every TELEMETRY_FRAMES_MS */
+static inline void telemetry_tick() {
+	++telemetry_ms;
+	telemetry_event(TELEMETRY_TICK_START, 0);
+	if((telemetry_ms & (TELEMETRY_FRAMES_MS - 1)) == 0) {
+		telemetry_event(TELEMETRY_FRAMES, telemetry_frames_take());
+	}
+}
+
+void telemetry_init() {
+	UBRR0 = 25; // 38400 baud at 8 MHz with U2X0
+	UCSR0A = (1 << U2X0);
+	UCSR0C = (1 << UCSZ01) | (1 << UCSZ00);
+	UCSR0B = (1 << TXEN0);
+}
+
+static unsigned char telemetry_varint(unsigned char n, unsigned long v) {
+	while(v >= 0x80) {
+		telemetry_out[n++] = (unsigned char)v | 0x80;
+		v >>= 7;
+	}
+	telemetry_out[n++] = (unsigned char)v;
+	return n;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//Functionality - encodes the oldest record into telemetry_out and frees its slot
+//Parameter: none
+//Returns: encoded length, 0 if the ring is empty
+static unsigned char telemetry_encode() {
+	unsigned char tail = telemetry_tail;
+	if(tail == telemetry_head) {
+		return 0;
+	}
+
+	const telemetry_record* r = &telemetry_ring[tail & (TELEMETRY_RECORDS - 1)];
+	unsigned char n = 0;
+	long dt = 0;
+
+	if(!telemetry_synced || (unsigned short)(r->ms - telemetry_sync_ms) >= TELEMETRY_SYNC_MS) {
+		telemetry_out[0] = TELEMETRY_SYNC_0;
+		telemetry_out[1] = TELEMETRY_SYNC_1;
+		telemetry_out[2] = TELEMETRY_VERSION;
+		n = telemetry_varint(3, (unsigned long)r->ms * 125 + r->sub);
+		telemetry_synced = 1;
+		telemetry_sync_ms = r->ms;
+	}
+
+	else {
+		dt = (long)(unsigned short)(r->ms - telemetry_last_ms) * 125 + r->sub - telemetry_last_sub;
+		// TCNT1 wrapped before the main loop counted the tick
+		if(dt < 0) {
+			dt += 125;
+		}
+	}
+
+	telemetry_out[n++] = r->type;
+	n = telemetry_varint(n, (unsigned long)dt);
+	if(r->type < TELEMETRY_TICK_START) {
+		n = telemetry_varint(n, r->arg);
+	}
+
+	telemetry_last_ms = r->ms;
+	telemetry_last_sub = r->sub;
+	telemetry_tail = tail + 1;
+	return n;
+}
+
+ISR(USART0_UDRE_vect)
+{
+	if(telemetry_out_pos == telemetry_out_len) {
+		telemetry_out_len = telemetry_encode();
+		telemetry_out_pos = 0;
+		if(telemetry_out_len == 0) {
+			UCSR0B &= ~(1 << UDRIE0);
+			return;
+		}
+	}
+
+	UDR0 = telemetry_out[telemetry_out_pos++];
+}
+
+#define TELEMETRY_INIT() telemetry_init()
+#define TELEMETRY_TICK() telemetry_tick()
+#define TELEMETRY_FRAME() (++telemetry_frames)
+#define TELEMETRY_EVENT(type, arg) telemetry_event((type), (arg))
+#define TELEMETRY_END_SCREEN_ON() telemetry_event(TELEMETRY_FRAMES, telemetry_frames_take())
+#define TELEMETRY_END_SCREEN_OFF() ((void)telemetry_frames_take())
+#else
+#define TELEMETRY_INIT()
+#define TELEMETRY_TICK()
+#define TELEMETRY_FRAME()
+#define TELEMETRY_EVENT(type, arg)
+#define TELEMETRY_END_SCREEN_ON()
+#define TELEMETRY_END_SCREEN_OFF()
+#endif
+
+#endif //TELEMETRY_H
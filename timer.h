@@ -10,6 +10,37 @@
 #include <avr/interrupt.h>
 
 volatile unsigned char TimerFlag = 0; // TimerISR() sets this to 1. C programmer should clear to 0.
+volatile unsigned char TimerTicks = 0; // TimerISR() counts up, for loops that do not wait on TimerFlag
+volatile unsigned char TimerBusy = 0; // TimerFast() is running
+volatile unsigned char TimerOverruns = 0; // Ticks that found TimerFast() still running, saturates
+
+// The C programmer defines this: the high priority jobs, run from the timer
+// interrupt every tick, see TimerISR()
+void TimerFast();
+
+// Clock service on the same timer: TCNT1 steps TIMER_STEPS times a ms, 8 us
+// each, and every compare match adds a ms to the count in software. Read
+// through TimerMicros() and TimerMillis(). Both are unsigned long and wrap
+// (micros after 71 minutes), so compare times by subtracting them.
+#define TIMER_STEPS		125	// TCNT1 steps per ms at 8 MHz / 64
+#define TIMER_STEP_US	8
+volatile unsigned long TimerMs = 0; // Compare matches taken since power on
+volatile unsigned long TimerUs = 0; // TimerMs in us, so a read needs no multiply
+
+// Software alarms: up to TIMER_ALARMS callbacks at given times, all off
+// OCR1B. Every ms the compare A interrupt points OCR1B at the earliest alarm
+// due before the next ms, and the compare B interrupt calls what is due, so an
+// alarm is 24 us late at most unless interrupts were off. Callbacks run in the
+// interrupt with interrupts off; they may set alarms, their own included.
+#define TIMER_ALARMS	4
+#define TIMER_NO_ALARM	0xFF
+
+typedef struct {
+	unsigned long at; // TimerMicros() to go off at
+	void (*fct)(void); // 0 for a free slot
+} TimerAlarm;
+
+TimerAlarm TimerAlarms[TIMER_ALARMS];
 
 // Internal variables for mapping AVR's ISR to our cleaner TimerISR model.
 unsigned long _avr_timer_M = 1; // Start count from here, down to 0. Default 1ms
@@ -30,10 +61,10 @@ void TimerOn() {
 					// Thus, TCNT1 register will count at 125,000 ticks/s
 
 	// AVR output compare register OCR1A.
-	OCR1A 	= 125;	// Timer interrupt will be generated when TCNT1==OCR1A
+	OCR1A 	= TIMER_STEPS - 1;	// Timer interrupt will be generated when TCNT1==OCR1A
 					// We want a 1 ms tick. 0.001 s * 125,000 ticks/s = 125
-					// So when TCNT1 register equals 125,
-					// 1 ms has passed. Thus, we compare to 125.
+					// TCNT1 counts 0 to OCR1A and starts over on the next
+					// step, so 125 steps (1 ms) per match. Thus, we compare to 124.
 					// AVR timer interrupt mask register
 
 	TIMSK1 	= 0x02; // bit1: OCIE1A -- enables compare match interrupt
@@ -52,14 +83,128 @@ void TimerOff() {
 	TCCR1B 	= 0x00; // bit3bit2bit1bit0=0000: timer off
 }
 
+// us since TimerOn(), about 30 cycles: the count and TCNT1 read with
+// interrupts off, plus a ms if the compare match is pending, i.e. TCNT1 has
+// already started over but the interrupt has not counted it yet.
+unsigned long TimerMicros() {
+	unsigned char sreg = SREG;
+	cli();
+	unsigned long us = TimerUs;
+	unsigned char step = TCNT1L; // below TIMER_STEPS, the low byte is enough
+	if ((TIFR1 & (1 << OCF1A)) && step < TIMER_STEPS - 1) {
+		us += 1000;
+	}
+	SREG = sreg;
+	return us + (unsigned short)step * TIMER_STEP_US;
+}
+
+// ms since TimerOn(), as counted by the interrupt
+unsigned long TimerMillis() {
+	unsigned char sreg = SREG;
+	cli();
+	unsigned long ms = TimerMs;
+	SREG = sreg;
+	return ms;
+}
+
+// Points OCR1B at the earliest alarm due before the next compare match, or
+// turns compare B off. Interrupts must be off.
+static void TimerAlarmArm() {
+	unsigned long base = TimerUs;
+	unsigned short first = 1000;
+	
+	for (unsigned char i = 0; i < TIMER_ALARMS; i++) {
+		if (TimerAlarms[i].fct) {
+			long left = (long)(TimerAlarms[i].at - base);
+			if (left < first) {
+				first = left < 0 ? 0 : (unsigned short)left;
+			}
+		}
+	}
+	
+	if (first >= 1000) {
+		TIMSK1 &= ~(1 << OCIE1B);
+		return;
+	}
+	
+	// A step that has gone by, or goes by before OCR1B is written, would only
+	// match in the next ms: keep a step clear of TCNT1
+	unsigned char step = (first + TIMER_STEP_US - 1) / TIMER_STEP_US;
+	unsigned char now = TCNT1L;
+	if (step <= now + 1) {
+		step = now + 2;
+	}
+	if (step >= TIMER_STEPS) {
+		TIMSK1 &= ~(1 << OCIE1B); // the compare A interrupt arms it again
+		return;
+	}
+	OCR1B = step;
+	// Clears a match from before, unless an alarm is already due: then the
+	// match that is pending, e.g. from while interrupts were off, is for it
+	if (first != 0) {
+		TIFR1 = (1 << OCF1B);
+	}
+	TIMSK1 |= (1 << OCIE1B);
+}
+
+// Calls fct in us microseconds. Returns the alarm's slot for
+// TimerAlarmCancel(), or TIMER_NO_ALARM if all are in use.
+unsigned char TimerAlarmSet(void (*fct)(void), unsigned long us) {
+	unsigned char slot = TIMER_NO_ALARM;
+	unsigned char sreg = SREG;
+	cli();
+	for (unsigned char i = 0; i < TIMER_ALARMS; i++) {
+		if (!TimerAlarms[i].fct) {
+			TimerAlarms[i].at = TimerMicros() + us;
+			TimerAlarms[i].fct = fct;
+			TimerAlarmArm();
+			slot = i;
+			break;
+		}
+	}
+	SREG = sreg;
+	return slot;
+}
+
+void TimerAlarmCancel(unsigned char slot) {
+	unsigned char sreg = SREG;
+	cli();
+	TimerAlarms[slot].fct = 0;
+	TimerAlarmArm();
+	SREG = sreg;
+}
+
+// Two level scheduling: the main loop runs the tasks cooperatively, and
+// every tick the interrupt preempts them for TimerFast(). TimerFast() runs
+// with interrupts back on so the UART and EEPROM interrupts, which are short,
+// can still preempt it in turn. Should it ever take a whole tick, the next
+// tick only counts an overrun rather than nesting a second TimerFast().
 void TimerISR() {
 	TimerFlag = 1;
+	TimerTicks++;
+	
+	if (TimerBusy) {
+		if (TimerOverruns != 0xFF) {
+			TimerOverruns++;
+		}
+		return;
+	}
+	
+	TimerBusy = 1;
+	sei();
+	TimerFast();
+	cli();
+	TimerBusy = 0;
 }
 
 // In our approach, the C programmer does not touch this ISR, but rather TimerISR()
 ISR(TIMER1_COMPA_vect)
 {
 	// CPU automatically calls when TCNT0 == OCR0 (every 1 ms per TimerOn settings)
+	TimerMs++;
+	TimerUs += 1000;
+	TimerAlarmArm();
+	
 	_avr_timer_cntcurr--; 			// Count down to 0 rather than up to TOP
 	if (_avr_timer_cntcurr == 0) { 	// results in a more efficient compare
 		TimerISR(); 				// Call the ISR that the user uses
@@ -67,4 +212,19 @@ ISR(TIMER1_COMPA_vect)
 	}
 }
 
-#endif //TIMER_H
+// Calls the alarms that are due, then points OCR1B at the next one
+ISR(TIMER1_COMPB_vect)
+{
+	unsigned long now = TimerMicros();
+	
+	for (unsigned char i = 0; i < TIMER_ALARMS; i++) {
+		void (*fct)(void) = TimerAlarms[i].fct;
+		if (fct && (long)(TimerAlarms[i].at - now) <= 0) {
+			TimerAlarms[i].fct = 0; // free before the call, so it can set itself again
+			fct();
+		}
+	}
+	TimerAlarmArm();
+}
+
+#endif //TIMER_H
@@ -0,0 +1,216 @@
+// Walls, made ahead of time and made to be passable. walls_fill() makes the
+// next wall in the slack at the end of a main loop pass, before the timer
+// wait, one wall per pass into a ring of WALL_QUEUE walls in GameState, so the
+// queue is full again a tick after a wall is taken. mW_generate only takes the
+// oldest with walls_take(), a few loads and stores whatever the wall is.
+//
+// A wall is drawn as an 8-bit pattern, bit n closing block n of the board
+// (BOARD_COLS / 8 columns, one column on the 8x8 board), with fewer blocks
+// open the higher the score it will come down at: 3 of 8 up to 20, then 2,
+// then 1 from 40, in one opening or two. It is only queued if a player in any
+// gap of the wall before it can reach one of its gaps in the moves there are
+// until it lands, a move every WALL_MOVE_MS at the moveWalls period of that
+// score, after WALL_REACT_MS to see it coming. On the 8x8 board the moves
+// only fall short of half the columns (with the wrap, enough to reach any
+// gap) from a score of 40, where a gap four columns from the last one is
+// drawn again; on 16x16 they never do, so there every pattern passes. The
+// check is a breadth-first search over the columns as a bitmask: the gaps,
+// grown by a column each side (wrapping like moveObject) once per move, have
+// to cover the gaps of the wall before. A pattern that fails is
+// drawn again, up to WALL_TRIES times; then the last draw gets the openings
+// of the wall before as well, which always passes. Powerups only help the
+// player and shots only open walls, so neither is counted.
+//
+// Every loop has a fixed bound: WALL_TRIES draws of at most 3 rand() calls
+// and a search of at most BOARD_COLS / 2 steps, the powerup roll and a scan
+// of 8 blocks for its opening. escalade_simprof reports the worst walls_fill()
+// call on the AVR and escalade_bench its host cost with every draw failing.
+//
+// A queued wall is its pattern and the column of its powerup, or
+// WALL_NO_POWERUP. The powerup is rolled for every wall and dropped when it is
+// taken while one is active. Walls follow seeder, as it was when the wall was
+// queued, and the queue lets the host bot see the walls to come.
+//
+// With a level built in (level.h) the walls come from it instead, with the
+// moveWalls period it sets for them, which walls_take() puts in place.
+
+////////////////////////////////////////////////////////////////////////////////
+
+#ifndef WALLS_H
+#define WALLS_H
+
+#include <stdlib.h>
+#include "game_state.h"
+
+#define WALL_NO_POWERUP	0xFF
+#define WALL_TRIES		4	// patterns drawn before falling back to a sure one
+#define WALL_MOVE_MS	90	// getMovement reads the stick every other 45 ms tick
+#define WALL_REACT_MS	300	// from a wall appearing to the player moving for it
+
+#include "level.h"
+
+////////////////////////////////////////////////////////////////////////////////
+//Functionality - stretches a pattern to the board
+//Parameter: pattern, bit n = block n of BOARD_COLS / 8 columns
+//Returns: the columns, bit n = column n
+static board_row_t walls_stretch(unsigned char p) {
+#if BOARD_COLS == 8
+	return p;
+#else
+	board_row_t mask = 0;
+	for(signed char n = 7; n >= 0; --n) {
+		mask <<= BOARD_COLS / 8;
+		if(p & (1 << n)) {
+			mask |= BOARD_BLOCK;
+		}
+	}
+	return mask;
+#endif
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//Functionality - moves a player has from one wall leaving row 0 until the next
+//                lands, at the moveWalls period main() sets for score
+//Parameter: score
+//Returns: moves, at most BOARD_COLS / 2 (enough to reach any column)
+static unsigned char walls_moves(unsigned char score) {
+	unsigned short period = score >= 40 ? 100 : (score >= 20 ? 150 : 200);
+	unsigned short moves = (BOARD_TOP * period - WALL_REACT_MS) / WALL_MOVE_MS - 1;
+	return moves < BOARD_COLS / 2 ? moves : BOARD_COLS / 2;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//Functionality - can a player anywhere in from reach a gap of mask in moves?
+//Parameter: columns to start from, wall columns, moves
+//Returns: 1 if so
+static unsigned char walls_passable(board_row_t from, board_row_t mask, unsigned char moves) {
+	board_row_t reach = ~mask;
+	
+	while(from & ~reach) {
+		if(moves-- == 0) {
+			return 0;
+		}
+		reach |= (board_row_t)(reach << 1) | (board_row_t)(reach >> BOARD_LAST_COL) |
+		         (board_row_t)(reach >> 1) | (board_row_t)(reach << BOARD_LAST_COL);
+	}
+	return 1;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//Functionality - draws a pattern with open blocks open, in one opening or two
+//Parameter: open, 1 to 3
+//Returns: the pattern
+static unsigned char walls_draw(unsigned char open) {
+	unsigned char p = 0xFF;
+	unsigned char split = open;
+	
+	if(open > 1 && (rand() & 0x01)) {
+		split = open / 2;
+	}
+	
+	unsigned char at = rand() % 8;
+	for(unsigned char k = 0; k < open; ++k) {
+		if(k == split) {
+			at = rand() % 8;
+		}
+		p &= ~(1 << (at % 8));
+		++at;
+	}
+	return p;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//Functionality - puts a wall at the back of the queue
+//Parameter: pattern, powerup column or WALL_NO_POWERUP, moveWalls period or 0
+//Returns: nothing
+static void walls_queue(unsigned char p, unsigned char spawn, unsigned char period) {
+	unsigned char k = (game.wall_head + game.wall_count) % WALL_QUEUE;
+	game.wall_next[k] = p;
+	game.wall_spawn[k] = spawn;
+	game.wall_period[k] = period;
+	game.wall_last = p;
+	++game.wall_count;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//Functionality - queues one more wall unless the queue is full
+//Parameter: none
+//Returns: nothing
+static void walls_fill(void) {
+	if(game.wall_count == WALL_QUEUE) {
+		return;
+	}
+	
+	unsigned char p, spawn, period;
+	if(game.level && level_next(&p, &spawn, &period)) {
+		walls_queue(p, spawn, period);
+		return;
+	}
+	
+	/* New seeder & random numbers generated */
+	++game.seeder;
+	srand(game.seeder);
+	
+	/* Score when the wall comes down, after the one on the board and the
+	   queued ones */
+	unsigned char score = game.score + game.wall_count + 1;
+	unsigned char open = score < 20 ? 3 : (score < 40 ? 2 : 1);
+	unsigned char moves = walls_moves(score);
+	board_row_t from = ~walls_stretch(game.wall_last);
+	
+	for(unsigned char tries = 1; ; ++tries) {
+		p = walls_draw(open);
+		if(walls_passable(from, walls_stretch(p), moves)) {
+			break;
+		}
+		
+		if(tries == WALL_TRIES) {
+			p &= game.wall_last;
+			break;
+		}
+	}
+	
+	/* A powerup with a 20% chance, in an opening of the wall */
+	spawn = WALL_NO_POWERUP;
+	unsigned char roll = rand() % 10 + 1;
+	if(roll == 1 || roll == 5) {
+		unsigned char b = rand() % 8;
+		while(p & (1 << b)) {
+			b = (b + 1) % 8;
+		}
+		spawn = b * (BOARD_COLS / 8) + rand() % (BOARD_COLS / 8);
+	}
+	
+	walls_queue(p, spawn, 0);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//Functionality - takes the oldest queued wall into game.wall and, when no
+//                powerup is active, its powerup into powerup_randomNum (1 if
+//                it has one, else 0) and powerup_spawn. A level's period for
+//                the wall goes into moveWalls, which is ticking. An empty
+//                queue, only possible right after a restart, is filled first.
+//Parameter: none
+//Returns: nothing
+static void walls_take(void) {
+	if(game.wall_count == 0) {
+		walls_fill();
+	}
+	
+	unsigned char k = game.wall_head;
+	game.wall_head = (k + 1) % WALL_QUEUE;
+	--game.wall_count;
+	
+	game.wall = walls_stretch(game.wall_next[k]);
+	if(game.wall_period[k]) {
+		game.tasks[2].period = game.wall_period[k];
+	}
+	if(game.powerup_activated == 0x00) {
+		game.powerup_randomNum = (game.wall_spawn[k] != WALL_NO_POWERUP);
+		if(game.powerup_randomNum) {
+			game.powerup_spawn = game.wall_spawn[k];
+		}
+	}
+}
+
+#endif //WALLS_H